@@ -0,0 +1,38 @@
+# Before building the filesystem image, gzip the text files of our web UI.  The web server sends foo.js.gz to any client
+# which asks for /static/foo.js and accepts gzip (all browsers do).  The files in data/ are left alone, we build the image
+# from a compressed copy in the build directory.
+
+Import("env")
+
+import gzip
+import os
+import shutil
+from SCons.Script import COMMAND_LINE_TARGETS
+
+GZIP_SUFFIXES = (".html", ".js", ".css", ".json", ".svg", ".txt")
+
+
+def stage(srcDir, destDir):
+    shutil.rmtree(destDir, ignore_errors=True)
+    for root, dirs, files in os.walk(srcDir):
+        destRoot = os.path.join(destDir, os.path.relpath(root, srcDir))
+        os.makedirs(destRoot, exist_ok=True)
+        for name in files:
+            src = os.path.join(root, name)
+            if name.endswith(GZIP_SUFFIXES):
+                with open(src, "rb") as f:
+                    data = f.read()
+                # mtime=0 so the image (and the ETags the web server sends) only change if the file does
+                packed = gzip.compress(data, 9, mtime=0)
+                if len(packed) < len(data):
+                    print("gzip-static: {} {} -> {} bytes".format(os.path.relpath(src, srcDir), len(data), len(packed)))
+                    with open(os.path.join(destRoot, name + ".gz"), "wb") as f:
+                        f.write(packed)
+                    continue
+            shutil.copy2(src, os.path.join(destRoot, name))
+
+
+if any(t in ("buildfs", "uploadfs", "uploadfsota") for t in COMMAND_LINE_TARGETS):
+    staged = os.path.join(env.subst("$BUILD_DIR"), "data")
+    stage(env.subst("$PROJECT_DATA_DIR"), staged)
+    env.Replace(PROJECT_DATA_DIR=staged)
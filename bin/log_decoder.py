@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+
+"""Binary log decoder
+
+Turns the debug output of a device built with -DBINARY_LOG (see src/BinaryLog.h) back into the usual log lines.  Anything
+which isn't a binary log frame (i.e. output from before the log started, or from the bootloader) is passed through unchanged.
+
+To use, capture the device's serial output to a file (or read the port directly, which needs pyserial), e.g.:
+$ bin/log_decoder.py capture.bin
+$ bin/log_decoder.py --port /dev/ttyUSB0 --baud 921600
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+START1 = 0x9B
+START2 = 0x1D
+
+MESSAGE = 1
+STRING = 2
+DROPPED = 3
+CLOCK = 4
+
+# Must match binaryLogPackArgs() in src/BinaryLogFormat.cpp
+CONVERSION = re.compile(r"%([-+ #0]*)((?:\d+|\*)?)((?:\.(?:\d*|\*))?)((?:hh|h|ll|l|L|j|z|t)?)([diuxXocfFeEgGaApsn%])")
+
+
+class Decoder:
+    def __init__(self, out):
+        self.out = out
+        self.strings = {}  # format strings and thread names, by id
+        self.clock = None  # (millis, seconds since 1970) from the last clock frame
+        self.atLineStart = True
+        self.buf = b""
+
+    def feed(self, data):
+        """Decode some more bytes"""
+        self.buf += data
+        while self.buf:
+            start = self.buf.find(bytes([START1]))
+            if start < 0:
+                self.text(self.buf)
+                self.buf = b""
+                return
+            if start:
+                self.text(self.buf[:start])
+                self.buf = self.buf[start:]
+
+            if len(self.buf) < 5:
+                return  # wait for the rest of the header
+            if self.buf[1] != START2:
+                self.text(self.buf[:1])
+                self.buf = self.buf[1:]
+                continue
+
+            kind = self.buf[2]
+            length = self.buf[3] | (self.buf[4] << 8)
+            if len(self.buf) < 5 + length:
+                return  # wait for the rest of the frame
+            payload = self.buf[5:5 + length]
+            self.buf = self.buf[5 + length:]
+            self.frame(kind, payload)
+
+    def text(self, data):
+        self.out.write(data.decode("utf-8", "replace"))
+
+    def frame(self, kind, payload):
+        if kind == STRING:
+            (id,) = struct.unpack_from("<I", payload)
+            self.strings[id] = payload[4:].decode("utf-8", "replace")
+        elif kind == CLOCK:
+            self.clock = struct.unpack_from("<II", payload)
+        elif kind == DROPPED:
+            (count,) = struct.unpack_from("<I", payload)
+            self.out.write("\n*** %u log messages dropped so far (the device's log ring was full) ***\n" % count)
+            self.atLineStart = True
+        elif kind == MESSAGE:
+            self.message(payload)
+        # Ignore kinds we don't know about, they might be from a newer device
+
+    def header(self, thread, msec):
+        """The same header RedirectablePrint::logDebug puts on each line"""
+        if self.clock and self.clock[1]:
+            hms = (self.clock[1] + ((msec - self.clock[0]) & 0xFFFFFFFF) // 1000) % 86400
+            s = "%02d:%02d:%02d " % (hms // 3600, (hms % 3600) // 60, hms % 60)
+        else:
+            s = "??:??:?? "
+        s += "%u " % (msec // 1000)
+        if thread:
+            s += "[%s] " % self.strings.get(thread, "thread 0x%x" % thread)
+        return s
+
+    def message(self, payload):
+        format, thread, msec = struct.unpack_from("<III", payload)
+        fmt = self.strings.get(format)
+        if fmt is None:
+            text = "<unknown format 0x%x, args %s>\n" % (format, payload[12:].hex())
+        else:
+            text = self.format(fmt, payload[12:])
+
+        if self.atLineStart:
+            self.out.write(self.header(thread, msec))
+        self.out.write(text)
+        self.atLineStart = text.endswith("\n")
+
+    @staticmethod
+    def format(fmt, args):
+        """printf fmt with the packed args"""
+        pos = 0
+        out = []
+        last = 0
+        for m in CONVERSION.finditer(fmt):
+            out.append(fmt[last:m.start()])
+            last = m.end()
+            flags, width, precision, length, conv = m.groups()
+            if conv == "%":
+                out.append("%")
+                continue
+            try:
+                def take(fmtChar, size):
+                    nonlocal pos
+                    (v,) = struct.unpack_from("<" + fmtChar, args, pos)
+                    pos += size
+                    return v
+
+                if width == "*":
+                    width = str(take("i", 4))
+                if precision == ".*":
+                    precision = "." + str(take("i", 4))
+                spec = "%" + flags + width + precision
+
+                if conv in "di":
+                    out.append((spec + "d") % (take("q", 8) if length not in ("", "h", "hh") else take("i", 4)))
+                elif conv in "uxXoc":
+                    v = take("Q", 8) if length not in ("", "h", "hh") else take("I", 4)
+                    if conv == "u":
+                        out.append((spec + "d") % v)
+                    elif conv == "c":
+                        out.append((spec + "c") % (v & 0xFF))
+                    elif conv == "o" and "#" in flags:
+                        # python's alternate form is 0o17, C's is 017
+                        digits = "0%o" % v if v else "0"
+                        out.append(("%" + flags.replace("#", "").replace("0", "") + width + "s") % digits)
+                    else:
+                        out.append((spec + conv) % v)
+                elif conv in "fFeEgG":
+                    out.append((spec + conv) % take("d", 8))
+                elif conv in "aA":
+                    # python always gives all 13 hex digits of the fraction, C leaves off trailing zeros
+                    mantissa, exponent = float.hex(take("d", 8)).split("p")
+                    v = mantissa.rstrip("0").rstrip(".") + "p" + exponent
+                    out.append(v.upper() if conv == "A" else v)
+                elif conv == "p":
+                    out.append("0x%x" % take("Q", 8))
+                elif conv == "s":
+                    n = args[pos]
+                    s = args[pos + 1:pos + 1 + n].decode("utf-8", "replace")
+                    pos += 1 + n
+                    out.append((spec + "s") % s)
+                # %n prints nothing
+            except (struct.error, IndexError):
+                out.append("<missing>")  # The device ran out of room for the args
+        out.append(fmt[last:])
+        return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode binary debug logs (from a device built with -DBINARY_LOG).")
+    parser.add_argument("file", nargs="?", help="a capture of the serial output (default stdin)")
+    parser.add_argument("--port", help="read from this serial port instead (needs pyserial)")
+    parser.add_argument("--baud", type=int, default=921600, help="baud rate for --port")
+    args = parser.parse_args()
+
+    decoder = Decoder(sys.stdout)
+    if args.port:
+        import serial
+
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            while True:
+                decoder.feed(port.read(1024))
+                sys.stdout.flush()
+    else:
+        f = open(args.file, "rb") if args.file else sys.stdin.buffer
+        while True:
+            data = f.read(4096)
+            if not data:
+                break
+            decoder.feed(data)
+
+
+if __name__ == "__main__":
+    main()
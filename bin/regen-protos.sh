@@ -6,6 +6,31 @@ echo "This script requires https://jpa.kapsi.fi/nanopb/download/ version 0.4.4 t
 echo "meshtastic-device root directory if the following step fails, you should download the correct"
 echo "prebuilt binaries for your computer into nanopb-0.4.4"
 
+# Refuse to regenerate until proto/ has everything listed in proto-additions (our generated files were edited by hand to add
+# those fields, so regenerating without them would silently drop them).  Once they are upstream, delete the additions files.
+missing=0
+for f in proto-additions/*.proto.additions; do
+    [ -e "$f" ] || continue
+    target=proto/$(basename "$f" .additions)
+    # Each field must be there with the same tag, each new message must be there at all
+    for field in $(grep -oP '^\s*(repeated\s+)?\w+\s+\K\w+\s*=\s*\d+(?=;)' "$f" | tr -d ' '); do
+        if ! grep -qP "\\b${field%%=*}\\s*=\\s*${field##*=}\\b" "$target" 2>/dev/null; then
+            echo "$target has no field $field (see $f)"
+            missing=1
+        fi
+    done
+    for message in $(grep -oP '^message \K\w+' "$f" | sort -u); do
+        if ! grep -qP "^\\s*message\\s+$message\\b" "$target" 2>/dev/null; then
+            echo "$target has no message $message (see $f)"
+            missing=1
+        fi
+    done
+done
+if [ $missing != 0 ]; then
+    echo "Merge proto-additions into the protobufs submodule before regenerating"
+    exit 1
+fi
+
 # the nanopb tool seems to require that the .options file be in the current directory!
 cd proto
 ../nanopb-0.4.4/generator-bin/protoc --nanopb_out=-v:../src/mesh/generated -I=../proto *.proto
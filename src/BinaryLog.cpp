@@ -0,0 +1,216 @@
+#include "BinaryLog.h"
+#include "RTC.h"
+#include "concurrency/OSThread.h"
+#include "configuration.h"
+#include <assert.h>
+#include <string.h>
+
+#ifdef BINARY_LOG
+
+BinaryLog binaryLog;
+
+static_assert((BINARY_LOG_RING_SIZE & (BINARY_LOG_RING_SIZE - 1)) == 0, "BINARY_LOG_RING_SIZE must be a power of two");
+static_assert(BINARY_LOG_RING_SIZE <= 0x10000, "message lengths must fit in 16 bits");
+
+/// How many format strings and thread names we remember sending the text of (if there are more we forget them and start again)
+#define BINARY_LOG_MAX_IDS 256
+
+/// The most bytes we send each time our thread runs, so a big backlog doesn't hold everyone else up
+#define BINARY_LOG_SEND_BYTES 1024
+
+/// How often we send a BINARY_LOG_CLOCK frame (while we have messages to send)
+#define BINARY_LOG_CLOCK_MSECS (60 * 1000)
+
+/// A header word which marks its part of the ring as padding (because a message didn't fit before the end of the ring)
+#define HEADER_PADDING 0xff
+
+/** Each message in the ring starts with a header word, which is 0 until the message is complete:
+ *  bits 0-15 the number of bytes (including the header, but not any padding), bits 16-23 the kind of message
+ */
+static uint32_t makeHeader(uint32_t len, uint8_t kind)
+{
+    return len | ((uint32_t)kind << 16);
+}
+
+/// What the ring holds for a message, before its arguments (the frame we send has 32 bit ids instead of pointers)
+struct RingMessage {
+    uint32_t header;
+    const char *format;
+    const concurrency::OSThread *thread;
+    uint32_t msec;
+};
+
+/// Messages are padded so the next one is aligned (to 4 bytes on our devices, 8 for 64 bit simulator builds)
+static uint32_t paddedLen(uint32_t len)
+{
+    return (len + alignof(RingMessage) - 1) & ~(alignof(RingMessage) - 1);
+}
+
+void BinaryLog::log(const char *format, ...)
+{
+    uint8_t args[BINARY_LOG_MAX_ARGS];
+
+    va_list arg;
+    va_start(arg, format);
+    size_t argsLen = binaryLogPackArgs(args, sizeof(args), format, arg);
+    va_end(arg);
+
+    uint32_t len = sizeof(RingMessage) + argsLen, size = paddedLen(len);
+
+    // Reserve room, if the message won't fit before the end of the ring we also reserve the rest of the ring as padding
+    uint32_t pos = reserved.load(std::memory_order_relaxed), offset, pad;
+    do {
+        offset = pos % BINARY_LOG_RING_SIZE;
+        pad = offset + size > BINARY_LOG_RING_SIZE ? BINARY_LOG_RING_SIZE - offset : 0;
+        if (pos + pad + size - consumed.load(std::memory_order_acquire) > BINARY_LOG_RING_SIZE) {
+            numDropped++;
+            return;
+        }
+    } while (!reserved.compare_exchange_weak(pos, pos + pad + size, std::memory_order_relaxed));
+
+    if (pad) {
+        __atomic_store_n((uint32_t *)&ring.bytes[offset], makeHeader(pad, HEADER_PADDING), __ATOMIC_RELEASE);
+        offset = 0;
+    }
+
+    RingMessage *m = (RingMessage *)&ring.bytes[offset];
+    m->format = format;
+    m->thread = concurrency::OSThread::currentThread;
+    m->msec = millis();
+    memcpy(m + 1, args, argsLen);
+    __atomic_store_n(&m->header, makeHeader(len, BINARY_LOG_MESSAGE), __ATOMIC_RELEASE);
+
+    if (sender)
+        sender->wake();
+}
+
+/**
+ * Sends what has been logged to the debug port, in the background.
+ */
+class BinaryLogSender : public concurrency::OSThread
+{
+    BinaryLog &source;
+
+    /// The format strings and thread names we have sent the text of (0 for an empty entry)
+    uint32_t sentIds[BINARY_LOG_MAX_IDS] = {};
+    size_t numSentIds = 0;
+
+    uint32_t lastDropped = 0, lastClockMsec = 0;
+    bool sentClock = false;
+
+  public:
+    explicit BinaryLogSender(BinaryLog &_log) : OSThread("BinaryLog"), source(_log)
+    {
+        priority = concurrency::THREAD_PRIORITY_BACKGROUND;
+    }
+
+    /// Send everything complete in the ring (up to maxBytes of it), @return true if there is more to send
+    bool send(size_t maxBytes)
+    {
+        uint32_t pos = source.consumed.load(std::memory_order_relaxed);
+        size_t sent = 0;
+        while (pos != source.reserved.load(std::memory_order_acquire) && sent < maxBytes) {
+            uint8_t *p = &source.ring.bytes[pos % BINARY_LOG_RING_SIZE];
+            uint32_t header = __atomic_load_n((uint32_t *)p, __ATOMIC_ACQUIRE);
+            if (!header)
+                break; // someone is still writing it
+
+            uint32_t len = header & 0xffff, size = paddedLen(len);
+            if ((header >> 16) == BINARY_LOG_MESSAGE) {
+                sendMessage((const RingMessage *)p, len - sizeof(RingMessage));
+                sent += len;
+            }
+
+            // Clear it, so whatever is written here next isn't mistaken for a complete message
+            memset(p, 0, size);
+            pos += size;
+            source.consumed.store(pos, std::memory_order_release);
+        }
+
+        uint32_t dropped = source.numDropped.load(std::memory_order_relaxed);
+        if (dropped != lastDropped) {
+            lastDropped = dropped;
+            sendFrame(BINARY_LOG_DROPPED, &dropped, sizeof(dropped));
+        }
+
+        return pos != source.reserved.load(std::memory_order_acquire);
+    }
+
+  protected:
+    int32_t runOnce()
+    {
+        return send(BINARY_LOG_SEND_BYTES) ? 0 : INT32_MAX; // until someone logs something
+    }
+
+  private:
+    void sendFrame(BinaryLogFrame kind, const void *payload, size_t len, const void *more = NULL, size_t moreLen = 0)
+    {
+        uint8_t header[BINARY_LOG_HEADER_LEN];
+        binaryLogFrameHeader(header, kind, len + moreLen);
+        DEBUG_PORT.writeBinary(header, sizeof(header));
+        DEBUG_PORT.writeBinary((const uint8_t *)payload, len);
+        if (moreLen)
+            DEBUG_PORT.writeBinary((const uint8_t *)more, moreLen);
+    }
+
+    /// Send the text for id, unless we already have
+    void perhapsSendString(uint32_t id, const char *text)
+    {
+        // Open addressing, so looking an id up doesn't cost much more than a compare
+        size_t i = (id * 2654435761u) % BINARY_LOG_MAX_IDS;
+        while (sentIds[i]) {
+            if (sentIds[i] == id)
+                return;
+            i = (i + 1) % BINARY_LOG_MAX_IDS;
+        }
+
+        if (numSentIds >= BINARY_LOG_MAX_IDS * 3 / 4) { // Full, so start again (we'll resend the text of anything still in use)
+            memset(sentIds, 0, sizeof(sentIds));
+            numSentIds = 0;
+            i = (id * 2654435761u) % BINARY_LOG_MAX_IDS;
+        }
+        sentIds[i] = id;
+        numSentIds++;
+
+        sendFrame(BINARY_LOG_STRING, &id, sizeof(id), text, strlen(text));
+    }
+
+    /// @return the name of t, or NULL if it is no longer one of our threads (so we mustn't look at it)
+    static const char *threadName(const concurrency::OSThread *t)
+    {
+        for (auto i : concurrency::mainController.getThreads())
+            if (i == t)
+                return t->ThreadName.c_str();
+        return NULL;
+    }
+
+    void sendMessage(const RingMessage *m, size_t argsLen)
+    {
+        if (!sentClock || m->msec - lastClockMsec >= BINARY_LOG_CLOCK_MSECS) {
+            uint32_t clock[] = {m->msec, getValidTime(RTCQualityFromNet)};
+            sendFrame(BINARY_LOG_CLOCK, clock, sizeof(clock));
+            sentClock = true;
+            lastClockMsec = m->msec;
+        }
+
+        // Our ids are the (low 32 bits of the) address of each string or thread
+        uint32_t ids[] = {(uint32_t)(uintptr_t)m->format, 0, m->msec};
+        perhapsSendString(ids[0], m->format);
+
+        const char *name = m->thread ? threadName(m->thread) : NULL;
+        if (name) {
+            ids[1] = (uint32_t)(uintptr_t)m->thread;
+            perhapsSendString(ids[1], name);
+        }
+
+        sendFrame(BINARY_LOG_MESSAGE, ids, sizeof(ids), m + 1, argsLen);
+    }
+};
+
+void BinaryLog::begin()
+{
+    if (!sender)
+        sender = new BinaryLogSender(*this);
+}
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Bytes of RAM for messages waiting to be sent (must be a power of two)
+#ifndef BINARY_LOG_RING_SIZE
+#define BINARY_LOG_RING_SIZE 4096
+#endif
+
+/// The most bytes of arguments we keep for one message, and of any one string argument
+#define BINARY_LOG_MAX_ARGS 192
+#define BINARY_LOG_MAX_STRING 64
+
+/// Every frame we send starts with these bytes (unlike text, and unlike StreamAPI's protobuf frames)
+#define BINARY_LOG_START1 0x9b
+#define BINARY_LOG_START2 0x1d
+
+/// The kinds of frame we send, followed by a 16 bit little endian payload length and then the payload
+enum BinaryLogFrame {
+    BINARY_LOG_MESSAGE = 1, // uint32 format id, uint32 thread id, uint32 millis(), then the arguments
+    BINARY_LOG_STRING = 2,  // uint32 id, then the text of the format string or thread name with that id
+    BINARY_LOG_DROPPED = 3, // uint32 count of messages dropped (so far) because our ring was full
+    BINARY_LOG_CLOCK = 4    // uint32 millis(), uint32 seconds since 1970 at that moment (or 0 if we don't know)
+};
+
+/// Bytes in the header of every frame
+#define BINARY_LOG_HEADER_LEN 5
+
+/// Fill in the header (BINARY_LOG_HEADER_LEN bytes) of a frame with len bytes of payload
+void binaryLogFrameHeader(uint8_t *header, BinaryLogFrame kind, size_t len);
+
+/**
+ * Copy the arguments for format into out (whatever fits in room), @return how many bytes we used.
+ *
+ * bin/log_decoder.py reads them back by parsing format the same way: each int is 4 bytes unless it has a length modifier
+ * (other than h or hh), in which case it (and any pointer) is 8.  Floating point values are 8 byte doubles.  Strings are a
+ * length byte followed by that many bytes (at most BINARY_LOG_MAX_STRING).  All little endian, like our CPUs.
+ */
+size_t binaryLogPackArgs(uint8_t *out, size_t room, const char *format, va_list args);
+
+namespace concurrency
+{
+class OSThread;
+}
+
+/**
+ * A debug log that doesn't format anything while you wait.
+ *
+ * Instead of printing, log() copies the format string's address and the raw arguments (only strings are copied byte by byte)
+ * into a RAM ring, and a background thread sends them to the debug port as binary frames.  The first time it sends a format
+ * string (or a thread name) it sends the text too, so bin/log_decoder.py can turn the frames back into the usual log lines
+ * without needing the firmware image.  Any text which isn't in a frame is passed straight through.
+ *
+ * Build with -DBINARY_LOG to send DEBUG_MSG here.  Any thread can log at once (but not ISRs): writers reserve room with a
+ * compare-and-swap and mark their message complete when they have filled it in.  If the ring is full we drop the message and
+ * count it, rather than wait.
+ */
+class BinaryLog
+{
+    /// Our ring, each message starts with a header word (see makeHeader) and is padded to keep the next one aligned
+    union {
+        uint8_t bytes[BINARY_LOG_RING_SIZE];
+        void *alignment;
+    } ring = {};
+
+    /// Total bytes ever reserved by writers, and ever sent by our thread (the difference is how much of ring is in use)
+    std::atomic<uint32_t> reserved, consumed;
+
+    std::atomic<uint32_t> numDropped;
+
+    /// Our background thread, which sends what is in the ring (NULL until begin())
+    concurrency::OSThread *sender = NULL;
+
+    friend class BinaryLogSender;
+
+  public:
+    BinaryLog() : reserved(0), consumed(0), numDropped(0) {}
+
+    /// Start sending messages (we can't create our thread until setup() has started), anything logged before this is kept
+    void begin();
+
+    /// Record a message, like printf
+    void log(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern BinaryLog binaryLog;
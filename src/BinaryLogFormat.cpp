@@ -0,0 +1,151 @@
+#include "BinaryLog.h"
+#include <ctype.h>
+#include <string.h>
+
+// The parts of the binary log which define its wire format, kept free of the rest of the firmware so they can be unit tested
+// on a host (see test/test_binary_log)
+
+#ifdef BINARY_LOG
+
+void binaryLogFrameHeader(uint8_t *header, BinaryLogFrame kind, size_t len)
+{
+    header[0] = BINARY_LOG_START1;
+    header[1] = BINARY_LOG_START2;
+    header[2] = kind;
+    header[3] = len;
+    header[4] = len >> 8;
+}
+
+size_t binaryLogPackArgs(uint8_t *out, size_t room, const char *format, va_list args)
+{
+    uint8_t *p = out, *end = out + room;
+
+#define PUT(type, v)                                                                                                             \
+    do {                                                                                                                         \
+        type x = (v);                                                                                                            \
+        if (p + sizeof(x) > end)                                                                                                 \
+            return p - out;                                                                                                      \
+        memcpy(p, &x, sizeof(x));                                                                                                \
+        p += sizeof(x);                                                                                                          \
+    } while (0)
+
+    for (const char *f = format; *f; f++) {
+        if (*f != '%')
+            continue;
+        if (*++f == '%')
+            continue;
+
+        while (*f && strchr("-+ #0", *f)) // flags
+            f++;
+        while (*f && (isdigit(*f) || *f == '.' || *f == '*')) { // width and precision
+            if (*f == '*')
+                PUT(int32_t, va_arg(args, int));
+            f++;
+        }
+
+        char length = 0; // 0 for none (or h/hh, which are promoted to int anyway), 'L' for ll
+        while (*f && strchr("hlLjzt", *f)) {
+            if (*f != 'h')
+                length = (length == 'l' && *f == 'l') ? 'L' : *f;
+            f++;
+        }
+
+        switch (*f) {
+        case 'd':
+        case 'i':
+            switch (length) {
+            case 0:
+                PUT(int32_t, va_arg(args, int));
+                break;
+            case 'l':
+                PUT(int64_t, va_arg(args, long));
+                break;
+            case 'L':
+                PUT(int64_t, va_arg(args, long long));
+                break;
+            case 'j':
+                PUT(int64_t, va_arg(args, intmax_t));
+                break;
+            case 'z':
+            case 't':
+                PUT(int64_t, va_arg(args, ptrdiff_t));
+                break;
+            default:
+                return p - out; // we don't know what was passed, so we can't go on
+            }
+            break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            switch (length) { // unsigned, so a 32 bit long isn't sign extended
+            case 0:
+                PUT(uint32_t, va_arg(args, unsigned));
+                break;
+            case 'l':
+                PUT(uint64_t, va_arg(args, unsigned long));
+                break;
+            case 'L':
+                PUT(uint64_t, va_arg(args, unsigned long long));
+                break;
+            case 'j':
+                PUT(uint64_t, va_arg(args, uintmax_t));
+                break;
+            case 'z':
+            case 't':
+                PUT(uint64_t, va_arg(args, size_t));
+                break;
+            default:
+                return p - out;
+            }
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if (length == 'L')
+                PUT(double, va_arg(args, long double));
+            else
+                PUT(double, va_arg(args, double));
+            break;
+
+        case 'p':
+            PUT(uint64_t, (uintptr_t)va_arg(args, void *));
+            break;
+
+        case 's': {
+            const char *s = va_arg(args, const char *);
+            if (!s)
+                s = "(null)";
+            if (p + 1 > end)
+                return p - out;
+            size_t len = strnlen(s, BINARY_LOG_MAX_STRING);
+            if (len > (size_t)(end - p - 1))
+                len = end - p - 1;
+            *p++ = len;
+            memcpy(p, s, len);
+            p += len;
+            break;
+        }
+
+        case 'n':
+            va_arg(args, int *); // we don't write through it, and the decoder ignores it
+            break;
+
+        default: // unknown conversion (or the end of the string)
+            return p - out;
+        }
+    }
+
+#undef PUT
+    return p - out;
+}
+
+#endif
@@ -11,6 +11,7 @@
 #define FSBegin() true
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #elif !defined(NO_ESP32)
 // ESP32 version
 #include "SPIFFS.h"
@@ -18,11 +19,13 @@
 #define FSBegin() FS.begin(true)
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #else
 // NRF52 version
 #include "InternalFileSystem.h"
 #define FS InternalFS
 #define FSBegin() FS.begin()
+#define FILE_O_APPEND FILE_O_WRITE // LittleFS opens files for writing at their end
 using namespace Adafruit_LittleFS_Namespace;
 #endif
 
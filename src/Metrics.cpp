@@ -0,0 +1,187 @@
+#include "Metrics.h"
+#include <string.h>
+
+Metric *Metric::first;
+MetricCollector *MetricCollector::first;
+
+Metric::Metric(const char *_name, const char *_help, MetricType _type) : name(_name), help(_help), type(_type)
+{
+    // Keep the registry in the order metrics were constructed (within each file that is the order they are declared in)
+    next = NULL;
+    Metric **p = &first;
+    while (*p)
+        p = &(*p)->next;
+    *p = this;
+}
+
+size_t Metric::count()
+{
+    size_t n = 0;
+    for (Metric *m = first; m; m = m->next)
+        n++;
+    return n;
+}
+
+void Counter::write(MetricWriter &w) const
+{
+    w.begin(name, help, type);
+    w.value(get());
+    w.end();
+}
+
+void Gauge::write(MetricWriter &w) const
+{
+    w.begin(name, help, type);
+    w.value(get());
+    w.end();
+}
+
+void Histogram::getCounts(uint32_t *out) const
+{
+    for (size_t i = 0; i <= numBounds; i++)
+        out[i] = counts[i].load(std::memory_order_relaxed);
+}
+
+void Histogram::write(MetricWriter &w) const
+{
+    uint32_t c[METRIC_MAX_BUCKETS];
+    getCounts(c);
+
+    w.begin(name, help, type);
+    w.histogram(bounds, c, numBounds, getSum(), getCount());
+    w.end();
+}
+
+MetricCollector::MetricCollector()
+{
+    next = NULL;
+    MetricCollector **p = &first;
+    while (*p)
+        p = &(*p)->next;
+    *p = this;
+}
+
+void writeMetrics(MetricWriter &w)
+{
+    for (Metric *m = Metric::getFirst(); m; m = m->getNext())
+        m->write(w);
+    for (MetricCollector *c = MetricCollector::first; c; c = c->next)
+        c->collect(w);
+}
+
+/// Print v (our values are all 32 bit, signed or not), without needing 64 bit printf support
+static void printValue(Print &out, int64_t v)
+{
+    if (v < 0) {
+        out.print('-');
+        v = -v;
+    }
+    out.print((unsigned long)v);
+}
+
+static const char *typeNames[] = {"counter", "gauge", "histogram"};
+
+void PrometheusWriter::begin(const char *_name, const char *help, MetricType type)
+{
+    name = _name;
+    out.printf("# HELP meshtastic_%s %s\n# TYPE meshtastic_%s %s\n", name, help, name, typeNames[type]);
+}
+
+void PrometheusWriter::value(int64_t v, const char *labelName, const char *labelValue)
+{
+    out.print("meshtastic_");
+    out.print(name);
+    if (labelValue)
+        out.printf("{%s=\"%s\"}", labelName, labelValue);
+    out.print(' ');
+    printValue(out, v);
+    out.print('\n');
+}
+
+void PrometheusWriter::histogram(const uint32_t *bounds, const uint32_t *counts, size_t numBounds, uint32_t sum, uint32_t count)
+{
+    // Prometheus buckets are cumulative
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i <= numBounds; i++) {
+        cumulative += counts[i];
+        if (i < numBounds)
+            out.printf("meshtastic_%s_bucket{le=\"%u\"} %u\n", name, bounds[i], cumulative);
+        else
+            out.printf("meshtastic_%s_bucket{le=\"+Inf\"} %u\n", name, cumulative);
+    }
+    out.printf("meshtastic_%s_sum %u\nmeshtastic_%s_count %u\n", name, sum, name, count);
+}
+
+JsonWriter::JsonWriter(Print &_out) : out(_out)
+{
+    out.print('{');
+}
+
+void JsonWriter::finish()
+{
+    out.print("\n}");
+}
+
+void JsonWriter::begin(const char *name, const char *help, MetricType type)
+{
+    out.printf("%s\n\"%s\": ", needComma ? "," : "", name);
+    needComma = true;
+    inFamily = wroteValue = false;
+}
+
+void JsonWriter::value(int64_t v, const char *labelName, const char *labelValue)
+{
+    if (labelValue) {
+        out.printf("%s\"%s\": ", inFamily ? ", " : "{", labelValue);
+        inFamily = true;
+    }
+    printValue(out, v);
+    wroteValue = true;
+}
+
+void JsonWriter::histogram(const uint32_t *bounds, const uint32_t *counts, size_t numBounds, uint32_t sum, uint32_t count)
+{
+    out.print("{\"le\": [");
+    for (size_t i = 0; i < numBounds; i++)
+        out.printf("%s%u", i ? ", " : "", bounds[i]);
+    out.print("], \"counts\": [");
+    for (size_t i = 0; i <= numBounds; i++)
+        out.printf("%s%u", i ? ", " : "", counts[i]);
+    out.printf("], \"sum\": %u, \"count\": %u}", sum, count);
+    wroteValue = true;
+}
+
+void JsonWriter::end()
+{
+    if (inFamily)
+        out.print('}');
+    else if (!wroteValue)
+        out.print("{}"); // a family with nothing in it right now
+}
+
+size_t BufferedPrint::write(uint8_t c)
+{
+    if (len == sizeof(buf))
+        flush();
+    buf[len++] = c;
+    return 1;
+}
+
+size_t BufferedPrint::write(const uint8_t *buffer, size_t size)
+{
+    if (len + size > sizeof(buf)) {
+        flush();
+        if (size > sizeof(buf)) // Too big to be worth copying
+            return dest.write(buffer, size);
+    }
+    memcpy(buf + len, buffer, size);
+    len += size;
+    return size;
+}
+
+void BufferedPrint::flush()
+{
+    if (len)
+        dest.write(buf, len);
+    len = 0;
+}
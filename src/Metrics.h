@@ -0,0 +1,251 @@
+#pragma once
+
+#include <Print.h>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/// The most buckets (including the last, for values above every bound) a histogram may have, so each fits in a MetricValue
+#define METRIC_MAX_BUCKETS 8
+
+enum MetricType { METRIC_COUNTER, METRIC_GAUGE, METRIC_HISTOGRAM };
+
+/**
+ * Something which writes metrics out in some format (see PrometheusWriter and JsonWriter).
+ *
+ * Each metric (or family of metrics which differ only by a label) is written as begin(), then either some values or one
+ * histogram, then end().
+ */
+class MetricWriter
+{
+  public:
+    virtual ~MetricWriter() {}
+
+    virtual void begin(const char *name, const char *help, MetricType type) = 0;
+
+    /// A value of the current metric, labelValue is NULL unless this is one of a family (where labelName is i.e. "thread")
+    virtual void value(int64_t v, const char *labelName = NULL, const char *labelValue = NULL) = 0;
+
+    /// The current metric's buckets: counts[i] is how many values were <= bounds[i] (and above the bound before it), the last
+    /// count (counts[numBounds]) is how many were above every bound
+    virtual void histogram(const uint32_t *bounds, const uint32_t *counts, size_t numBounds, uint32_t sum, uint32_t count) = 0;
+
+    virtual void end() = 0;
+};
+
+/**
+ * A named value, registered at construction.  Metrics are meant to be globals (or to live as long as the program), so they are
+ * all registered before setup() runs - we keep the registry inside the metrics, so registering never allocates.
+ *
+ * Updating a metric is a single relaxed atomic operation, so any thread or ISR can do it without locks (reads are only a
+ * snapshot, i.e. a histogram's count might not quite match its buckets).  Everything is 32 bits, because our nRF52s have no
+ * 64 bit atomics.
+ */
+class Metric
+{
+    Metric *next;
+
+    static Metric *first;
+
+  public:
+    /// name should be lower_case_with_underscores (our exporters add any prefix), counters end in _total
+    const char *const name, *const help;
+    const MetricType type;
+
+    Metric(const char *_name, const char *_help, MetricType _type);
+
+    Metric(const Metric &) = delete;
+    Metric &operator=(const Metric &) = delete;
+
+    static Metric *getFirst() { return first; }
+    Metric *getNext() const { return next; }
+
+    /// @return how many metrics are registered
+    static size_t count();
+
+    virtual void write(MetricWriter &w) const = 0;
+};
+
+/**
+ * A count which only goes up (until we reboot)
+ */
+class Counter : public Metric
+{
+    std::atomic<uint32_t> val;
+
+  public:
+    Counter(const char *_name, const char *_help) : Metric(_name, _help, METRIC_COUNTER), val(0) {}
+
+    void inc(uint32_t n = 1) { val.fetch_add(n, std::memory_order_relaxed); }
+
+    uint32_t get() const { return val.load(std::memory_order_relaxed); }
+
+    virtual void write(MetricWriter &w) const;
+};
+
+/**
+ * A value which goes up and down.  Either set it, or give it a function which reads the value whenever it is exported (for
+ * values which already live somewhere else, i.e. the free heap).
+ */
+class Gauge : public Metric
+{
+    std::atomic<int32_t> val;
+
+    int32_t (*reader)();
+
+  public:
+    Gauge(const char *_name, const char *_help, int32_t (*_reader)() = NULL)
+        : Metric(_name, _help, METRIC_GAUGE), val(0), reader(_reader)
+    {
+    }
+
+    void set(int32_t v) { val.store(v, std::memory_order_relaxed); }
+    void add(int32_t n) { val.fetch_add(n, std::memory_order_relaxed); }
+
+    int32_t get() const { return reader ? reader() : val.load(std::memory_order_relaxed); }
+
+    virtual void write(MetricWriter &w) const;
+};
+
+/**
+ * Counts how many values fell into each of some fixed buckets (use FixedHistogram, which holds the counts)
+ */
+class Histogram : public Metric
+{
+    const uint32_t *bounds;
+    size_t numBounds;
+    std::atomic<uint32_t> *counts; // numBounds + 1 of them
+
+    std::atomic<uint32_t> total;
+    std::atomic<uint32_t> sum; // wraps, like a counter
+
+  protected:
+    Histogram(const char *_name, const char *_help, const uint32_t *_bounds, size_t _numBounds, std::atomic<uint32_t> *_counts)
+        : Metric(_name, _help, METRIC_HISTOGRAM), bounds(_bounds), numBounds(_numBounds), counts(_counts), total(0), sum(0)
+    {
+    }
+
+  public:
+    void observe(uint32_t v)
+    {
+        size_t i = 0;
+        while (i < numBounds && v > bounds[i])
+            i++;
+        counts[i].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    /// Copy our current counts into out (which must have room for getNumBounds() + 1)
+    void getCounts(uint32_t *out) const;
+
+    const uint32_t *getBounds() const { return bounds; }
+    size_t getNumBounds() const { return numBounds; }
+    uint32_t getCount() const { return total.load(std::memory_order_relaxed); }
+    uint32_t getSum() const { return sum.load(std::memory_order_relaxed); }
+
+    virtual void write(MetricWriter &w) const;
+};
+
+/**
+ * A histogram with the N bounds (in increasing order) given, i.e.
+ *   static const uint32_t sendBounds[] = {10, 100, 1000};
+ *   FixedHistogram<3> sendTime("send_msec", "How long sends took", sendBounds);
+ */
+template <size_t N> class FixedHistogram : public Histogram
+{
+    static_assert(N + 1 <= METRIC_MAX_BUCKETS, "too many histogram buckets");
+
+    std::atomic<uint32_t> storage[N + 1] = {};
+
+  public:
+    FixedHistogram(const char *_name, const char *_help, const uint32_t (&_bounds)[N])
+        : Histogram(_name, _help, _bounds, N, storage)
+    {
+    }
+};
+
+/**
+ * Writes metrics which aren't registry objects, such as stats kept for each thread or plugin (which come and go, so each is
+ * written as a family labelled with its name).  Like Metric, collectors are globals and register themselves.
+ */
+class MetricCollector
+{
+    MetricCollector *next;
+
+    static MetricCollector *first;
+
+    friend void writeMetrics(MetricWriter &w);
+
+  public:
+    MetricCollector();
+
+    MetricCollector(const MetricCollector &) = delete;
+    MetricCollector &operator=(const MetricCollector &) = delete;
+
+    virtual void collect(MetricWriter &w) = 0;
+};
+
+/// Write every registered metric, then everything our collectors have
+void writeMetrics(MetricWriter &w);
+
+/**
+ * Writes the Prometheus text exposition format (https://prometheus.io/docs/instrumenting/exposition_formats/), with each name
+ * prefixed by "meshtastic_".
+ */
+class PrometheusWriter : public MetricWriter
+{
+    Print &out;
+    const char *name = NULL;
+
+  public:
+    explicit PrometheusWriter(Print &_out) : out(_out) {}
+
+    virtual void begin(const char *_name, const char *help, MetricType type);
+    virtual void value(int64_t v, const char *labelName = NULL, const char *labelValue = NULL);
+    virtual void histogram(const uint32_t *bounds, const uint32_t *counts, size_t numBounds, uint32_t sum, uint32_t count);
+    virtual void end() {}
+};
+
+/**
+ * Writes a JSON object with a member for each metric: a number, or (for a family) an object with a number for each label
+ * value, or (for a histogram) {"le": [bounds], "counts": [one more than bounds], "sum": n, "count": n}.
+ */
+class JsonWriter : public MetricWriter
+{
+    Print &out;
+    bool needComma = false, inFamily = false, wroteValue = false;
+
+  public:
+    /// Starts the object
+    explicit JsonWriter(Print &_out);
+
+    /// Ends the object
+    void finish();
+
+    virtual void begin(const char *name, const char *help, MetricType type);
+    virtual void value(int64_t v, const char *labelName = NULL, const char *labelValue = NULL);
+    virtual void histogram(const uint32_t *bounds, const uint32_t *counts, size_t numBounds, uint32_t sum, uint32_t count);
+    virtual void end();
+};
+
+/**
+ * A Print which collects what is printed into chunks, so a destination which is expensive per write (i.e. an HTTP response,
+ * where each write is a socket send) sees a few big writes instead of one for every printf.
+ */
+class BufferedPrint : public Print
+{
+    Print &dest;
+    uint8_t buf[256];
+    size_t len = 0;
+
+  public:
+    explicit BufferedPrint(Print &_dest) : dest(_dest) {}
+    ~BufferedPrint() { flush(); }
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+    /// Send anything we are holding on to
+    void flush();
+};
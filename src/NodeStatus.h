@@ -12,10 +12,10 @@ namespace meshtastic {
        private:
         CallbackObserver<NodeStatus, const NodeStatus *> statusObserver = CallbackObserver<NodeStatus, const NodeStatus *>(this, &NodeStatus::updateStatus);
 
-        uint8_t numOnline = 0;
-        uint8_t numTotal = 0;
+        uint16_t numOnline = 0;
+        uint16_t numTotal = 0;
 
-        uint8_t lastNumTotal = 0;
+        uint16_t lastNumTotal = 0;
 
        public:
         bool forceUpdate = false;
@@ -23,7 +23,7 @@ namespace meshtastic {
         NodeStatus() {
             statusType = STATUS_TYPE_NODE;
         }
-        NodeStatus( uint8_t numOnline, uint8_t numTotal, bool forceUpdate = false ) : Status()
+        NodeStatus( uint16_t numOnline, uint16_t numTotal, bool forceUpdate = false ) : Status()
         {
             this->forceUpdate = forceUpdate;
             this->numOnline = numOnline;
@@ -32,22 +32,30 @@ namespace meshtastic {
         NodeStatus(const NodeStatus &);
         NodeStatus &operator=(const NodeStatus &);
 
+        /// Change our counts, for a status which is sent to observers later (see NodeDB::notifyObservers)
+        void set(uint16_t numOnline, uint16_t numTotal, bool forceUpdate)
+        {
+            this->forceUpdate = forceUpdate;
+            this->numOnline = numOnline;
+            this->numTotal = numTotal;
+        }
+
         void observe(Observable<const NodeStatus *> *source)
         {
             statusObserver.observe(source);
         }
 
-        uint8_t getNumOnline() const
+        uint16_t getNumOnline() const
         { 
             return numOnline; 
         }
 
-        uint8_t getNumTotal() const
+        uint16_t getNumTotal() const
         { 
             return numTotal; 
         }
 
-        uint8_t getLastNumTotal() const
+        uint16_t getLastNumTotal() const
         {
             return lastNumTotal;
         }
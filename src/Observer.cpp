@@ -1,2 +1,86 @@
 #include "Observer.h"
+#include "concurrency/OSThread.h"
 
+/**
+ * Delivers DeferredObservable notifications.  Only created once someone defers a notification (OSThreads can't be created
+ * before setup()).
+ */
+class DeferredNotifier : public concurrency::OSThread
+{
+    /// Our pending notifications, oldest first
+    DeferredNotification *head = NULL, *tail = NULL;
+
+  public:
+    DeferredNotifier() : OSThread("Notify") { priority = concurrency::THREAD_PRIORITY_BACKGROUND; }
+
+    void add(DeferredNotification *n)
+    {
+        n->pending = true;
+        n->nextPending = NULL;
+        if (tail)
+            tail->nextPending = n;
+        else
+            head = n;
+        tail = n;
+
+        wake();
+    }
+
+    void remove(DeferredNotification *n)
+    {
+        DeferredNotification *prev = NULL;
+        for (DeferredNotification *i = head; i; prev = i, i = i->nextPending)
+            if (i == n) {
+                if (prev)
+                    prev->nextPending = n->nextPending;
+                else
+                    head = n->nextPending;
+                if (tail == n)
+                    tail = prev;
+
+                n->nextPending = NULL;
+                n->pending = false;
+                return;
+            }
+    }
+
+  protected:
+    int32_t runOnce()
+    {
+        // Only deliver what was pending when we started, an observer which notifies again gets delivered next time
+        DeferredNotification *last = tail;
+        while (head) {
+            DeferredNotification *n = head;
+            head = n->nextPending;
+            if (!head)
+                tail = NULL;
+            n->nextPending = NULL;
+            n->pending = false;
+
+            n->deliver();
+
+            if (n == last)
+                break;
+        }
+
+        return INT32_MAX; // Until someone wakes us
+    }
+};
+
+static DeferredNotifier *deferredNotifier;
+
+void DeferredNotification::schedule()
+{
+    if (pending)
+        return; // We'll deliver the latest arg when we get to it
+
+    if (!deferredNotifier)
+        deferredNotifier = new DeferredNotifier();
+    deferredNotifier->add(this);
+}
+
+void DeferredNotification::cancel()
+{
+    if (pending)
+        deferredNotifier->remove(this);
+}
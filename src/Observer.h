@@ -2,7 +2,6 @@
 
 #include <Arduino.h>
 #include <assert.h>
-#include <list>
 
 template <class T> class Observable;
 
@@ -13,6 +12,9 @@ template <class T> class Observer
 {
     Observable<T> *observed = NULL;
 
+    /// The next observer of observed (we keep the list inside the observers, so observing never allocates)
+    Observer<T> *nextObserver = NULL;
+
   public:
     virtual ~Observer();
 
@@ -56,9 +58,16 @@ template <class Callback, class T> class CallbackObserver : public Observer<T>
  */
 template <class T> class Observable
 {
-    std::list<Observer<T> *> observers;
+    /// Our first observer, the rest are linked through Observer::nextObserver
+    Observer<T> *observers = NULL;
 
   public:
+    ~Observable()
+    {
+        while (observers)
+            observers->unobserve();
+    }
+
     /**
      * Tell all observers about a change, observers can process arg as they wish
      *
@@ -66,11 +75,12 @@ template <class T> class Observable
      */
     int notifyObservers(T arg)
     {
-        for (typename std::list<Observer<T> *>::const_iterator iterator = observers.begin(); iterator != observers.end();
-             ++iterator) {
-            int result = (*iterator)->onNotify(arg);
+        for (Observer<T> *o = observers; o;) {
+            Observer<T> *next = o->nextObserver; // in case o stops observing us
+            int result = o->onNotify(arg);
             if (result != 0)
                 return result;
+            o = next;
         }
 
         return 0;
@@ -80,9 +90,79 @@ template <class T> class Observable
     friend class Observer<T>;
 
     // Not called directly, instead call observer.observe
-    void addObserver(Observer<T> *o) { observers.push_back(o); }
+    void addObserver(Observer<T> *o)
+    {
+        // Add to the end, so observers are called in the order they started observing
+        Observer<T> **p = &observers;
+        while (*p)
+            p = &(*p)->nextObserver;
+        *p = o;
+        o->nextObserver = NULL;
+    }
+
+    void removeObserver(Observer<T> *o)
+    {
+        for (Observer<T> **p = &observers; *p; p = &(*p)->nextObserver)
+            if (*p == o) {
+                *p = o->nextObserver;
+                o->nextObserver = NULL;
+                return;
+            }
+    }
+};
+
+/**
+ * Something with a notification waiting to be delivered from the scheduler, see DeferredObservable.
+ */
+class DeferredNotification
+{
+    /// The next notification waiting to be delivered (our pending list is kept inside its members, so it never allocates)
+    DeferredNotification *nextPending = NULL;
+    bool pending = false;
+
+    friend class DeferredNotifier;
+
+  public:
+    virtual ~DeferredNotification() { cancel(); }
+
+    /// @return true if we have a notification which hasn't been delivered yet
+    bool isPending() const { return pending; }
+
+  protected:
+    /// Arrange for deliver() to be called from the scheduler soon (does nothing if we are already waiting).  Not for ISRs.
+    void schedule();
+
+    /// Forget our pending notification (if any)
+    void cancel();
+
+    /// Called from the scheduler to deliver our notification
+    virtual void deliver() = 0;
+};
+
+/**
+ * An Observable which can also notify its observers later, from the scheduler, rather than inside whoever noticed the change.
+ * Notifications made before the last one was delivered are coalesced: observers only hear about the most recent arg.  So
+ * if we learn about twenty nodes in one burst of packets, the screen only updates once, and not from inside packet
+ * processing.
+ *
+ * Deferred notifications are delivered by a background priority thread, so anything more urgent which is due (i.e. the rest
+ * of that burst of packets) runs first.  Since arg is used later it must stay valid until then (if it is a pointer, point it
+ * at something you own rather than a local).
+ */
+template <class T> class DeferredObservable : public Observable<T>, public DeferredNotification
+{
+    T pendingArg;
+
+  public:
+    /// Tell our observers about arg soon (any arg we were given since the last delivery is forgotten)
+    void notifyObserversDeferred(T arg)
+    {
+        pendingArg = arg;
+        schedule();
+    }
 
-    void removeObserver(Observer<T> *o) { observers.remove(o); }
+  protected:
+    virtual void deliver() { this->notifyObservers(pendingArg); }
 };
 
 template <class T> Observer<T>::~Observer()
@@ -96,7 +96,10 @@ class AnalogBatteryLevel : public HasBatteryLevel
     const float fullVolt = 4.2, emptyVolt = 3.27, chargingVolt = 4.3, noBatVolt = 2.1;
 } analogLevel;
 
-Power::Power() : OSThread("Power") {}
+Power::Power() : OSThread("Power")
+{
+    priority = concurrency::THREAD_PRIORITY_BACKGROUND;
+}
 
 bool Power::analogInit()
 {
@@ -130,7 +133,7 @@ bool Power::setup()
     if (!found) {
         found = analogInit();
     }
-    enabled = found;
+    setEnabled(found);
 
     return found;
 }
@@ -29,6 +29,9 @@ class RedirectablePrint : public Print
 
     virtual size_t write(uint8_t c);
 
+    /// Write bytes exactly as they are (unlike write, which subclasses might translate), for binary data such as BinaryLog
+    void writeBinary(const uint8_t *buf, size_t len) { dest->write(buf, len); }
+
     /**
      * Debug logging print message
      * 
@@ -1,4 +1,5 @@
 #include "airtime.h"
+#include "Metrics.h"
 #include <Arduino.h>
 
 #define periodsToLog 48
@@ -11,6 +12,15 @@ uint32_t secSinceBoot = 0;
 
 // AirTime at;
 
+/// A leaky bucket of recent transmit airtime (in msecs), drains at our budgeted rate
+uint32_t txBudgetUsedMsec = 0;
+
+/// The last time we drained the bucket
+uint32_t txBudgetLeakMillis = 0;
+
+/// The most the bucket can hold
+#define TX_BUDGET_CAPACITY_MSEC (TX_AIRTIME_WINDOW_SECS * 10 * TX_AIRTIME_BUDGET_PERCENT)
+
 // Don't read out of this directly. Use the helper functions.
 struct airtimeStruct {
     uint32_t periodTX[periodsToLog];     // AirTime transmitted
@@ -19,17 +29,48 @@ struct airtimeStruct {
     uint8_t lastPeriodIndex;
 } airtimes;
 
+// The same airtime, added up since boot (airtimes only keeps the last periodsToLog periods)
+static Counter txMsec("airtime_tx_msec_total", "Msecs we have spent transmitting");
+static Counter rxMsec("airtime_rx_msec_total", "Msecs of valid mesh packets we have received");
+static Counter rxAllMsec("airtime_rx_all_msec_total", "Msecs of all LoRa packets we have received (including noise)");
+
+static const uint32_t txPacketBounds[] = {50, 100, 200, 500, 1000, 2000, 5000};
+static FixedHistogram<7> txPacketMsec("airtime_tx_packet_msec", "Airtime of each packet we transmitted", txPacketBounds);
+
+static Gauge uptime("uptime_seconds", "Seconds since we booted", []() { return (int32_t)getSecondsSinceBoot(); });
+
+/// Drain the bucket for the time which has passed since we last did
+static void leakTxBudget()
+{
+    // Each second we earn back our budgeted share of that second
+    uint32_t elapsed = millis() - txBudgetLeakMillis;
+    uint32_t leakMsec = (uint64_t)elapsed * TX_AIRTIME_BUDGET_PERCENT / 100;
+    if (!leakMsec)
+        return; // Not long enough to earn anything back yet, keep the time for later
+
+    txBudgetLeakMillis += leakMsec * 100 / TX_AIRTIME_BUDGET_PERCENT;
+    txBudgetUsedMsec = (txBudgetUsedMsec > leakMsec) ? txBudgetUsedMsec - leakMsec : 0;
+}
+
 void AirTime::logAirtime(reportTypes reportType, uint32_t airtime_ms)
 {
+    airtimeRotatePeriod(); // In case we haven't run since a period ended
+
     if (reportType == TX_LOG) {
+        leakTxBudget();
         DEBUG_MSG("AirTime - Packet transmitted : %ums\n", airtime_ms);
         airtimes.periodTX[0] = airtimes.periodTX[0] + airtime_ms;
+        txBudgetUsedMsec += airtime_ms;
+        txMsec.inc(airtime_ms);
+        txPacketMsec.observe(airtime_ms);
     } else if (reportType == RX_LOG) {
         DEBUG_MSG("AirTime - Packet received : %ums\n", airtime_ms);
         airtimes.periodRX[0] = airtimes.periodRX[0] + airtime_ms;
+        rxMsec.inc(airtime_ms);
     } else if (reportType == RX_ALL_LOG) {
         DEBUG_MSG("AirTime - Packet received (noise?) : %ums\n", airtime_ms);
         airtimes.periodRX_ALL[0] = airtimes.periodRX_ALL[0] + airtime_ms;
+        rxAllMsec.inc(airtime_ms);
     } else {
         DEBUG_MSG("AirTime - Unknown report time. This should never happen!!\n");
     }
@@ -84,24 +125,33 @@ uint32_t getSecondsPerPeriod()
 
 uint32_t getSecondsSinceBoot()
 {
+    // millis() wraps every 49 days, so we add up the whole seconds which have passed since we were last asked
+    uint32_t elapsed = (millis() - lastMillis) / 1000;
+    secSinceBoot += elapsed;
+    lastMillis += elapsed * 1000;
+
     return secSinceBoot;
 }
 
-AirTime::AirTime() : concurrency::OSThread("AirTime") {}
+uint32_t getTxAirtimeAvailable()
+{
+    leakTxBudget();
+    return (txBudgetUsedMsec < TX_BUDGET_CAPACITY_MSEC) ? TX_BUDGET_CAPACITY_MSEC - txBudgetUsedMsec : 0;
+}
+
+AirTime::AirTime() : concurrency::OSThread("AirTime")
+{
+    priority = concurrency::THREAD_PRIORITY_BACKGROUND;
+}
 
 int32_t AirTime::runOnce()
 {
     //DEBUG_MSG("AirTime::runOnce()\n");
 
     airtimeRotatePeriod();
-    secSinceBoot++;
-
-    /*
-        This actually doesn't need to be run once per second but we currently use it for the
-        secSinceBoot counter.
 
-        If we have a better counter of how long the device has been online (and not millis())
-        then we can change this to something less frequent. Maybe once ever 5 seconds?
-    */
-    return (1000 * 1);
+    // Our uptime and transmit budget are worked out from millis() when someone asks, so we only need to wake up to start
+    // each new period (getSecondsSinceBoot() also needs calling at least once per millis() wrap, which this does)
+    uint32_t secsIntoPeriod = getSecondsSinceBoot() % secondsPerPeriod;
+    return (secondsPerPeriod - secsIntoPeriod) * 1000;
 }
\ No newline at end of file
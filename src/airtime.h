@@ -38,6 +38,17 @@ uint32_t *airtimeReport(reportTypes reportType);
 
 uint32_t getSecondsPerPeriod();
 
+/// We try to keep our own transmissions under this percentage of the channel's time (clients are paced to stay within it)
+#ifndef TX_AIRTIME_BUDGET_PERCENT
+#define TX_AIRTIME_BUDGET_PERCENT 10
+#endif
+
+/// The window we apply that budget over, so short bursts are still allowed
+#define TX_AIRTIME_WINDOW_SECS 60
+
+/// @return msecs of transmit airtime we can still use without going over our budget
+uint32_t getTxAirtimeAvailable();
+
 class AirTime : private concurrency::OSThread
 {
 
@@ -0,0 +1,79 @@
+#include "concurrency/DueHeap.h"
+#include <assert.h>
+
+namespace concurrency
+{
+
+void DueHeap::siftUp(size_t i)
+{
+    DueHeapItem *x = items[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!isBefore(x, items[parent]))
+            break;
+        place(i, items[parent]);
+        i = parent;
+    }
+    place(i, x);
+}
+
+void DueHeap::siftDown(size_t i)
+{
+    DueHeapItem *x = items[i];
+    size_t n = items.size();
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && isBefore(items[child + 1], items[child]))
+            child++;
+        if (!isBefore(items[child], x))
+            break;
+        place(i, items[child]);
+        i = child;
+    }
+    place(i, x);
+}
+
+void DueHeap::push(DueHeapItem *x, uint32_t dueAt)
+{
+    assert(!x->inHeap());
+    x->dueAt = dueAt;
+    items.push_back(x);
+    siftUp(items.size() - 1);
+}
+
+void DueHeap::update(DueHeapItem *x, uint32_t dueAt)
+{
+    assert(x->inHeap() && items[x->heapIndex] == x);
+    bool sooner = (int32_t)(dueAt - x->dueAt) < 0;
+    x->dueAt = dueAt;
+    if (sooner)
+        siftUp(x->heapIndex);
+    else
+        siftDown(x->heapIndex);
+}
+
+void DueHeap::remove(DueHeapItem *x)
+{
+    if (!x->inHeap())
+        return;
+
+    size_t i = x->heapIndex;
+    assert(items[i] == x);
+    x->heapIndex = -1;
+
+    DueHeapItem *last = items.back();
+    items.pop_back();
+    if (i == items.size()) // x was the last item
+        return;
+
+    // Move the last item into the hole, then wherever it belongs from there
+    place(i, last);
+    if (i > 0 && isBefore(last, items[(i - 1) / 2]))
+        siftUp(i);
+    else
+        siftDown(i);
+}
+
+} // namespace concurrency
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace concurrency
+{
+
+/// Something which can wait in a DueHeap (OSThread is one)
+struct DueHeapItem {
+    /// When we are due (a millis() value), only meaningful while we are in a heap
+    uint32_t dueAt = 0;
+
+    /// Where we are in the heap's array, -1 if we aren't in a heap
+    int32_t heapIndex = -1;
+
+    bool inHeap() const { return heapIndex >= 0; }
+};
+
+/**
+ * A min-heap of items ordered by when they are due, so the soonest is always on top.  Each item remembers where it is, so
+ * any item can be moved (because it was rescheduled) or removed in O(log n).
+ *
+ * Times are compared as a signed difference, so millis() wrapping is harmless as long as every item is due within 24 days of
+ * the others.
+ */
+class DueHeap
+{
+    std::vector<DueHeapItem *> items;
+
+    /// @return true if a is due before b
+    static bool isBefore(const DueHeapItem *a, const DueHeapItem *b) { return (int32_t)(a->dueAt - b->dueAt) < 0; }
+
+    /// Put x at index i
+    void place(size_t i, DueHeapItem *x)
+    {
+        items[i] = x;
+        x->heapIndex = i;
+    }
+
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+
+  public:
+    /// Add x (which mustn't already be in a heap)
+    void push(DueHeapItem *x, uint32_t dueAt);
+
+    /// Change when x (which must be in this heap) is due
+    void update(DueHeapItem *x, uint32_t dueAt);
+
+    /// Take x out of this heap (if it is in it)
+    void remove(DueHeapItem *x);
+
+    /// @return the item due soonest, or NULL if we are empty
+    DueHeapItem *top() const { return items.empty() ? NULL : items[0]; }
+
+    bool empty() const { return items.empty(); }
+
+    size_t size() const { return items.size(); }
+};
+
+} // namespace concurrency
@@ -26,7 +26,7 @@ bool NotifiedWorkerThread::notify(uint32_t v, bool overwrite)
 IRAM_ATTR bool NotifiedWorkerThread::notifyCommon(uint32_t v, bool overwrite)
 {
     if (overwrite || notification == 0) {
-        enabled = true;
+        setEnabled(true);
         setInterval(0); // Run ASAP
 
         notification = v;
@@ -73,7 +73,7 @@ bool NotifiedWorkerThread::notifyLater(uint32_t delay, uint32_t v, bool overwrit
 int32_t NotifiedWorkerThread::runOnce()
 {
     auto n = notification;
-    enabled = false;  // Only run once per notification
+    setEnabled(false);  // Only run once per notification
     notification = 0; // clear notification
     if (n) {
         onNotify(n);
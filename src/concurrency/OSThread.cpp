@@ -16,17 +16,15 @@ bool OSThread::showWaiting = false;
 
 const OSThread *OSThread::currentThread;
 
-ThreadController mainController, timerController;
+uint32_t OSThread::lowestStackFree = UINT32_MAX;
+
+PriorityController mainController, timerController;
 InterruptableDelay mainDelay;
 
-void OSThread::setup()
-{
-    mainController.ThreadName = "mainController";
-    timerController.ThreadName = "timerController";
-}
+void OSThread::setup() {}
 
-OSThread::OSThread(const char *_name, uint32_t period, ThreadController *_controller)
-    : Thread(NULL, period), controller(_controller)
+OSThread::OSThread(const char *_name, uint32_t period, PriorityController *_controller)
+    : Thread(NULL, period), controller(_controller), changeListed(0)
 {
     assertIsSetup();
 
@@ -54,11 +52,53 @@ void OSThread::setIntervalFromNow(unsigned long _interval)
 
     // Cache the next run based on the last_run
     _cached_next_run = millis() + interval;
+    rescheduled();
+}
+
+void OSThread::setInterval(unsigned long _interval)
+{
+    Thread::setInterval(_interval);
+
+    // So the scheduler doesn't think we are late if we were idle a long time before being asked to run
+    unsigned long now = millis();
+    if ((int32_t)(_cached_next_run - now) < 0)
+        _cached_next_run = now;
+    rescheduled();
+}
+
+IRAM_ATTR void OSThread::setEnabled(bool e)
+{
+    enabled = e;
+    rescheduled();
+}
+
+IRAM_ATTR void OSThread::rescheduled()
+{
+    if (controller)
+        controller->noteChanged(this);
+}
+
+IRAM_ATTR void OSThread::wakeFromISR(BaseType_t *higherPriWoken)
+{
+    if (!wakeRequested) { // Interrupts can be frequent (i.e. one per serial character), only wake the main loop once
+        wakeRequested = true;
+        rescheduled();
+        mainDelay.interruptFromISR(higherPriWoken);
+    }
+}
+
+void OSThread::wake()
+{
+    if (!wakeRequested) {
+        wakeRequested = true;
+        rescheduled();
+        mainDelay.interrupt();
+    }
 }
 
 bool OSThread::shouldRun(unsigned long time)
 {
-    bool r = Thread::shouldRun(time);
+    bool r = Thread::shouldRun(time) || (enabled && wakeRequested);
 
     if (showRun && r)
         DEBUG_MSG("Thread %s: run\n", ThreadName.c_str());
@@ -75,7 +115,24 @@ bool OSThread::shouldRun(unsigned long time)
 void OSThread::run()
 {
     currentThread = this;
+    wakeRequested = false; // If we are woken again while running, we will run again
+    uint32_t start = micros();
     auto newDelay = runOnce();
+    uint32_t elapsed = micros() - start;
+
+    threadStats.runs++;
+    threadStats.totalUsec += elapsed;
+    if (elapsed > threadStats.maxUsec)
+        threadStats.maxUsec = elapsed;
+
+#ifdef HAS_FREE_RTOS
+    // All our threads share one FreeRTOS task, so blame whoever pushes its stack high water mark deeper
+    uint32_t stackFree = uxTaskGetStackHighWaterMark(NULL) * sizeof(StackType_t);
+    if (stackFree < lowestStackFree) {
+        lowestStackFree = stackFree;
+        threadStats.stackFree = stackFree;
+    }
+#endif
 
     runned();
 
@@ -1,16 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <stdint.h>
 
 #include "Thread.h"
-#include "ThreadController.h"
+#include "concurrency/DueHeap.h"
 #include "concurrency/InterruptableDelay.h"
+#include "concurrency/PriorityController.h"
 
 namespace concurrency
 {
 
-extern ThreadController mainController, timerController;
+extern PriorityController mainController, timerController;
 extern InterruptableDelay mainDelay;
 
 #define RUN_SAME -1
@@ -26,11 +28,27 @@ extern InterruptableDelay mainDelay;
  * remove lock/lockguard
  *
  * move typedQueue into concurrency
- * remove freertos from typedqueue
  */
-class OSThread : public Thread
+class OSThread : public Thread, public DueHeapItem
 {
-    ThreadController *controller;
+    PriorityController *controller;
+
+    /// Taken out of our controller's heap to run in its current pass
+    bool inPass = false;
+
+    /// Non zero while we are on our controller's list of threads whose schedule changed
+    std::atomic<uint32_t> changeListed;
+
+    /// The next thread on that list
+    OSThread *nextChanged = NULL;
+
+    /// Set by wakeFromISR, cleared just before we run
+    volatile bool wakeRequested = false;
+
+    /// The least stack anyone has left free on the task which runs our threads (see threadStats.stackFree)
+    static uint32_t lowestStackFree;
+
+    friend class PriorityController;
 
     /// Show debugging info for disabled threads
     static bool showDisabled;
@@ -45,7 +63,18 @@ class OSThread : public Thread
     /// For debug printing only (might be null)
     static const OSThread *currentThread;
 
-    OSThread(const char *name, uint32_t period = 0, ThreadController *controller = &mainController);
+    /// How this thread has behaved since boot, to find what is using our CPU time (and keeping us out of sleep)
+    struct Stats {
+        uint32_t runs;
+        uint32_t totalUsec;   // time spent in runOnce
+        uint32_t maxUsec;     // the longest single runOnce
+        uint32_t missed;      // runs which started more than THREAD_DEADLINE_SLACK_MSECS after we were due
+        uint32_t maxLateMsec; // the latest we ever started
+        uint32_t wakeups;     // times the CPU woke from its delay in loop() just to run us
+        uint32_t stackFree;   // bytes of stack left when we pushed the high water mark deeper than anyone else (0 if never)
+    } threadStats = {};
+
+    OSThread(const char *name, uint32_t period = 0, PriorityController *controller = &mainController);
 
     virtual ~OSThread();
 
@@ -58,7 +87,43 @@ class OSThread : public Thread
      */
     void setIntervalFromNow(unsigned long _interval);
 
+    /**
+     * Wait a specified number msecs starting from the last time we were run.  If that time has already passed we are due
+     * now (not overdue - we were only just asked to run).
+     */
+    virtual void setInterval(unsigned long _interval);
+
+    /// @return the millis() value when we next want to run
+    unsigned long getNextRun() const { return _cached_next_run; }
+
+    /// @return how many msecs until we want to run (negative if we are overdue, 0 if we were woken), ignoring enabled
+    int32_t msecsUntilRun(uint32_t now) const
+    {
+        int32_t d = _cached_next_run - now;
+        return (wakeRequested && d > 0) ? 0 : d;
+    }
+
+    /**
+     * Run us as soon as possible (if we are enabled) rather than waiting for our interval, i.e. because an interrupt says
+     * we have data.  Safe to call from an ISR, and unlike setInterval(0) it isn't lost if it happens while we are in runOnce.
+     */
+    void wakeFromISR(BaseType_t *higherPriWoken);
+
+    /// Like wakeFromISR, for when we aren't in an ISR (i.e. another thread just gave us work)
+    void wake();
+
+    ThreadPriority getPriority() const { return priority; }
+
+    /**
+     * Start or stop running us.  Always use this rather than setting Thread::enabled directly, because our controller only
+     * looks at threads it has been told about.  Safe to call from an ISR.
+     */
+    void setEnabled(bool e);
+
   protected:
+    /// Which threads run first when several are due at once, subclasses can change this in their constructor
+    ThreadPriority priority = THREAD_PRIORITY_NORMAL;
+
     /**
      * The method that will be called each time our thread gets a chance to run
      *
@@ -68,6 +133,10 @@ class OSThread : public Thread
 
     // Do not override this
     virtual void run();
+
+  private:
+    /// Tell our controller that when (or whether) we want to run has changed
+    void rescheduled();
 };
 
 /**
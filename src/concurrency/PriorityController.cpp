@@ -0,0 +1,271 @@
+#include "concurrency/PriorityController.h"
+#include "Metrics.h"
+#include "concurrency/OSThread.h"
+#include "configuration.h"
+#include <algorithm>
+
+namespace concurrency
+{
+
+bool PriorityController::runsAfter(const ReadyThread &a, const ReadyThread &b)
+{
+    if (a.priority != b.priority)
+        return a.priority > b.priority;
+
+    // Within a class, whoever was due first goes first (a signed difference, in case millis() wrapped)
+    return (int32_t)(a.dueAt - b.dueAt) > 0;
+}
+
+bool PriorityController::add(OSThread *t)
+{
+    if (std::find(threads.begin(), threads.end(), t) != threads.end())
+        return false;
+
+    threads.push_back(t);
+    reschedule(t, millis());
+    return true;
+}
+
+void PriorityController::remove(OSThread *t)
+{
+    applyChanges(millis()); // so t isn't left on our changed list
+
+    auto i = std::find(threads.begin(), threads.end(), t);
+    if (i != threads.end())
+        threads.erase(i);
+    waiting.remove(t);
+
+    // In case someone removes a thread in the middle of a pass
+    auto r = std::find_if(ready.begin(), ready.end(), [t](const ReadyThread &e) { return e.thread == t; });
+    if (r != ready.end()) {
+        ready.erase(r);
+        std::make_heap(ready.begin(), ready.end(), runsAfter);
+    }
+    auto d = std::find(done.begin(), done.end(), t);
+    if (d != done.end())
+        done.erase(d);
+    t->inPass = false;
+}
+
+IRAM_ATTR void PriorityController::noteChanged(OSThread *t)
+{
+    if (t->changeListed.exchange(1)) // already on the list
+        return;
+
+    OSThread *head = changed.load();
+    do
+        t->nextChanged = head;
+    while (!changed.compare_exchange_weak(head, t));
+}
+
+uint32_t PriorityController::dueAt(const OSThread *t, uint32_t now)
+{
+    return now + t->msecsUntilRun(now);
+}
+
+void PriorityController::reschedule(OSThread *t, uint32_t now)
+{
+    if (t->inPass) // it goes back into waiting when the pass ends
+        return;
+
+    if (!t->enabled)
+        waiting.remove(t);
+    else if (t->inHeap())
+        waiting.update(t, dueAt(t, now));
+    else
+        waiting.push(t, dueAt(t, now));
+}
+
+void PriorityController::applyChanges(uint32_t now)
+{
+    OSThread *t = changed.exchange(NULL);
+    while (t) {
+        OSThread *next = t->nextChanged;
+        t->changeListed = 0; // from here on another change puts it back on the list
+        reschedule(t, now);
+        t = next;
+    }
+}
+
+void PriorityController::pushDue(uint32_t now)
+{
+    OSThread *t;
+    while ((t = static_cast<OSThread *>(waiting.top())) != NULL && (int32_t)(t->dueAt - now) <= 0) {
+        waiting.remove(t);
+        t->inPass = true;
+        ready.push_back({t, t->getPriority(), t->dueAt});
+        std::push_heap(ready.begin(), ready.end(), runsAfter);
+    }
+}
+
+void PriorityController::runThread(OSThread *t)
+{
+    uint32_t now = millis();
+
+    // Another thread might have disabled or rescheduled it since we looked
+    int32_t late = -t->msecsUntilRun(now);
+    if (!t->enabled || late < 0)
+        return;
+
+    ClassStats &s = stats[t->getPriority()];
+    s.runs++;
+    s.totalLateMsec += late;
+    if ((uint32_t)late > s.maxLateMsec)
+        s.maxLateMsec = late;
+    if ((uint32_t)late > t->threadStats.maxLateMsec)
+        t->threadStats.maxLateMsec = late;
+    if (late > THREAD_DEADLINE_SLACK_MSECS) {
+        s.missed++;
+        t->threadStats.missed++;
+    }
+
+    t->run();
+}
+
+long PriorityController::runOrDelay()
+{
+    uint32_t now = millis();
+    applyChanges(now);
+    ready.clear();
+    pushDue(now);
+
+    while (!ready.empty()) {
+        std::pop_heap(ready.begin(), ready.end(), runsAfter);
+        OSThread *t = ready.back().thread;
+        ready.pop_back();
+
+        runThread(t);
+        done.push_back(t);
+
+        // Before running anything else, see if t's run gave another thread work to do
+        now = millis();
+        applyChanges(now);
+        pushDue(now);
+    }
+
+    // Everyone we looked at this pass waits for their next turn
+    for (auto t : done) {
+        t->inPass = false;
+        reschedule(t, now);
+    }
+    done.clear();
+
+    // We can sleep until the soonest is due
+    nextThread = static_cast<OSThread *>(waiting.top());
+    if (!nextThread)
+        return INT32_MAX;
+
+    int32_t delay = nextThread->dueAt - now;
+    return delay < 0 ? 0 : delay;
+}
+
+void PriorityController::noteWakeup(long delayMsec, bool interrupted)
+{
+    uint32_t now = millis();
+    if (now - hourStartMsec >= 60 * 60 * 1000UL) {
+        wakeupsLastHour = wakeupsThisHour;
+        wakeupsThisHour = 0;
+        hourStartMsec = now;
+    }
+
+    if (delayMsec <= 0) // We didn't sleep
+        return;
+
+    wakeupsThisHour++;
+
+    if (interrupted)
+        interruptWakeups++;
+    else if (nextThread)
+        nextThread->threadStats.wakeups++;
+}
+
+void PriorityController::printThreadStats()
+{
+    DEBUG_MSG("%-16s %8s %10s %8s %6s %8s %7s %6s\n", "thread", "runs", "total_us", "max_us", "missed", "late_ms", "wakeups",
+              "stack");
+    for (auto t : threads) {
+        const OSThread::Stats &s = t->threadStats;
+        DEBUG_MSG("%-16.16s %8u %10u %8u %6u %8u %7u %6u\n", t->ThreadName.c_str(), s.runs, s.totalUsec, s.maxUsec, s.missed,
+                  s.maxLateMsec, s.wakeups, s.stackFree);
+    }
+    DEBUG_MSG("%u wakeups by interrupts, %u wakeups in the last hour\n", interruptWakeups, wakeupsLastHour);
+}
+
+const char *PriorityController::className(ThreadPriority p)
+{
+    switch (p) {
+    case THREAD_PRIORITY_RADIO:
+        return "radio";
+    case THREAD_PRIORITY_NORMAL:
+        return "normal";
+    case THREAD_PRIORITY_BACKGROUND:
+        return "background";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * The main controller's stats, as families labelled by thread name or priority class
+ */
+class SchedulerMetrics : public MetricCollector
+{
+    static void threadFamily(MetricWriter &w, const char *name, const char *help, MetricType type,
+                             uint32_t OSThread::Stats::*field)
+    {
+        w.begin(name, help, type);
+        for (auto t : mainController.getThreads())
+            w.value(t->threadStats.*field, "thread", t->ThreadName.c_str());
+        w.end();
+    }
+
+    static void classFamily(MetricWriter &w, const char *name, const char *help, MetricType type,
+                            uint32_t PriorityController::ClassStats::*field)
+    {
+        w.begin(name, help, type);
+        for (int c = 0; c < THREAD_PRIORITY_COUNT; c++)
+            w.value(mainController.stats[c].*field, "class", PriorityController::className((ThreadPriority)c));
+        w.end();
+    }
+
+    static void single(MetricWriter &w, const char *name, const char *help, MetricType type, uint32_t v)
+    {
+        w.begin(name, help, type);
+        w.value(v);
+        w.end();
+    }
+
+  public:
+    virtual void collect(MetricWriter &w)
+    {
+        threadFamily(w, "thread_runs_total", "Times each thread has run", METRIC_COUNTER, &OSThread::Stats::runs);
+        threadFamily(w, "thread_usec_total", "Time each thread has spent running", METRIC_COUNTER, &OSThread::Stats::totalUsec);
+        threadFamily(w, "thread_max_usec", "The longest each thread has run for", METRIC_GAUGE, &OSThread::Stats::maxUsec);
+        threadFamily(w, "thread_missed_total", "Runs of each thread which started late", METRIC_COUNTER,
+                     &OSThread::Stats::missed);
+        threadFamily(w, "thread_max_late_msec", "The latest each thread has started", METRIC_GAUGE,
+                     &OSThread::Stats::maxLateMsec);
+        threadFamily(w, "thread_wakeups_total", "Times the CPU woke just to run each thread", METRIC_COUNTER,
+                     &OSThread::Stats::wakeups);
+        threadFamily(w, "thread_stack_free_bytes", "Stack left when each thread last set a new high water mark",
+                     METRIC_GAUGE, &OSThread::Stats::stackFree);
+
+        classFamily(w, "scheduler_runs_total", "Thread runs in each priority class", METRIC_COUNTER,
+                    &PriorityController::ClassStats::runs);
+        classFamily(w, "scheduler_missed_total", "Thread runs in each priority class which started late", METRIC_COUNTER,
+                    &PriorityController::ClassStats::missed);
+        classFamily(w, "scheduler_late_msec_total", "How late runs in each priority class started, added up", METRIC_COUNTER,
+                    &PriorityController::ClassStats::totalLateMsec);
+        classFamily(w, "scheduler_max_late_msec", "The latest any run in each priority class started", METRIC_GAUGE,
+                    &PriorityController::ClassStats::maxLateMsec);
+
+        single(w, "scheduler_interrupt_wakeups_total", "Times an interrupt woke the CPU", METRIC_COUNTER,
+               mainController.interruptWakeups);
+        single(w, "scheduler_wakeups_last_hour", "CPU wakeups during the last complete hour", METRIC_GAUGE,
+               mainController.wakeupsLastHour);
+    }
+};
+
+static SchedulerMetrics schedulerMetrics;
+
+} // namespace concurrency
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "concurrency/DueHeap.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace concurrency
+{
+
+class OSThread;
+
+/// When several threads are due at once, those with a lower priority value run first
+enum ThreadPriority {
+    THREAD_PRIORITY_RADIO,      // the radio and router, which keep packets moving
+    THREAD_PRIORITY_NORMAL,     // everything else
+    THREAD_PRIORITY_BACKGROUND, // the screen, telemetry and housekeeping, which can wait a little
+    THREAD_PRIORITY_COUNT
+};
+
+/// A thread which starts running more than this many msecs after it was due has missed its deadline
+#define THREAD_DEADLINE_SLACK_MSECS 10
+
+/**
+ * Runs our OSThreads, replacing ArduinoThread's ThreadController (which runs every due thread in the order they were
+ * created, so a slow screen redraw could hold up the radio).
+ *
+ * Enabled threads wait in a heap ordered by when they are next due.  Each pass we move the threads which are due into a
+ * second heap, ordered by priority and then by how long they have been due, and run the most urgent first.  After each thread
+ * runs we move over any thread which became due meanwhile (i.e. the radio was notified of a received packet while the screen
+ * was drawing), so if it is more important it goes next.  Each thread runs at most once per pass, so a busy radio can't starve
+ * everything else.
+ *
+ * So that we never have to look through all our threads, OSThread tells us (with noteChanged) whenever its interval, enabled
+ * flag or wake request changes.  That can happen in an ISR, so noteChanged just adds the thread to a lock free list, and we
+ * move it in the heap the next time we look.
+ */
+class PriorityController
+{
+  public:
+    PriorityController() : changed(NULL) {}
+
+    /// How well we are keeping up, for each priority class
+    struct ClassStats {
+        uint32_t runs;          // times a thread in this class ran
+        uint32_t missed;        // runs which started more than THREAD_DEADLINE_SLACK_MSECS late
+        uint32_t totalLateMsec; // how late all those runs started, added up
+        uint32_t maxLateMsec;   // the latest any run started
+    } stats[THREAD_PRIORITY_COUNT] = {};
+
+    /// The thread we expect to run next (for debugging, might be null)
+    OSThread *nextThread = NULL;
+
+    /// Times the CPU was woken from its delay by an interrupt (rather than by a thread's timer)
+    uint32_t interruptWakeups = 0;
+
+    /// CPU wakeups (for any reason) during the last complete hour, to check that an idle node really is idle
+    uint32_t wakeupsLastHour = 0;
+
+    /// Add a thread to our list, returns false if it was already there
+    bool add(OSThread *t);
+
+    void remove(OSThread *t);
+
+    /// Called by t whenever when (or whether) it wants to run changes.  Safe to call from an ISR.
+    void noteChanged(OSThread *t);
+
+    /**
+     * Run every thread which is due, most urgent first.
+     * @return how many msecs until the next thread wants to run
+     */
+    long runOrDelay();
+
+    /**
+     * Call after sleeping for the delay runOrDelay() returned, so we know who keeps waking the CPU.
+     * @param interrupted true if we were woken early by an interrupt
+     */
+    void noteWakeup(long delayMsec, bool interrupted);
+
+    /// Print a table of our threads' OSThread::threadStats to the debug console
+    void printThreadStats();
+
+    /// @return all our threads, in the order they were added
+    const std::vector<OSThread *> &getThreads() const { return threads; }
+
+    /// @return a short name for a priority class, for reports
+    static const char *className(ThreadPriority p);
+
+  private:
+    std::vector<OSThread *> threads;
+
+    /// A thread we want to run this pass (its priority and due time are copied, because threads can reschedule each other)
+    struct ReadyThread {
+        OSThread *thread;
+        ThreadPriority priority;
+        uint32_t dueAt;
+    };
+
+    /// Our enabled threads which aren't in the current pass, soonest due first
+    DueHeap waiting;
+
+    /// Our heap of the threads to run this pass (kept as a member so we don't allocate every pass)
+    std::vector<ReadyThread> ready;
+
+    /// Threads which have left ready this pass, to go back into waiting when it ends
+    std::vector<OSThread *> done;
+
+    /// Threads which called noteChanged since we last looked, linked through OSThread::nextChanged
+    std::atomic<OSThread *> changed;
+
+    /// Heap ordering: @return true if a should run after b
+    static bool runsAfter(const ReadyThread &a, const ReadyThread &b);
+
+    /// For wakeupsLastHour
+    uint32_t wakeupsThisHour = 0, hourStartMsec = 0;
+
+    /// @return the millis() value when t next wants to run
+    static uint32_t dueAt(const OSThread *t, uint32_t now);
+
+    /// Put t in (or move it in, or take it out of) waiting, unless it is in the current pass
+    void reschedule(OSThread *t, uint32_t now);
+
+    /// Reschedule everything on our changed list
+    void applyChanges(uint32_t now);
+
+    /// Move every waiting thread which is due into ready
+    void pushDue(uint32_t now);
+
+    /// Run t (if it still wants to run) and account for how late it was
+    void runThread(OSThread *t);
+};
+
+} // namespace concurrency
@@ -482,16 +482,66 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define SERIAL0_RX_GPIO 3 // Always GPIO3 on ESP32
 #endif
 
+// How important a debug message is, the more important the lower the number
+#define DEBUG_LEVEL_NONE 0
+#define DEBUG_LEVEL_ERROR 1
+#define DEBUG_LEVEL_WARN 2
+#define DEBUG_LEVEL_INFO 3
+#define DEBUG_LEVEL_DEBUG 4
+
+// The least important messages we compile in, i.e. build with -DDEBUG_LEVEL_DEFAULT=DEBUG_LEVEL_WARN for production
+#ifndef DEBUG_LEVEL_DEFAULT
+#define DEBUG_LEVEL_DEFAULT DEBUG_LEVEL_DEBUG
+#endif
+
+// Levels for our chattiest subsystems, which can be turned down separately (i.e. -DDEBUG_LEVEL_RADIO=DEBUG_LEVEL_ERROR)
+#ifndef DEBUG_LEVEL_RADIO
+#define DEBUG_LEVEL_RADIO DEBUG_LEVEL_DEFAULT
+#endif
+#ifndef DEBUG_LEVEL_ROUTER
+#define DEBUG_LEVEL_ROUTER DEBUG_LEVEL_DEFAULT
+#endif
+#ifndef DEBUG_LEVEL_GPS
+#define DEBUG_LEVEL_GPS DEBUG_LEVEL_DEFAULT
+#endif
+#ifndef DEBUG_LEVEL_PLUGINS
+#define DEBUG_LEVEL_PLUGINS DEBUG_LEVEL_DEFAULT
+#endif
+#ifndef DEBUG_LEVEL_SCREEN
+#define DEBUG_LEVEL_SCREEN DEBUG_LEVEL_DEFAULT
+#endif
+
+// The level for the file being compiled.  A file which belongs to one of the subsystems above says so after its includes with
+//   #undef DEBUG_LEVEL_FILE
+//   #define DEBUG_LEVEL_FILE DEBUG_LEVEL_ROUTER
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_DEFAULT
+
 #ifdef USE_SEGGER
-#define DEBUG_MSG(...) SEGGER_RTT_printf(0, __VA_ARGS__)
-#else
-#ifdef DEBUG_PORT
-#define DEBUG_MSG(...) DEBUG_PORT.logDebug(__VA_ARGS__)
-#else
-#define DEBUG_MSG(...)
+#define LOG_WRITE(...) SEGGER_RTT_printf(0, __VA_ARGS__)
+#elif defined(DEBUG_PORT) && defined(BINARY_LOG)
+// Record messages in binary, for bin/log_decoder.py to turn back into text (see BinaryLog.h)
+#include "BinaryLog.h"
+#define LOG_WRITE(...) binaryLog.log(__VA_ARGS__)
+#elif defined(DEBUG_PORT)
+#define LOG_WRITE(...) DEBUG_PORT.logDebug(__VA_ARGS__)
 #endif
+
+#ifdef LOG_WRITE
+// Messages less important than DEBUG_LEVEL_FILE are compiled out
+#define LEVEL_MSG(level, ...)                                                                                                    \
+    do {                                                                                                                         \
+        if ((level) <= DEBUG_LEVEL_FILE)                                                                                         \
+            LOG_WRITE(__VA_ARGS__);                                                                                              \
+    } while (0)
+#else
+#define LEVEL_MSG(level, ...)
 #endif
 
+#define ERROR_MSG(...) LEVEL_MSG(DEBUG_LEVEL_ERROR, __VA_ARGS__)
+#define WARN_MSG(...) LEVEL_MSG(DEBUG_LEVEL_WARN, __VA_ARGS__)
+#define INFO_MSG(...) LEVEL_MSG(DEBUG_LEVEL_INFO, __VA_ARGS__)
+#define DEBUG_MSG(...) LEVEL_MSG(DEBUG_LEVEL_DEBUG, __VA_ARGS__)
+
 // -----------------------------------------------------------------------------
 // AXP192 (Rev1-specific options)
 // -----------------------------------------------------------------------------
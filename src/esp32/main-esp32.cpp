@@ -1,4 +1,5 @@
 #include "BluetoothSoftwareUpdate.h"
+#include "Metrics.h"
 #include "PowerFSM.h"
 #include "configuration.h"
 #include "esp_task_wdt.h"
@@ -11,6 +12,10 @@
 #include <nvs_flash.h>
 #include <driver/rtc_io.h>
 
+static Gauge heapFree("heap_free_bytes", "Free heap", []() { return (int32_t)ESP.getFreeHeap(); });
+static Gauge heapMinFree("heap_min_free_bytes", "The least free heap we have had since boot",
+                         []() { return (int32_t)ESP.getMinFreeHeap(); });
+
 void getMacAddr(uint8_t *dmac)
 {
     assert(esp_efuse_mac_get_default(dmac) == ESP_OK);
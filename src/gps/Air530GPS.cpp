@@ -1,6 +1,9 @@
 #include "Air530GPS.h"
 #include <assert.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_GPS
+
 /*
 Helpful translations from the Air530 GPS datasheet
 
@@ -1,11 +1,15 @@
 
 #include "GPS.h"
+#include "MeshService.h"
 #include "NodeDB.h"
 #include "RTC.h"
 #include "configuration.h"
 #include "sleep.h"
 #include <assert.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_GPS
+
 // If we have a serial GPS port it will not be null
 #ifdef GPS_RX_PIN
 HardwareSerial _serial_gps_real(GPS_SERIAL_NUM);
@@ -25,6 +29,13 @@ uint8_t GPS::i2cAddress = 0;
 
 GPS *gps;
 
+/// How often we check on the GPS while it is looking for a fix
+#ifndef NO_ESP32
+#define GPS_AWAKE_POLL_MSECS 1000 // our 2KB receive buffer holds about 2 secs of data at 9600 baud
+#else
+#define GPS_AWAKE_POLL_MSECS 100 // 9600bps is approx 1 byte per msec, and our receive buffer is small
+#endif
+
 /// Multiple GPS instances might use the same serial port (in sequence), but we can 
 /// only init that port once.
 static bool didSerialInit;
@@ -68,6 +79,7 @@ bool GPS::setup()
     if (ok) {
         notifySleepObserver.observe(&notifySleep);
         notifyDeepSleepObserver.observe(&notifyDeepSleep);
+        configChangedObserver.observe(&service.configChanged);
     }
 
     return ok;
@@ -127,6 +139,12 @@ void GPS::setAwake(bool on)
         DEBUG_MSG("WANT GPS=%d\n", on);
         if (on) {
             lastWakeStartMsec = millis();
+
+            // Anything the GPS sent while we weren't listening is stale
+            if (_serial_gps)
+                while (_serial_gps->available())
+                    _serial_gps->read();
+
             wake();
         } else {
             lastSleepStartMsec = millis();
@@ -261,9 +279,19 @@ int32_t GPS::runOnce()
     // If state has changed do a publish
     publishUpdate();
 
-    // 9600bps is approx 1 byte per msec, so considering our buffer size we never need to wake more often than 200ms
-    // if not awake we can run super infrquently (once every 5 secs?) to see if we need to wake.
-    return isAwake ? 100 : 5000;
+    if (isAwake)
+        return GPS_AWAKE_POLL_MSECS;
+
+    // Otherwise sleep until our next acquisition attempt (onConfigChanged and forceWake reschedule us if things change)
+    sleepTime = getSleepTime();
+    if (sleepTime == UINT32_MAX)
+        return INT32_MAX;
+
+    uint32_t asleepFor = millis() - lastSleepStartMsec;
+    if (asleepFor <= sleepTime)
+        return min(sleepTime - asleepFor + 1, (uint32_t)INT32_MAX);
+
+    return 5000; // We are overdue but not allowed to wake, check again later
 }
 
 void GPS::forceWake(bool on)
@@ -272,6 +300,7 @@ void GPS::forceWake(bool on)
         DEBUG_MSG("Allowing GPS lock\n");
         // lastSleepStartMsec = 0; // Force an update ASAP
         wakeAllowed = true;
+        setIntervalFromNow(0); // See if an acquisition is due
     } else {
         wakeAllowed = false;
 
@@ -281,6 +310,12 @@ void GPS::forceWake(bool on)
     }
 }
 
+int GPS::onConfigChanged(void *unused)
+{
+    setIntervalFromNow(0);
+    return 0;
+}
+
 /// Prepare the GPS for the cpu entering deep or light sleep, expect to be gone for at least 100s of msecs
 int GPS::prepareSleep(void *unused)
 {
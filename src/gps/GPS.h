@@ -31,6 +31,7 @@ class GPS : private concurrency::OSThread
 
     CallbackObserver<GPS, void *> notifySleepObserver = CallbackObserver<GPS, void *>(this, &GPS::prepareSleep);
     CallbackObserver<GPS, void *> notifyDeepSleepObserver = CallbackObserver<GPS, void *>(this, &GPS::prepareDeepSleep);
+    CallbackObserver<GPS, void *> configChangedObserver = CallbackObserver<GPS, void *>(this, &GPS::onConfigChanged);
 
   public:
     /** If !NULL we will use this serial port to construct our GPS */
@@ -120,6 +121,9 @@ class GPS : private concurrency::OSThread
     /// always returns 0 to indicate okay to sleep
     int prepareDeepSleep(void *unused);
 
+    /// Our update interval might have changed, so recalculate when we next need to run
+    int onConfigChanged(void *unused);
+
     /**
      * Switch the GPS into a mode where we are actively looking for a lock, or alternatively switch GPS into a low power mode
      *
@@ -2,6 +2,9 @@
 #include "RTC.h"
 #include "configuration.h"
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_GPS
+
 static int32_t toDegInt(RawDegrees d)
 {
     int32_t degMult = 10000000; // 1e7
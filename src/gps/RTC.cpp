@@ -3,6 +3,9 @@
 #include <sys/time.h>
 #include <time.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_GPS
+
 static RTCQuality currentQuality = RTCQualityNone;
 
 RTCQuality getRTCQuality()
@@ -52,7 +55,7 @@ bool perhapsSetRTC(RTCQuality q, const struct timeval *tv)
 #ifndef NO_ESP32
         settimeofday(tv, NULL);
 #else
-        DEBUG_MSG("ERROR TIME SETTING NOT IMPLEMENTED!\n");
+        ERROR_MSG("ERROR TIME SETTING NOT IMPLEMENTED!\n");
 #endif
         readFromRTC();
         return true;
@@ -4,6 +4,9 @@
 #include "sleep.h"
 #include <assert.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_GPS
+
 UBloxGPS::UBloxGPS() {}
 
 bool UBloxGPS::tryConnect()
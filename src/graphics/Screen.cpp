@@ -40,6 +40,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mesh/http/WiFiAPClient.h"
 #endif
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_SCREEN
+
 using namespace meshtastic; /** @todo remove */
 
 namespace graphics
@@ -688,6 +691,7 @@ void _screen_header()
 Screen::Screen(uint8_t address, int sda, int scl) : OSThread("Screen"), cmdQueue(32), dispdev(address, sda, scl), ui(&dispdev)
 {
     cmdQueue.setReader(this);
+    priority = concurrency::THREAD_PRIORITY_BACKGROUND; // Redraws can be slow, let the radio go first
 }
 
 /**
@@ -715,12 +719,12 @@ void Screen::handleSetOn(bool on)
             DEBUG_MSG("Turning on screen\n");
             dispdev.displayOn();
             dispdev.displayOn();
-            enabled = true;
+            setEnabled(true);
             setInterval(0); // Draw ASAP
         } else {
             DEBUG_MSG("Turning off screen\n");
             dispdev.displayOff();
-            enabled = false;
+            setEnabled(false);
         }
         screenOn = on;
     }
@@ -806,7 +810,7 @@ int32_t Screen::runOnce()
 {
     // If we don't have a screen, don't ever spend any CPU for us.
     if (!useDisplay) {
-        enabled = false;
+        setEnabled(false);
         return RUN_SAME;
     }
 
@@ -821,7 +825,7 @@ int32_t Screen::runOnce()
     // Process incoming commands.
     for (;;) {
         ScreenCmd cmd;
-        if (!cmdQueue.dequeue(&cmd, 0)) {
+        if (!cmdQueue.dequeue(&cmd)) {
             break;
         }
         switch (cmd.cmd) {
@@ -855,7 +859,7 @@ int32_t Screen::runOnce()
 
     if (!screenOn) { // If we didn't just wake and the screen is still off, then
                      // stop updating until it is on again
-        enabled = false;
+        setEnabled(false);
         return 0;
     }
 
@@ -918,7 +922,8 @@ void Screen::setFrames()
     DEBUG_MSG("Total frame count: %d\n", totalFrameCount);
 
     // We don't show the node info our our node (if we have it yet - we should)
-    size_t numnodes = nodeStatus->getNumTotal();
+    // Note: we only show the nodes we have in RAM (nodeStatus also counts the ones we've evicted to flash)
+    size_t numnodes = nodeDB.getNumNodes();
     if (numnodes > 0)
         numnodes--;
 
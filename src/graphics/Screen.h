@@ -221,8 +221,8 @@ class Screen : public concurrency::OSThread
         if (!useDisplay)
             return true; // claim success if our display is not in use
         else {
-            bool success = cmdQueue.enqueue(cmd, 0);
-            enabled = true; // handle ASAP (we are the registered reader for cmdQueue, but might have been disabled)
+            bool success = cmdQueue.enqueue(cmd);
+            setEnabled(true); // handle ASAP (we are the registered reader for cmdQueue, but might have been disabled)
             return success;
         }
     }
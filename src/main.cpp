@@ -327,6 +327,10 @@ void setup()
 
     OSThread::setup();
 
+#ifdef BINARY_LOG
+    binaryLog.begin(); // Start sending what we've logged so far
+#endif
+
     ledPeriodic = new Periodic("Blink", ledBlinker);
 
     fsInit();
@@ -591,7 +595,7 @@ void loop()
     static uint32_t lastPrint = 0;
     if (millis() - lastPrint > 10 * 1000L) {
         lastPrint = millis();
-        meshtastic::printThreadInfo("main");
+        mainController.printThreadStats();
     }
 #endif
 
@@ -602,11 +606,19 @@ void loop()
 
     long delayMsec = mainController.runOrDelay();
 
+#ifdef DEBUG_PORT
+    // Don't sleep past when the serial API must send a batch of frames it is holding
+    int32_t flushMsec = DEBUG_PORT.msecsUntilFlush();
+    if (flushMsec < delayMsec)
+        delayMsec = flushMsec;
+#endif
+
     /* if (mainController.nextThread && delayMsec)
         DEBUG_MSG("Next %s in %ld\n", mainController.nextThread->ThreadName.c_str(),
                   mainController.nextThread->tillRun(millis())); */
 
     // We want to sleep as long as possible here - because it saves power
-    mainDelay.delay(delayMsec);
+    bool interrupted = !mainDelay.delay(delayMsec);
+    mainController.noteWakeup(delayMsec, interrupted);
     // if (didWake) DEBUG_MSG("wake!\n");
 }
@@ -0,0 +1,152 @@
+#include "ColdNodeStore.h"
+#include "FSCommon.h"
+#include "configuration.h"
+#include <assert.h>
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+#define COLD_DIR "/nodes"
+
+/// Fill buf with the filename we use for the record of node n
+static void coldFilename(char *buf, NodeNum n)
+{
+    sprintf(buf, COLD_DIR "/%08x", n);
+}
+
+void ColdNodeStore::init()
+{
+    numStored = 0;
+#ifdef FS
+    FS.mkdir(COLD_DIR);
+
+    File dir = FS.open(COLD_DIR);
+    if (!dir)
+        return;
+
+    File f = dir.openNextFile();
+    while (f) {
+        // Depending on the filesystem name might or might not include the directory
+        const char *name = f.name();
+        const char *slash = strrchr(name, '/');
+        NodeNum n = strtoul(slash ? slash + 1 : name, NULL, 16);
+        f.close();
+
+        if (n && numStored < MAX_NUM_COLD_NODES)
+            nums[numStored++] = n;
+
+        f = dir.openNextFile();
+    }
+    dir.close();
+
+    DEBUG_MSG("Found %d evicted nodes in flash\n", numStored);
+#endif
+}
+
+int ColdNodeStore::find(NodeNum n) const
+{
+    for (size_t i = 0; i < numStored; i++)
+        if (nums[i] == n)
+            return i;
+
+    return -1;
+}
+
+void ColdNodeStore::store(const NodeInfo &info)
+{
+#ifdef FS
+    int x = find(info.num);
+    if (x >= 0) // we are about to replace the old record, so remove it from our list
+        removeAt(x);
+    else if (numStored == MAX_NUM_COLD_NODES) {
+        DEBUG_MSG("Cold node store full, forgetting node 0x%x\n", nums[0]);
+        removeAt(0);
+    }
+
+    uint8_t buf[NodeInfo_size];
+    size_t len = pb_encode_to_bytes(buf, sizeof(buf), NodeInfo_fields, &info);
+
+    char filename[32];
+    coldFilename(filename, info.num);
+    FS.remove(filename); // Some filesystems append if the file already exists
+
+    auto f = FS.open(filename, FILE_O_WRITE);
+    if (f) {
+        bool ok = f.write(buf, len) == len;
+        f.close();
+
+        if (ok) {
+            nums[numStored++] = info.num;
+            return;
+        }
+    }
+
+    DEBUG_MSG("Error: can't write evicted node 0x%x\n", info.num);
+    FS.remove(filename);
+#endif
+}
+
+bool ColdNodeStore::take(NodeNum n, NodeInfo *dest)
+{
+    int x = find(n);
+    if (x < 0)
+        return false;
+
+    bool ok = read(n, dest);
+    removeAt(x);
+    return ok;
+}
+
+bool ColdNodeStore::readByIndex(size_t x, NodeInfo *dest)
+{
+    assert(x < numStored);
+    return read(nums[x], dest);
+}
+
+void ColdNodeStore::forget(NodeNum n)
+{
+    int x = find(n);
+    if (x >= 0)
+        removeAt(x);
+}
+
+void ColdNodeStore::clear()
+{
+    while (numStored)
+        removeAt(numStored - 1);
+}
+
+void ColdNodeStore::removeAt(size_t x)
+{
+    assert(x < numStored);
+
+#ifdef FS
+    char filename[32];
+    coldFilename(filename, nums[x]);
+    FS.remove(filename);
+#endif
+
+    numStored--;
+    memmove(&nums[x], &nums[x + 1], (numStored - x) * sizeof(nums[0]));
+}
+
+bool ColdNodeStore::read(NodeNum n, NodeInfo *dest)
+{
+#ifdef FS
+    char filename[32];
+    coldFilename(filename, n);
+
+    auto f = FS.open(filename);
+    if (f) {
+        uint8_t buf[NodeInfo_size];
+        int len = f.read(buf, sizeof(buf));
+        f.close();
+
+        memset(dest, 0, sizeof(*dest));
+        if (len > 0 && pb_decode_from_bytes(buf, len, NodeInfo_fields, dest))
+            return true;
+    }
+
+    DEBUG_MSG("Error: can't read evicted node 0x%x\n", n);
+#endif
+    return false;
+}
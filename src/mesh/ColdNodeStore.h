@@ -0,0 +1,63 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "mesh-pb-constants.h"
+
+/// The max number of nodes we will remember in flash (after they have been evicted from the in RAM node DB)
+#ifndef MAX_NUM_COLD_NODES
+#define MAX_NUM_COLD_NODES 256
+#endif
+
+/**
+ * A flash backed 'cold tier' for NodeInfo records which have been evicted from the (small) in RAM NodeDB.
+ *
+ * Each record is stored as a NodeInfo protobuf in its own small file (named by nodenum) in the /nodes directory.  This keeps
+ * the implementation portable across SPIFFS, LittleFS and the portduino filesystem (and lets the filesystem worry about wear
+ * leveling).  We keep a small in RAM list of which nodenums are in the cold tier, so we only touch flash when we actually need
+ * to page a record in or out.
+ *
+ * Note: none of these methods are ISR safe, they should only be called from the main thread.
+ */
+class ColdNodeStore
+{
+    /// The nodenums we have stored in flash, oldest evictions first
+    NodeNum nums[MAX_NUM_COLD_NODES];
+    size_t numStored = 0;
+
+  public:
+    /// Scan flash to find which records we have, call after the filesystem is mounted
+    void init();
+
+    /// @return the number of records in the cold tier
+    size_t count() const { return numStored; }
+
+    /// @return true if we have a stored record for this node
+    bool contains(NodeNum n) const { return find(n) >= 0; }
+
+    /// Write a record to flash.  If we are full, the oldest evicted record is discarded to make room.
+    void store(const NodeInfo &info);
+
+    /** Page a record back in from flash, removing it from the cold tier
+     * @return true if the record was found and decoded into dest
+     */
+    bool take(NodeNum n, NodeInfo *dest);
+
+    /// Read the x'th stored record (without removing it) @return true for success
+    bool readByIndex(size_t x, NodeInfo *dest);
+
+    /// Discard the stored record for n (if we have one)
+    void forget(NodeNum n);
+
+    /// Forget all stored records (i.e. for factory reset)
+    void clear();
+
+  private:
+    /// @return the index of n in nums, or -1 if not found
+    int find(NodeNum n) const;
+
+    /// Remove the x'th entry from nums and delete its file
+    void removeAt(size_t x);
+
+    /// Read and decode the record for n from flash
+    bool read(NodeNum n, NodeInfo *dest);
+};
@@ -1,6 +1,9 @@
 #include "DSRRouter.h"
 #include "configuration.h"
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_ROUTER
+
 /* when we receive any packet
 
 - sniff and update tables (especially useful to find adjacent nodes). Update user, network and position info.
@@ -2,6 +2,9 @@
 #include "configuration.h"
 #include "mesh-pb-constants.h"
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_ROUTER
+
 FloodingRouter::FloodingRouter() {}
 
 /**
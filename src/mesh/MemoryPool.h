@@ -101,13 +101,12 @@ template <class T> class MemoryPool : public Allocator<T>
     /// Return a buffer for use by others
     virtual void release(T *p)
     {
-        assert(dead.enqueue(p, 0));
+        assert(dead.enqueue(p));
         assert(p >= buf &&
                (size_t)(p - buf) <
                    maxElements); // sanity check to make sure a programmer didn't free something that didn't come from this pool
     }
 
-#ifdef HAS_FREE_RTOS
     /// Return a buffer from an ISR, if higherPriWoken is set to true you have some work to do ;-)
     void releaseFromISR(T *p, BaseType_t *higherPriWoken)
     {
@@ -116,10 +115,9 @@ template <class T> class MemoryPool : public Allocator<T>
                (size_t)(p - buf) <
                    maxElements); // sanity check to make sure a programmer didn't free something that didn't come from this pool
     }
-#endif
 
   protected:
-    /// Return a queable object which has been prefilled with zeros - allow timeout to wait for available buffers (you
-    /// probably don't want this version).
-    virtual T *alloc(TickType_t maxWait) { return dead.dequeuePtr(maxWait); }
+    /// Return a queable object which has been prefilled with zeros - our queue never blocks, so maxWait is ignored and we
+    /// return NULL if the pool is empty
+    virtual T *alloc(TickType_t maxWait) { return dead.dequeuePtr(); }
 };
@@ -28,6 +28,9 @@ class MeshPacketQueue : public std::priority_queue<MeshPacket *, std::vector<Mes
 
     MeshPacket *dequeue();
 
+    /// @return how many more packets enqueue() would currently accept
+    size_t getFree() const { return (size() < maxLen) ? maxLen - size() : 0; }
+
     /** Attempt to find and remove a packet from this queue.  Returns true the packet which was removed from the queue */
     MeshPacket *remove(NodeNum from, PacketId id);
 };
\ No newline at end of file
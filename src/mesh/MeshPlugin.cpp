@@ -1,18 +1,65 @@
 #include "MeshPlugin.h"
 #include "MeshService.h"
+#include "Metrics.h"
 #include "NodeDB.h"
 #include <assert.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 std::vector<MeshPlugin *> *MeshPlugin::plugins;
 
+MeshPlugin::DispatchTable MeshPlugin::dispatch, MeshPlugin::promiscuousDispatch;
+
+bool MeshPlugin::dispatchDirty;
+
 const MeshPacket *MeshPlugin::currentRequest;
 
+PayloadViewCache MeshPlugin::payloadViews;
+
 /**
  * If any of the current chain of plugins has already sent a reply, it will be here.  This is useful to allow
  * the RoutingPlugin to avoid sending redundant acks
  */
  MeshPacket *MeshPlugin::currentReply;
 
+#if PLUGIN_PROFILING
+static const uint32_t dispatchBounds[] = {100, 300, 1000, 3000, 10000, 30000, 100000};
+static FixedHistogram<7> dispatchUsec("plugin_dispatch_usec", "Time spent giving each received packet to our plugins",
+                                      dispatchBounds);
+#endif
+
+/**
+ * Our plugins' stats, each as a family labelled by plugin name
+ */
+class PluginMetrics : public MetricCollector
+{
+    static void family(MetricWriter &w, const char *name, const char *help, MetricType type,
+                       uint32_t MeshPlugin::Stats::*field)
+    {
+        w.begin(name, help, type);
+        for (auto p : MeshPlugin::getPlugins())
+            w.value(p->stats.*field, "plugin", p->getName());
+        w.end();
+    }
+
+  public:
+    virtual void collect(MetricWriter &w)
+    {
+        family(w, "plugin_calls_total", "Packets given to each plugin", METRIC_COUNTER, &MeshPlugin::Stats::calls);
+        family(w, "plugin_handled_total", "Packets each plugin stopped others from seeing", METRIC_COUNTER,
+               &MeshPlugin::Stats::handled);
+        family(w, "plugin_usec_total", "Time each plugin has spent handling packets", METRIC_COUNTER,
+               &MeshPlugin::Stats::totalUsec);
+        family(w, "plugin_max_usec", "The longest each plugin has taken to handle a packet", METRIC_GAUGE,
+               &MeshPlugin::Stats::maxUsec);
+        family(w, "plugin_bytes_total", "Payload bytes given to each plugin", METRIC_COUNTER, &MeshPlugin::Stats::bytes);
+        family(w, "plugin_replies_total", "Replies each plugin generated", METRIC_COUNTER, &MeshPlugin::Stats::replies);
+    }
+};
+
+static PluginMetrics pluginMetrics;
+
 MeshPlugin::MeshPlugin(const char *_name) : name(_name)
 {
     // Can't trust static initalizer order, so we check each time
@@ -20,6 +67,7 @@ MeshPlugin::MeshPlugin(const char *_name) : name(_name)
         plugins = new std::vector<MeshPlugin *>();
 
     plugins->push_back(this);
+    dispatchDirty = true;
 }
 
 void MeshPlugin::setup() {}
@@ -33,6 +81,9 @@ void MeshPlugin::callPlugins(const MeshPacket &mp)
 {
     // DEBUG_MSG("In call plugins\n");
     bool pluginFound = false;
+#if PLUGIN_PROFILING
+    uint32_t dispatchStart = micros();
+#endif
 
     assert(mp.which_payloadVariant == MeshPacket_decoded_tag); // I think we are guarnteed the packet is decoded by this point?
 
@@ -41,17 +92,32 @@ void MeshPlugin::callPlugins(const MeshPacket &mp)
     // Was this message directed to us specifically?  Will be false if we are sniffing someone elses packets
     auto ourNodeNum = nodeDB.getNodeNum();
     bool toUs = mp.to == NODENUM_BROADCAST || mp.to == ourNodeNum;
-    for (auto i = plugins->begin(); i != plugins->end(); ++i) {
+
+    if (dispatchDirty) {
+        auto portNumOf = [](MeshPlugin *p) { return p->getPortNum(); };
+        dispatch.build(*plugins, portNumOf, [](MeshPlugin *p) { return true; });
+        promiscuousDispatch.build(*plugins, portNumOf, [](MeshPlugin *p) { return p->isPromiscuous; });
+        dispatchDirty = false;
+    }
+
+    payloadViews.beginDispatch();
+
+    // We only consider plugins that might want this portnum (and only promiscuous ones if the message isn't destined to us)
+    auto &candidates = (toUs ? dispatch : promiscuousDispatch).lookup(mp.decoded.portnum);
+    for (auto i = candidates.begin(); i != candidates.end(); ++i) {
         auto &pi = **i;
 
         pi.currentRequest = &mp;
 
-        // We only call plugins that are interested in the packet (and the message is destined to us or we are promiscious)
-        bool wantsPacket = (pi.isPromiscuous || toUs) && pi.wantPacket(&mp);
+        // We only call plugins that are interested in the packet
+        bool wantsPacket = pi.wantPacket(&mp);
         // DEBUG_MSG("Plugin %s wantsPacket=%d\n", pi.name, wantsPacket);
         if (wantsPacket) {
             pluginFound = true;
 
+#if PLUGIN_PROFILING
+            uint32_t start = micros();
+#endif
             bool handled = pi.handleReceived(mp);
 
             // Possibly send replies (but only if the message was directed to us specifically, i.e. not for promiscious sniffing)
@@ -61,8 +127,24 @@ void MeshPlugin::callPlugins(const MeshPacket &mp)
             // currently when the phone sends things, it sends things using the local node ID as the from address.  A better
             // solution (FIXME) would be to let phones have their own distinct addresses and we 'route' to them like any other
             // node.
-            if (mp.decoded.want_response && toUs && (getFrom(&mp) != ourNodeNum || mp.to == ourNodeNum) && !currentReply) {
+            bool sendingResponse =
+                mp.decoded.want_response && toUs && (getFrom(&mp) != ourNodeNum || mp.to == ourNodeNum) && !currentReply;
+            if (sendingResponse)
                 pi.sendResponse(mp);
+
+            // Account for the work before we spend time logging
+            pi.stats.calls++;
+            pi.stats.bytes += mp.decoded.payload.size;
+            if (handled)
+                pi.stats.handled++;
+#if PLUGIN_PROFILING
+            uint32_t elapsed = micros() - start;
+            pi.stats.totalUsec += elapsed;
+            if (elapsed > pi.stats.maxUsec)
+                pi.stats.maxUsec = elapsed;
+#endif
+
+            if (sendingResponse) {
                 DEBUG_MSG("Plugin %s sent a response\n", pi.name);
             } else {
                 DEBUG_MSG("Plugin %s considered\n", pi.name);
@@ -75,6 +157,11 @@ void MeshPlugin::callPlugins(const MeshPacket &mp)
 
         pi.currentRequest = NULL;
     }
+    currentRequest = NULL; // In case a plugin handled it
+    payloadViews.endDispatch();
+#if PLUGIN_PROFILING
+    dispatchUsec.observe(micros() - dispatchStart);
+#endif
 
     if(currentReply) {
         DEBUG_MSG("Sending response\n"); 
@@ -95,7 +182,8 @@ void MeshPlugin::sendResponse(const MeshPacket &req)
     auto r = allocReply();
     if (r) {
         setReplyTo(r, req);
-        currentReply = r;       
+        currentReply = r;
+        stats.replies++;
     } else {
         // Ignore - this is now expected behavior for routing plugin (because it ignores some replies)
         // DEBUG_MSG("WARNING: Client requested response but this plugin did not provide\n");
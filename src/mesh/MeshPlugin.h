@@ -1,9 +1,17 @@
 #pragma once
 
 #include "mesh/MeshTypes.h"
+#include "mesh/PayloadViewCache.h"
+#include "mesh/PortDispatchTable.h"
 #include <vector>
 #include <OLEDDisplay.h>
 #include <OLEDDisplayUi.h>
+
+/// Set to 0 to stop timing plugin handlers (we then only count calls, handled packets, bytes and replies)
+#ifndef PLUGIN_PROFILING
+#define PLUGIN_PROFILING 1
+#endif
+
 /** A baseclass for any mesh "plugin".
  *
  * A plugin allows you to add new features to meshtastic device code, without needing to know messaging details.
@@ -16,7 +24,17 @@
  */
 class MeshPlugin
 {
-  static std::vector<MeshPlugin *> *plugins;
+    static std::vector<MeshPlugin *> *plugins;
+
+    /// Which plugins callPlugins() should consider for each portnum
+    typedef PortDispatchTable<MeshPlugin> DispatchTable;
+
+    /// For packets addressed to us, and for those we are just sniffing (where only promiscuous plugins are considered)
+    static DispatchTable dispatch, promiscuousDispatch;
+
+    /// Set when a plugin is registered, our dispatch tables are rebuilt before the next packet (plugins only set their
+    /// portnum and isPromiscuous once they are fully constructed)
+    static bool dispatchDirty;
 
   public:
     /** Constructor
@@ -26,10 +44,25 @@ class MeshPlugin
 
     virtual ~MeshPlugin();
 
+    /// How much work this plugin has done since boot (see callPlugins)
+    struct Stats {
+        uint32_t calls;      // times handleReceived was called
+        uint32_t handled;    // times handleReceived returned true (stopping other plugins from seeing the packet)
+        uint32_t totalUsec;  // time spent in handleReceived and allocReply (including any nested dispatches they cause)
+        uint32_t maxUsec;    // the longest single call
+        uint32_t bytes;      // payload bytes of the packets we were given
+        uint32_t replies;    // replies allocReply generated
+    } stats = {};
+
     /** For use only by MeshService
      */
     static void callPlugins(const MeshPacket &mp);
 
+    /// @return all registered plugins, in the order they are called
+    static const std::vector<MeshPlugin *> &getPlugins() { return *plugins; }
+
+    const char *getName() const { return name; }
+
     static std::vector<MeshPlugin *> GetMeshPluginsWithUIFrames();
 
     virtual void drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state, int16_t x, int16_t y) { return; }
@@ -52,6 +85,19 @@ class MeshPlugin
      */
     static const MeshPacket *currentRequest;
 
+    /// Payloads decoded while dispatching the current packet (so each is only decoded once, see getDecodedPayload)
+    static PayloadViewCache payloadViews;
+
+    /**
+     * @return the payload of mp (which must be the packet we are dispatching) decoded as a structSize byte protobuf, or NULL
+     * if it could not be decoded.  If some other plugin already decoded it the same way, you get the same copy.  Only valid
+     * until you return from handleReceived, and must not be modified.
+     */
+    static const void *getDecodedPayload(const MeshPacket &mp, const pb_msgdesc_t *fields, size_t structSize)
+    {
+        return payloadViews.get(mp, fields, structSize);
+    }
+
     /**
      * Initialize your plugin.  This setup function is called once after all hardware and mesh protocol layers have
      * been initialized
@@ -63,6 +109,12 @@ class MeshPlugin
      */
     virtual bool wantPacket(const MeshPacket *p) = 0;
 
+    /**
+     * @return the only portnum wantPacket() will ever accept, or PORTNUM_ANY.  We only ask a plugin about packets for its
+     * portnum, so a plugin which overrides wantPacket() to accept more must also override this.
+     */
+    virtual int getPortNum() { return PORTNUM_ANY; }
+
     /** Called to handle a particular incoming message
 
     @return true if you've guaranteed you've handled this message and no other handlers should be considered for it
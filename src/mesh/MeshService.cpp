@@ -7,10 +7,13 @@
 //#include "MeshBluetoothService.h"
 #include "../concurrency/Periodic.h"
 #include "BluetoothCommon.h" // needed for updateBatteryLevel, FIXME, eventually when we pull mesh out into a lib we shouldn't be whacking bluetooth from here
+#include "FSCommon.h"
 #include "MeshService.h"
+#include "Metrics.h"
 #include "NodeDB.h"
 #include "PowerFSM.h"
 #include "RTC.h"
+#include "airtime.h"
 #include "main.h"
 #include "mesh-pb-constants.h"
 #include "plugins/NodeInfoPlugin.h"
@@ -51,7 +54,41 @@ MeshService service;
 
 #include "Router.h"
 
-MeshService::MeshService() : toPhoneQueue(MAX_RX_TOPHONE)
+/**
+ * How our queue of packets for the phone is doing, the counts are families labelled by PhonePacketClass
+ */
+class ToPhoneMetrics : public MetricCollector
+{
+    static void classFamily(MetricWriter &w, const char *name, const char *help, uint32_t PhonePacketRing::ClassStats::*field)
+    {
+        w.begin(name, help, METRIC_COUNTER);
+        for (int c = 0; c < PHONE_CLASS_COUNT; c++)
+            w.value(service.toPhoneQueue.stats[c].*field, "class", PhonePacketRing::className((PhonePacketClass)c));
+        w.end();
+    }
+
+  public:
+    virtual void collect(MetricWriter &w)
+    {
+        classFamily(w, "tophone_queued_total", "Packets queued for the phone", &PhonePacketRing::ClassStats::queued);
+        classFamily(w, "tophone_coalesced_total", "Queued packets replaced by a newer one from the same node",
+                    &PhonePacketRing::ClassStats::coalesced);
+        classFamily(w, "tophone_dropped_total", "Packets for the phone discarded because our queue was full",
+                    &PhonePacketRing::ClassStats::dropped);
+
+        w.begin("tophone_queue_length", "Packets waiting for the phone in RAM", METRIC_GAUGE);
+        w.value(service.toPhoneQueue.count());
+        w.end();
+
+        w.begin("tophone_stored", "Packets waiting for the phone in flash", METRIC_GAUGE);
+        w.value(service.phoneStore ? service.phoneStore->count() : 0);
+        w.end();
+    }
+};
+
+static ToPhoneMetrics toPhoneMetrics;
+
+MeshService::MeshService()
 {
     // assert(MAX_RX_TOPHONE == 32); // FIXME, delete this, just checking my clever macro
 }
@@ -63,6 +100,10 @@ void MeshService::init()
 
     if (gps)
         gpsObserver.observe(&gps->newStatus);
+
+#ifdef FS
+    phoneStore = new PhonePacketStore(); // Loads anything we didn't deliver before our last reboot
+#endif
 }
 
 int MeshService::handleFromRadio(const MeshPacket *mp)
@@ -74,19 +115,40 @@ int MeshService::handleFromRadio(const MeshPacket *mp)
 
     fromNum++;
 
-    if (toPhoneQueue.numFree() == 0) {
-        DEBUG_MSG("NOTE: tophone queue is full, discarding oldest\n");
-        MeshPacket *d = toPhoneQueue.dequeuePtr(0);
-        if (d)
-            releaseToPool(d);
-    }
+    MeshPacket *copy = packetPool.allocCopy(*mp);
+    if (toPhoneQueue.coalesce(copy))
+        return 0; // The phone only needs the latest position (etc...) from each node
 
-    MeshPacket *copied = packetPool.allocCopy(*mp);
-    assert(toPhoneQueue.enqueue(copied, 0)); // FIXME, instead of failing for full queue, delete the oldest mssages
+    // Rather than letting the ring discard a packet no phone has seen yet (because none is in range), move it to flash
+    if (toPhoneQueue.isFull() && phoneStore)
+        moveOldestToStore();
+
+    toPhoneQueue.push(copy); // If the ring is still full this discards a packet
 
     return 0;
 }
 
+void MeshService::moveOldestToStore()
+{
+    // The store delivers each packet to every client, so it can't hold one which some clients have already read - a client
+    // which is behind on such a packet counts it as dropped instead (as does everyone, if the store is full of better packets)
+    bool isSaved = toPhoneQueue.isOldestUnread() && phoneStore->save(*toPhoneQueue.oldest());
+    packetPool.release(toPhoneQueue.popOldest(isSaved));
+}
+
+void MeshService::saveUndelivered()
+{
+    if (!phoneStore)
+        return;
+
+    size_t numPackets = toPhoneQueue.count();
+    while (toPhoneQueue.count())
+        moveOldestToStore();
+    phoneStore->flush();
+
+    DEBUG_MSG("Saved undelivered phone packets (%u were in RAM, %u now on flash)\n", numPackets, phoneStore->count());
+}
+
 /// Do idle processing (mostly processing messages which have been queued from the radio)
 void MeshService::loop()
 {
@@ -94,6 +156,34 @@ void MeshService::loop()
         fromNumChanged.notifyObservers(fromNum);
         oldFromNum = fromNum;
     }
+
+    // If clients ran out of credits, wake them up (i.e. BLE notify) once they can send again
+    uint32_t credits = getTxCredits();
+    if (credits && !lastTxCredits)
+        fromNum++;
+    lastTxCredits = credits;
+}
+
+/// How many tx queue slots we keep for our own traffic (acks, rebroadcasts, our position and nodeinfo)
+#define TX_QUEUE_RESERVED 4
+
+uint32_t MeshService::getMaxTxCredits()
+{
+    return MAX_TX_QUEUE - TX_QUEUE_RESERVED;
+}
+
+uint32_t MeshService::getTxCredits()
+{
+    size_t queueFree = router->getTxQueueFree();
+    uint32_t queueCredits = (queueFree > TX_QUEUE_RESERVED) ? queueFree - TX_QUEUE_RESERVED : 0;
+
+    // Assume the worst (that each packet is as long as possible), but while we have any budget left allow one more packet
+    uint32_t packetMsec = router->getPacketTime(MAX_RHPACKETLEN);
+    if (!packetMsec)
+        return queueCredits;
+    uint32_t airtimeCredits = (getTxAirtimeAvailable() + packetMsec - 1) / packetMsec;
+
+    return (airtimeCredits < queueCredits) ? airtimeCredits : queueCredits;
 }
 
 /// The radioConfig object just changed, call this to force the hw to change to the new settings
@@ -105,7 +195,8 @@ bool MeshService::reloadConfig()
     bool didReset = nodeDB.resetRadioConfig(); // Don't let the phone send us fatally bad settings
 
     configChanged.notifyObservers(NULL);
-    nodeDB.saveToDisk();
+    if (!didReset) // A factory reset already wrote a complete snapshot
+        nodeDB.saveConfigToJournal();
 
     return didReset;
 }
@@ -116,7 +207,7 @@ void MeshService::reloadOwner()
     assert(nodeInfoPlugin);
     if(nodeInfoPlugin)
         nodeInfoPlugin->sendOurNodeInfo();
-    nodeDB.saveToDisk();
+    nodeDB.saveConfigToJournal();
 }
 
 /**
@@ -124,7 +215,7 @@ void MeshService::reloadOwner()
  * Called by PhoneAPI.handleToRadio.  Note: p is a scratch buffer, this function is allowed to write to it but it can not keep a
  * reference
  */
-void MeshService::handleToRadio(MeshPacket &p)
+ErrorCode MeshService::handleToRadio(MeshPacket &p)
 {
     if (p.from != 0) { // We don't let phones assign nodenums to their sent messages
         DEBUG_MSG("Warning: phone tried to pick a nodenum, we don't allow that.\n");
@@ -141,7 +232,7 @@ void MeshService::handleToRadio(MeshPacket &p)
 
     // Send the packet into the mesh
 
-    sendToMesh(packetPool.allocCopy(p));
+    ErrorCode res = sendToMesh(packetPool.allocCopy(p));
 
     bool loopback = false; // if true send any packet the phone sends back itself (for testing)
     if (loopback) {
@@ -150,6 +241,8 @@ void MeshService::handleToRadio(MeshPacket &p)
         handleFromRadio(&p);
         // handleFromRadio will tell the phone a new packet arrived
     }
+
+    return res;
 }
 
 /** Attempt to cancel a previously sent packet from this _local_ node.  Returns true if a packet was found we could cancel */
@@ -158,12 +251,12 @@ bool MeshService::cancelSending(PacketId id)
     return router->cancelSending(nodeDB.getNodeNum(), id);
 }
 
-void MeshService::sendToMesh(MeshPacket *p)
+ErrorCode MeshService::sendToMesh(MeshPacket *p)
 {
     nodeDB.updateFrom(*p); // update our local DB for this packet (because phone might have sent position packets etc...)
 
     // Note: We might return !OK if our fifo was full, at that point the only option we have is to drop it
-    router->sendLocal(p);
+    return router->sendLocal(p);
 }
 
 void MeshService::sendNetworkPing(NodeNum dest, bool wantReplies)
@@ -205,6 +298,8 @@ NodeInfo *MeshService::refreshMyNodeInfo()
     position.battery_level = powerStatus->getBatteryChargePercent();
     updateBatteryLevel(position.battery_level);
 
+    nodeDB.nodeChanged(node); // so clients which sync incrementally will see our new time and battery level
+
     return node;
 }
 
@@ -9,7 +9,8 @@
 #include "MeshRadio.h"
 #include "MeshTypes.h"
 #include "Observer.h"
-#include "PointerQueue.h"
+#include "PhonePacketRing.h"
+#include "PhonePacketStore.h"
 
 /**
  * Top level app for this service.  keeps the mesh, the radio config and the queue of received packets.
@@ -20,19 +21,23 @@ class MeshService
     CallbackObserver<MeshService, const meshtastic::GPSStatus *> gpsObserver =
         CallbackObserver<MeshService, const meshtastic::GPSStatus *>(this, &MeshService::onGPSChanged);
 
-    /// received packets waiting for the phone to process them
-    /// FIXME, change to a DropOldestQueue and keep a count of the number of dropped packets to ensure
-    /// we never hang because android hasn't been there in a while
-    /// FIXME - save this to flash on deep sleep
-    PointerQueue<MeshPacket> toPhoneQueue;
-
     /// The current nonce for the newest packet which has been queued for the phone
     uint32_t fromNum = 0;
 
     /// Updated in loop() to detect when fromNum changes
     uint32_t oldFromNum = 0;
 
+    /// The tx credits we saw on our last check in loop() (so we can tell clients when they can send again)
+    uint32_t lastTxCredits = 0;
+
   public:
+    /// received packets waiting for the phone(s) to process them, each PhoneAPI reads them with its own cursor
+    PhonePacketRing toPhoneQueue;
+
+    /// older packets which no phone has read yet, moved to flash when they overflowed toPhoneQueue (NULL if we have no
+    /// filesystem)
+    PhonePacketStore *phoneStore = NULL;
+
     /// Called when some new packets have arrived from one of the radios
     Observable<uint32_t> fromNumChanged;
 
@@ -46,10 +51,6 @@ class MeshService
     /// Do idle processing (mostly processing messages which have been queued from the radio)
     void loop();
 
-    /// Return the next packet destined to the phone.  FIXME, somehow use fromNum to allow the phone to retry the
-    /// last few packets if needs to.
-    MeshPacket *getForPhone() { return toPhoneQueue.dequeuePtr(0); }
-
     /// Allows the bluetooth handler to free packets after they have been sent
     void releaseToPool(MeshPacket *p) { packetPool.release(p); }
 
@@ -57,8 +58,18 @@ class MeshService
      *  Given a ToRadio buffer parse it and properly handle it (setup radio, owner or send packet into the mesh)
      * Called by PhoneAPI.handleToRadio.  Note: p is a scratch buffer, this function is allowed to write to it but it can not keep
      * a reference
+     *
+     * @return the result of queuing the packet for sending
      */
-    void handleToRadio(MeshPacket &p);
+    ErrorCode handleToRadio(MeshPacket &p);
+
+    /** How many packets clients may send us right now.  Limited both by the room left in our tx queue (minus a few slots we
+     * keep for our own traffic) and by our transmit airtime budget (see getTxAirtimeAvailable()).
+     */
+    uint32_t getTxCredits();
+
+    /// @return the most tx credits a client can ever have
+    uint32_t getMaxTxCredits();
 
     /** The radioConfig object just changed, call this to force the hw to change to the new settings
      * @return true if client devices should be sent a new set of radio configs
@@ -75,7 +86,7 @@ class MeshService
     /// Send a packet into the mesh - note p must have been allocated from packetPool.  We will return it to that pool after
     /// sending. This is the ONLY function you should use for sending messages into the mesh, because it also updates the nodedb
     /// cache
-    void sendToMesh(MeshPacket *p);
+    ErrorCode sendToMesh(MeshPacket *p);
 
     /** Attempt to cancel a previously sent packet from this _local_ node.  Returns true if a packet was found we could cancel */
     bool cancelSending(PacketId id);
@@ -83,6 +94,9 @@ class MeshService
     /// Pull the latest power and time info into my nodeinfo
     NodeInfo *refreshMyNodeInfo();
 
+    /// Before we lose our RAM (i.e. deep sleep), move any packets no phone has read from toPhoneQueue to flash
+    void saveUndelivered();
+
   private:
 
     /// Called when our gps position has changed - updates nodedb and sends Location message out into the mesh
@@ -92,6 +106,9 @@ class MeshService
     /// Handle a packet that just arrived from the radio.  This method does _ReliableRouternot_ free the provided packet.  If it needs
     /// to keep the packet around it makes a copy
     int handleFromRadio(const MeshPacket *p);
+
+    /// Remove the oldest packet from toPhoneQueue, saving it to phoneStore if no phone has read it yet
+    void moveOldestToStore();
     friend class RoutingPlugin;
 };
 
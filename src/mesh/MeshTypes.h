@@ -16,6 +16,7 @@ typedef uint32_t PacketId; // A packet sequence number
 #define ERRNO_DISABLED 34 // the itnerface is disabled
 #define ERRNO_TOO_LARGE 35
 #define ERRNO_NO_CHANNEL 36
+#define ERRNO_QUEUE_FULL 37 // the client has no tx credits left (see MeshService::getTxCredits), or a queue had no room
 
 /**
  * the max number of hops a message can pass through, used as the default max for hop_limit in MeshPacket.
@@ -9,6 +9,7 @@
 #include "FSCommon.h"
 #include "GPS.h"
 #include "MeshRadio.h"
+#include "Metrics.h"
 #include "NodeDB.h"
 #include "PacketHistory.h"
 #include "PowerFSM.h"
@@ -18,6 +19,7 @@
 #include "error.h"
 #include "main.h"
 #include "mesh-pb-constants.h"
+#include <algorithm>
 #include <pb_decode.h>
 #include <pb_encode.h>
 
@@ -37,6 +39,13 @@ RadioConfig &radioConfig = devicestate.radio;
  */
 uint32_t radioGeneration;
 
+static Gauge nodesOnline("nodes_online", "Nodes we have heard from recently",
+                         []() { return (int32_t)nodeDB.getNumOnlineNodes(); });
+static Gauge nodesTotal("nodes", "Nodes in our database", []() { return (int32_t)nodeDB.getNumNodes(); });
+
+/// Unlike myNodeInfo.error_count (which is saved with the rest of our state) this counts from boot, like our other counters
+static Counter criticalErrors("critical_errors_total", "Critical errors recorded since boot");
+
 /*
 DeviceState versions used to be defined in the .proto file but really only this function cares.  So changed to a
 #define here.
@@ -64,7 +73,12 @@ static uint8_t ourMacAddr[6];
  */
 NodeNum displayedNodeNum;
 
-NodeDB::NodeDB() : nodes(devicestate.node_db), numNodes(&devicestate.node_db_count) {}
+NodeDB::NodeDB() : nodes(devicestate.node_db), numNodes(&devicestate.node_db_count)
+{
+    static_assert(MAX_NUM_NODES < UINT16_MAX, "nodeIndex entries are only 16 bits");
+    static_assert(MAX_NUM_HOT_NODES <= MAX_NUM_NODES, "node_db is too small for MAX_NUM_HOT_NODES");
+    nodeIndex.rebuild(nodes, *numNodes);
+}
 
 /**
  * Most (but not always) of the time we want to treat packets 'from' the local phone (where from == 0), as if they originated on the local node.
@@ -83,6 +97,8 @@ bool NodeDB::resetRadioConfig()
     if (radioConfig.preferences.factory_reset) {
         DEBUG_MSG("Performing factory reset!\n");
         installDefaultDeviceState();
+        coldNodes.clear();
+        saveToDisk(); // Journaling the reset wouldn't work: replaying it on top of our old snapshot would keep the old nodes
         didFactoryReset = true;
     } else if (devicestate.channels_count == 0) {
         DEBUG_MSG("Setting default channel and radio preferences!\n");
@@ -126,6 +142,9 @@ void NodeDB::installDefaultDeviceState()
     memset(&devicestate, 0, sizeof(devicestate));
 
     *numNodes = 0; // Forget node DB
+    nodeIndex.rebuild(nodes, *numNodes);
+    recountOnline();
+    invalidateSyncGenerations();
 
     // init our devicestate with valid flags so protobuf writing/reading will work
     devicestate.has_my_node = true;
@@ -162,12 +181,33 @@ void NodeDB::installDefaultDeviceState()
 
 void NodeDB::init()
 {
+    uint32_t bootStart = millis();
+
+    // Start our generations at a random point, so a client is very unlikely to have a token from a previous boot which looks
+    // valid.  We leave plenty of room before the counter could wrap.
+    syncGeneration = random(SYNC_GENERATION_FULL + 1, 0x40000000);
     installDefaultDeviceState();
 
+    // Before loading, because if the snapshot has more nodes than we keep in RAM we evict the extra ones
+    coldNodes.init();
+    uint32_t coldMsec = millis();
+
     // saveToDisk();
     loadFromDisk();
     // saveToDisk();
 
+    // If we rebooted before our last save some nodes might be both in flash and RAM, the RAM copy wins
+    for (size_t i = 0; i < *numNodes; i++)
+        coldNodes.forget(nodes[i].num);
+    uint32_t loadedMsec = millis();
+
+    replayJournal();
+    recountOnline(); // The journal might have changed the lastSeen time of any node
+
+    expiryThread = new concurrency::Periodic("NodeExpiry", []() { return nodeDB.expireOnlineNodes(); });
+    DEBUG_MSG("NodeDB boot phases: cold tier %u ms, snapshot %u ms, journal %u ms\n", coldMsec - bootStart,
+              loadedMsec - coldMsec, millis() - loadedMsec);
+
     myNodeInfo.max_channels = MAX_NUM_CHANNELS; // tell others the max # of channels we can understand
 
     myNodeInfo.error_code =
@@ -243,15 +283,27 @@ void NodeDB::pickNewNodeNum()
 const char *preffile = "/db.proto";
 const char *preftmp = "/db.proto.tmp";
 
+/// Our snapshots end with an extra fixed32 field holding their generation.  DeviceState has no field with this tag, so protobuf
+/// readers (including us) skip it, and we read it back from the end of the file.
+#define SNAPSHOT_GENERATION_TAG 1000
+#define SNAPSHOT_TRAILER_LEN 6 // A two byte tag and the fixed32
+
+static bool encodeSnapshotTrailer(pb_ostream_t *stream, uint32_t generation)
+{
+    return pb_encode_tag(stream, PB_WT_32BIT, SNAPSHOT_GENERATION_TAG) && pb_encode_fixed32(stream, &generation);
+}
+
 void NodeDB::loadFromDisk()
 {
 #ifdef FS
     // static DeviceState scratch; We no longer read into a tempbuf because this structure is 15KB of valuable RAM
 
+    uint32_t start = millis();
     auto f = FS.open(preffile);
     if (f) {
         DEBUG_MSG("Loading saved preferences\n");
-        pb_istream_t stream = {&readcb, &f, DeviceState_size};
+        PBFileReader reader(&f);
+        pb_istream_t stream = {&readcb, &reader, f.size()}; // Knowing the exact size means we never need to ask available()
 
         // DEBUG_MSG("Preload channel name=%s\n", channelSettings.name);
 
@@ -265,7 +317,21 @@ void NodeDB::loadFromDisk()
                 DEBUG_MSG("Warn: devicestate is old, discarding\n");
                 installDefaultDeviceState();
             } else {
-                DEBUG_MSG("Loaded saved preferences version %d\n", devicestate.version);
+                // A snapshot from before we had generations is generation 0, like any journal written on top of it
+                uint8_t expected[SNAPSHOT_TRAILER_LEN], trailer[SNAPSHOT_TRAILER_LEN];
+                pb_ostream_t s = pb_ostream_from_buffer(expected, sizeof(expected));
+                encodeSnapshotTrailer(&s, 0);
+                snapshotGeneration = 0;
+                if (f.size() > sizeof(trailer) && f.seek(f.size() - sizeof(trailer)) &&
+                    f.read(trailer, sizeof(trailer)) == sizeof(trailer) && memcmp(trailer, expected, 2) == 0)
+                    snapshotGeneration = trailer[2] | (trailer[3] << 8) | (trailer[4] << 16) | ((uint32_t)trailer[5] << 24);
+
+                DEBUG_MSG("Loaded saved preferences version %d generation %u (%u bytes, %u flash reads) in %u ms\n",
+                          devicestate.version, snapshotGeneration, f.size(), reader.numReads, millis() - start);
+                evictExcessNodes();
+                nodeIndex.rebuild(nodes, *numNodes); // our nodes array was just replaced
+                recountOnline();
+                invalidateSyncGenerations();
             }
 
             // DEBUG_MSG("Postload channel name=%s\n", channelSettings.name);
@@ -281,10 +347,79 @@ void NodeDB::loadFromDisk()
 #endif
 }
 
+void NodeDB::replayJournal()
+{
+    // Don't publish the journal until we are done, so the changes we replay are not journaled a second time
+    NodeDBJournal *j = new NodeDBJournal(snapshotGeneration, [this]() { saveToDisk(); });
+    j->replay([this](JournalRecordType type, const uint8_t *payload, size_t len) {
+        switch (type) {
+        case JOURNAL_NODE:
+        case JOURNAL_POSITION:
+        case JOURNAL_USER: {
+            NodeInfo delta;
+            memset(&delta, 0, sizeof(delta));
+            if (!pb_decode_from_bytes(payload, len, NodeInfo_fields, &delta))
+                break;
+
+            NodeInfo *info = getOrCreateNode(delta.num);
+            if (type == JOURNAL_NODE)
+                *info = delta;
+            else if (type == JOURNAL_POSITION) {
+                info->position = delta.position;
+                info->has_position = true;
+            } else {
+                info->user = delta.user;
+                info->has_user = true;
+            }
+            break;
+        }
+
+        case JOURNAL_RADIO:
+            memset(&radioConfig, 0, sizeof(radioConfig));
+            devicestate.has_radio = pb_decode_from_bytes(payload, len, RadioConfig_fields, &radioConfig);
+            break;
+
+        case JOURNAL_CHANNEL: {
+            Channel c;
+            memset(&c, 0, sizeof(c));
+            if (pb_decode_from_bytes(payload, len, Channel_fields, &c) && c.index >= 0 && c.index < (int)MAX_NUM_CHANNELS) {
+                devicestate.channels[c.index] = c;
+                if (devicestate.channels_count <= c.index)
+                    devicestate.channels_count = c.index + 1;
+            }
+            break;
+        }
+
+        case JOURNAL_OWNER:
+            memset(&owner, 0, sizeof(owner));
+            devicestate.has_owner = pb_decode_from_bytes(payload, len, User_fields, &owner);
+            break;
+
+        default:
+            DEBUG_MSG("Warning: ignoring unknown journal record %d\n", type);
+            break;
+        }
+    });
+    journal = j;
+}
+
+void NodeDB::saveConfigToJournal()
+{
+    journalChange(JOURNAL_RADIO, RadioConfig_fields, &radioConfig);
+    for (int i = 0; i < devicestate.channels_count; i++)
+        journalChange(JOURNAL_CHANNEL, Channel_fields, &devicestate.channels[i]);
+    journalChange(JOURNAL_OWNER, User_fields, &owner);
+
+    // Config changes are rare and often followed by a reboot, so don't leave them sitting in RAM
+    if (journal)
+        journal->flush();
+}
+
 void NodeDB::saveToDisk()
 {
 #ifdef FS
     if (!devicestate.no_save) {
+        uint32_t start = millis();
         auto f = FS.open(preftmp, FILE_O_WRITE);
         if (f) {
             DEBUG_MSG("Writing preferences\n");
@@ -294,7 +429,8 @@ void NodeDB::saveToDisk()
             // DEBUG_MSG("Presave channel name=%s\n", channelSettings.name);
 
             devicestate.version = DEVICESTATE_CUR_VER;
-            if (!pb_encode(&stream, DeviceState_fields, &devicestate)) {
+            uint32_t generation = snapshotGeneration + 1;
+            if (!pb_encode(&stream, DeviceState_fields, &devicestate) || !encodeSnapshotTrailer(&stream, generation)) {
                 DEBUG_MSG("Error: can't write protobuf %s\n", PB_GET_ERROR(&stream));
                 // FIXME - report failure to phone
 
@@ -308,6 +444,15 @@ void NodeDB::saveToDisk()
                     DEBUG_MSG("Warning: Can't remove old pref file\n");
                 if (!FS.rename(preftmp, preffile))
                     DEBUG_MSG("Error: can't rename new pref file\n");
+                else {
+                    snapshotGeneration = generation;
+                    if (journal)
+                        journal->clear(generation); // Everything in the journal is now part of our snapshot
+                }
+
+                snapshotBytesWritten += stream.bytes_written;
+                DEBUG_MSG("Wrote %u byte snapshot in %u ms (%u snapshot bytes since boot)\n", stream.bytes_written,
+                          millis() - start, snapshotBytesWritten);
             }
         } else {
             DEBUG_MSG("ERROR: can't write prefs\n"); // FIXME report to app
@@ -320,12 +465,31 @@ void NodeDB::saveToDisk()
 #endif
 }
 
-const NodeInfo *NodeDB::readNextInfo()
+void NodeDB::invalidateSyncGenerations()
 {
-    if (readPointer < *numNodes)
-        return &nodes[readPointer++];
-    else
-        return NULL;
+    memset(nodeGenerations, 0, sizeof(nodeGenerations));
+    firstValidGeneration = ++syncGeneration;
+}
+
+const NodeInfo *NodeDB::readNextInfo(uint32_t &readIndex, uint32_t sinceGeneration)
+{
+    bool incremental = isValidSyncGeneration(sinceGeneration);
+
+    while (readIndex < *numNodes) {
+        size_t x = readIndex++;
+        if (!incremental || nodeGenerations[x] > sinceGeneration)
+            return &nodes[x];
+    }
+
+    // Then stream any nodes we've evicted to flash (an incremental client already has those, any node which changes is paged
+    // back in to RAM)
+    while (!incremental && readIndex < getNumTotalNodes()) {
+        size_t x = readIndex++ - *numNodes;
+        if (coldNodes.readByIndex(x, &coldScratch))
+            return &coldScratch;
+    }
+
+    return NULL;
 }
 
 /// Given a node, return how many seconds in the past (vs now) that we last heard from it
@@ -341,18 +505,103 @@ uint32_t sinceLastSeen(const NodeInfo *n)
     return delta;
 }
 
-#define NUM_ONLINE_SECS (60 * 2) // 2 hrs to consider someone offline
+/// @return true if we have heard from a node with this lastSeen time recently
+static bool isOnline(uint32_t lastSeen)
+{
+    int delta = (int)(getTime() - lastSeen);
+    return delta < NUM_ONLINE_SECS; // negative if our clock is not yet set, we treat those nodes as online (like sinceLastSeen)
+}
+
+/// Ordering for our min heap of expiries (std::*_heap build max heaps, so this is reversed)
+bool NodeDB::expiresLater(const NodeDB::OnlineExpiry &a, const NodeDB::OnlineExpiry &b)
+{
+    return (int)(a.lastSeen - b.lastSeen) > 0;
+}
 
-size_t NodeDB::getNumOnlineNodes()
+void NodeDB::updateOnline(size_t x)
 {
-    size_t numseen = 0;
+    assert(x < *numNodes);
+
+    bool online = isOnline(nodes[x].position.time);
+    if (online != isCountedOnline[x]) {
+        isCountedOnline[x] = online;
+        if (online)
+            numOnline++;
+        else
+            numOnline--;
+    }
 
-    // FIXME this implementation is kinda expensive
-    for (int i = 0; i < *numNodes; i++)
-        if (sinceLastSeen(&nodes[i]) < NUM_ONLINE_SECS)
-            numseen++;
+    if (online)
+        scheduleExpiry(&nodes[x]);
+}
 
-    return numseen;
+void NodeDB::forgetOnline(size_t x)
+{
+    if (isCountedOnline[x]) {
+        isCountedOnline[x] = false;
+        numOnline--;
+    }
+}
+
+void NodeDB::scheduleExpiry(const NodeInfo *info)
+{
+    if (numOnlineExpiries == ONLINE_EXPIRY_SLOTS) {
+        // Full of stale entries, start over (this also schedules info, because it is online)
+        recountOnline();
+        return;
+    }
+
+    onlineExpiries[numOnlineExpiries++] = {info->position.time, info->num};
+    std::push_heap(onlineExpiries, onlineExpiries + numOnlineExpiries, expiresLater);
+
+    if (expiryThread) // Make sure we wake up in time if this is now the first entry
+        expiryThread->setIntervalFromNow(msecsUntilExpiry());
+}
+
+void NodeDB::recountOnline()
+{
+    numOnline = 0;
+    numOnlineExpiries = 0;
+    memset(isCountedOnline, 0, sizeof(isCountedOnline));
+
+    for (size_t i = 0; i < *numNodes; i++)
+        updateOnline(i);
+}
+
+/// Even when no node is due to expire we check occasionally, because our clock might jump once we get a GPS fix
+#define MAX_EXPIRY_CHECK_MSECS (60 * 1000)
+
+int32_t NodeDB::msecsUntilExpiry()
+{
+    if (!numOnlineExpiries)
+        return MAX_EXPIRY_CHECK_MSECS;
+
+    int32_t secs = (int32_t)(onlineExpiries[0].lastSeen + NUM_ONLINE_SECS - getTime());
+    if (secs <= 0)
+        return 0;
+    else if (secs >= MAX_EXPIRY_CHECK_MSECS / 1000)
+        return MAX_EXPIRY_CHECK_MSECS;
+    else
+        return secs * 1000;
+}
+
+int32_t NodeDB::expireOnlineNodes()
+{
+    while (numOnlineExpiries && !isOnline(onlineExpiries[0].lastSeen)) {
+        OnlineExpiry e = onlineExpiries[0];
+        std::pop_heap(onlineExpiries, onlineExpiries + numOnlineExpiries, expiresLater);
+        numOnlineExpiries--;
+
+        // Ignore stale entries (for nodes heard from again since, or which have been evicted)
+        NodeInfo *info = getNode(e.num);
+        if (info && info->position.time == e.lastSeen)
+            forgetOnline(info - nodes);
+    }
+
+    notifyObservers();
+
+    int32_t msecs = msecsUntilExpiry();
+    return msecs < 1000 ? 1000 : msecs; // Our clock only has one second resolution
 }
 
 #include "MeshPlugin.h"
@@ -368,8 +617,10 @@ void NodeDB::updatePosition(uint32_t nodeId, const Position &p)
     // Be careful to only update fields that have been set by the sender
     // A lot of position reports don't have time populated.  In that case, be careful to not blow away the time we
     // recorded based on the packet rxTime
-    if (!info->position.time && p.time)
+    if (!info->position.time && p.time) {
         info->position.time = p.time;
+        updateOnline(info - nodes);
+    }
     if(p.battery_level)
         info->position.battery_level = p.battery_level;
     if (p.latitude_i || p.longitude_i) {
@@ -377,8 +628,15 @@ void NodeDB::updatePosition(uint32_t nodeId, const Position &p)
         info->position.longitude_i = p.longitude_i;
     }
     info->has_position = true;
+    touchNode(info - nodes);
+
+    NodeInfo delta = {info->num};
+    delta.has_position = true;
+    delta.position = info->position;
+    journalChange(JOURNAL_POSITION, NodeInfo_fields, &delta);
+
     updateGUIforNode = info;
-    notifyObservers(true); // Force an update whether or not our node counts have changed
+    notifyObservers(); // Only tells observers if our counts changed
 }
 
 /** Update user info for this node based on received user data
@@ -397,13 +655,18 @@ void NodeDB::updateUser(uint32_t nodeId, const User &p)
     info->has_user = true;
 
     if (changed) {
+        touchNode(info - nodes);
+
+        NodeInfo delta = {info->num};
+        delta.has_user = true;
+        delta.user = info->user;
+        journalChange(JOURNAL_USER, NodeInfo_fields, &delta);
+
         updateGUIforNode = info;
         powerFSM.trigger(EVENT_NODEDB_UPDATED);
-        notifyObservers(true); // Force an update whether or not our node counts have changed
+        notifyObservers(); // Only tells observers if our counts changed
 
-        // Not really needed - we will save anyways when we go to sleep
-        // We just changed something important about the user, store our DB
-        // saveToDisk();
+        // No need for a full saveToDisk, the journal entry above will be persisted soon
     }
 }
 
@@ -416,24 +679,28 @@ void NodeDB::updateFrom(const MeshPacket &mp)
 
         NodeInfo *info = getOrCreateNode(getFrom(&mp));
 
-        if (mp.rx_time) {              // if the packet has a valid timestamp use it to update our last_seen
-            info->has_position = true; // at least the time is valid
+        if (mp.rx_time && mp.rx_time != info->position.time) { // if the packet has a valid timestamp use it to update our last_seen
+            info->has_position = true;                           // at least the time is valid
             info->position.time = mp.rx_time;
+            updateOnline(info - nodes);
+            touchNode(info - nodes);
+        }
+
+        if (info->snr != mp.rx_snr) {
+            info->snr = mp.rx_snr; // keep the most recent SNR we received for this node.
+            touchNode(info - nodes);
         }
 
-        info->snr = mp.rx_snr; // keep the most recent SNR we received for this node.
+        notifyObservers(); // Only tells observers if our counts changed
     }
 }
 
 /// Find a node in our DB, return null for missing
-/// NOTE: This function might be called from an ISR
+/// NOTE: This function might be called from an ISR, so it must not allocate or block.
 NodeInfo *NodeDB::getNode(NodeNum n)
 {
-    for (int i = 0; i < *numNodes; i++)
-        if (nodes[i].num == n)
-            return &nodes[i];
-
-    return NULL;
+    int x = nodeIndex.find(nodes, *numNodes, n);
+    return x < 0 ? NULL : &nodes[x];
 }
 
 /// Find a node in our DB, create an empty NodeInfo if missing
@@ -442,18 +709,77 @@ NodeInfo *NodeDB::getOrCreateNode(NodeNum n)
     NodeInfo *info = getNode(n);
 
     if (!info) {
-        // add the node
-        assert(*numNodes < MAX_NUM_NODES);
-        info = &nodes[(*numNodes)++];
+        // add the node, if we are full reuse the slot of the least recently heard node
+        bool isFull = *numNodes >= MAX_NUM_HOT_NODES;
+        size_t x = isFull ? evictOldestNode() : *numNodes;
+        info = &nodes[x];
+
+        if (coldNodes.take(n, info))
+            DEBUG_MSG("Paged in node 0x%x from flash\n", n);
+        else {
+            // everything is missing except the nodenum
+            memset(info, 0, sizeof(*info));
+            info->num = n;
+        }
+
+        // Only publish the new record (to possible ISR readers) once it is fully initialized
+        nodeIndex.add(nodes, x);
+        if (!isFull)
+            (*numNodes)++;
+        updateOnline(x);
+        touchNode(x); // Clients might not have this node, or have an older copy from before it was evicted
 
-        // everything is missing except the nodenum
-        memset(info, 0, sizeof(*info));
-        info->num = n;
+        journalChange(JOURNAL_NODE, NodeInfo_fields, info);
     }
 
     return info;
 }
 
+/// @return the index in nodes[] of the least recently heard node (other than us)
+size_t NodeDB::findOldestNode()
+{
+    size_t oldest = 0;
+    bool found = false;
+    for (size_t i = 0; i < *numNodes; i++)
+        if (nodes[i].num != getNodeNum() && (!found || nodes[i].position.time < nodes[oldest].position.time)) {
+            oldest = i;
+            found = true;
+        }
+    assert(found);
+
+    return oldest;
+}
+
+/// Move the least recently heard node out to flash
+/// @return the index in nodes[] that is now free for reuse
+size_t NodeDB::evictOldestNode()
+{
+    size_t oldest = findOldestNode();
+
+    DEBUG_MSG("Evicting node 0x%x to flash\n", nodes[oldest].num);
+    coldNodes.store(nodes[oldest]);
+    nodeIndex.remove(nodes, oldest);
+    forgetOnline(oldest);
+
+    if (updateGUIforNode == &nodes[oldest])
+        updateGUIforNode = NULL;
+
+    return oldest;
+}
+
+/// Move nodes out to flash until we have no more than MAX_NUM_HOT_NODES (a build with a smaller MAX_NUM_HOT_NODES might
+/// load a DB saved by one with a bigger one)
+void NodeDB::evictExcessNodes()
+{
+    while (*numNodes > MAX_NUM_HOT_NODES) {
+        size_t oldest = findOldestNode();
+
+        DEBUG_MSG("Too many nodes for RAM, evicting node 0x%x to flash\n", nodes[oldest].num);
+        coldNodes.store(nodes[oldest]);
+        nodes[oldest] = nodes[--(*numNodes)];
+    }
+}
+
 /// Record an error that should be reported via analytics
 void recordCriticalError(CriticalErrorCode code, uint32_t address)
 {
@@ -466,4 +792,5 @@ void recordCriticalError(CriticalErrorCode code, uint32_t address)
     myNodeInfo.error_code = code;
     myNodeInfo.error_address = address;
     myNodeInfo.error_count++;
+    criticalErrors.inc();
 }
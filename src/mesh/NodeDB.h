@@ -1,10 +1,14 @@
 #pragma once
 
 #include "Observer.h"
+#include "concurrency/Periodic.h"
 #include <Arduino.h>
 #include <assert.h>
 
+#include "ColdNodeStore.h"
 #include "MeshTypes.h"
+#include "NodeDBJournal.h"
+#include "NodeIndex.h"
 #include "NodeStatus.h"
 #include "mesh-pb-constants.h"
 
@@ -16,6 +20,28 @@ extern User &owner;
 /// Given a node, return how many seconds in the past (vs now) that we last heard from it
 uint32_t sinceLastSeen(const NodeInfo *n);
 
+/// The max number of nodes we keep in RAM, must be <= MAX_NUM_NODES (the size of the node_db array we save to flash).  Once
+/// we have this many nodes, the least recently heard node is evicted to our flash backed ColdNodeStore.
+#ifndef MAX_NUM_HOT_NODES
+#define MAX_NUM_HOT_NODES MAX_NUM_NODES
+#endif
+
+/// Number of slots in our NodeNum->index hash table, must be a power of two.  We keep the table at most half full so that
+/// probe sequences stay short.
+#define NODE_INDEX_SLOTS nextPowerOfTwo(MAX_NUM_NODES * 2)
+
+/// How long since we last heard from a node before we consider it offline
+#define NUM_ONLINE_SECS (60 * 2)
+
+/// Number of entries in our schedule of when nodes go offline.  Each time a node is heard from we add an entry (old entries are
+/// discarded lazily), so we allow some slack beyond one entry per node before we need to rebuild the schedule.
+#define ONLINE_EXPIRY_SLOTS (MAX_NUM_HOT_NODES * 2)
+
+/// Special sync generations a client can send us: an old client which wants one NodeInfo per FromRadio, or a new client which
+/// doesn't have any of our nodes yet.  Real generations are never this small.
+#define SYNC_GENERATION_LEGACY 0
+#define SYNC_GENERATION_FULL 1
+
 class NodeDB
 {
     // NodeNum provisionalNodeNum; // if we are trying to find a node num this is our current attempt
@@ -27,12 +53,69 @@ class NodeDB
     NodeInfo *nodes;
     pb_size_t *numNodes;
 
-    uint32_t readPointer = 0;
+    /** A hash table from NodeNum to the position of that node in nodes[].  This table is not saved to disk, it is rebuilt any
+     * time we load or reset the node DB.
+     */
+    NodeIndex<NodeInfo, NODE_INDEX_SLOTS> nodeIndex;
+
+    /// Nodes we've evicted from RAM (because we've heard from too many nodes) live here
+    ColdNodeStore coldNodes;
+
+    /// Scratch storage for records readNextInfo() pages in from coldNodes
+    NodeInfo coldScratch;
+
+    /// Small changes are appended here rather than rewriting our entire saved state (created in init())
+    NodeDBJournal *journal = NULL;
+
+    /// How many bytes of full snapshots we have written since boot (for comparison with the journal stats)
+    uint32_t snapshotBytesWritten = 0;
+
+    /// Counts the snapshots we have written, so the journal can say which one it applies to (0 for none, or one without a
+    /// generation)
+    uint32_t snapshotGeneration = 0;
+
+    /// An entry in our schedule of when nodes will go offline
+    struct OnlineExpiry {
+        uint32_t lastSeen; // The position.time of the node when this entry was added
+        NodeNum num;
+    };
+
+    /** A min heap (ordered by lastSeen) of when nodes which are currently online will go offline.  When a node is heard from
+     * again a new entry is added, and its older entry is discarded (as stale) once it reaches the top of the heap.
+     */
+    OnlineExpiry onlineExpiries[ONLINE_EXPIRY_SLOTS];
+    size_t numOnlineExpiries = 0;
+
+    static bool expiresLater(const OnlineExpiry &a, const OnlineExpiry &b);
+
+    /// Which nodes[] slots are currently counted in numOnline
+    bool isCountedOnline[MAX_NUM_HOT_NODES];
+    size_t numOnline = 0;
+
+    /// The counts we last sent to newStatus observers
+    size_t lastNotifiedOnline = 0, lastNotifiedTotal = 0;
+
+    /// What newStatus will tell its observers (it must outlive the notification, which is deferred)
+    meshtastic::NodeStatus pendingStatus;
+
+    /// Wakes up when the next node is due to go offline (created in init())
+    concurrency::Periodic *expiryThread = NULL;
+
+    /** The change generation of each nodes[] slot (i.e. the value of syncGeneration when that node last changed).  Not saved
+     * to disk, after a reboot every client does a full sync.
+     */
+    uint32_t nodeGenerations[MAX_NUM_HOT_NODES];
+
+    /// Bumped each time any node changes, clients send back the value we gave them to get only the newer changes
+    uint32_t syncGeneration = 0;
+
+    /// Tokens older than this were issued before a reboot (or before our DB was replaced) and can't be used
+    uint32_t firstValidGeneration = 0;
 
   public:
     bool updateGUI = false;            // we think the gui should definitely be redrawn, screen will clear this once handled
     NodeInfo *updateGUIforNode = NULL; // if currently showing this node, we think you should update the GUI
-    Observable<const meshtastic::NodeStatus *> newStatus;
+    DeferredObservable<const meshtastic::NodeStatus *> newStatus;
 
     /// don't do mesh based algoritm for node id assignment (initially)
     /// instead just store in flash - possibly even in the initial alpha release do this hack
@@ -41,9 +124,12 @@ class NodeDB
     /// Called from service after app start, to do init which can only be done after OS load
     void init();
 
-    /// write to flash
+    /// write a complete snapshot of our state to flash (and empty our journal)
     void saveToDisk();
 
+    /// Append our current radio config, channels and owner to the journal (much cheaper than saveToDisk)
+    void saveConfigToJournal();
+
     /** Reinit radio config if needed, because either:
      * a) sometimes a buggy android app might send us bogus settings or
      * b) the client set factory_reset
@@ -67,8 +153,12 @@ class NodeDB
     /// @return our node number
     NodeNum getNodeNum() { return myNodeInfo.my_node_num; }
 
+    /// @return the number of nodes currently in RAM (i.e. valid for getNodeByIndex)
     size_t getNumNodes() { return *numNodes; }
 
+    /// @return the number of nodes we know about, including the ones we've evicted to flash
+    size_t getNumTotalNodes() { return *numNodes + coldNodes.count(); }
+
     /// if returns false, that means our node should send a DenyNodeNum response.  If true, we think the number is okay for use
     // bool handleWantNodeNum(NodeNum n);
 
@@ -80,16 +170,34 @@ class NodeDB
     their denial?)
     */
 
-    /// Called from bluetooth when the user wants to start reading the node DB from scratch.
-    void resetReadPointer() { readPointer = 0; }
+    /// @return the token to give a client so that next time it can ask for just the nodes which changed after now
+    uint32_t getSyncGeneration() const { return syncGeneration; }
 
-    /// Allow the bluetooth layer to read our next nodeinfo record, or NULL if done reading
-    const NodeInfo *readNextInfo();
+    /// @return true if gen is a token we issued since boot (so we know which nodes have changed since then)
+    bool isValidSyncGeneration(uint32_t gen) const
+    {
+        return gen >= firstValidGeneration && gen <= syncGeneration;
+    }
+
+    /** Read the next nodeinfo record for a client, or NULL if done reading.  readIndex is the client's cursor (start it at 0).
+     *
+     * If sinceGeneration is a valid sync generation, only the in RAM records which changed after that generation are
+     * returned.  Otherwise we return all records, those evicted to flash are streamed after the in RAM records.  The returned
+     * pointer is only valid until the next call.
+     */
+    const NodeInfo *readNextInfo(uint32_t &readIndex, uint32_t sinceGeneration);
+
+    /// Call after changing a node directly (rather than with our update methods) so clients will be sent the new version
+    void nodeChanged(const NodeInfo *info)
+    {
+        assert(info >= nodes && info < nodes + *numNodes);
+        touchNode(info - nodes);
+    }
 
     /// pick a provisional nodenum we hope no one is using
     void pickNewNodeNum();
 
-    /// Find a node in our DB, return null for missing
+    /// Find a node in our DB, return null for missing.  Only searches the nodes in RAM (so safe to call from an ISR)
     NodeInfo *getNode(NodeNum n);
 
     NodeInfo *getNodeByIndex(size_t x)
@@ -98,24 +206,84 @@ class NodeDB
         return &nodes[x];
     }
 
-    /// Return the number of nodes we've heard from recently (within the last 2 hrs?)
-    size_t getNumOnlineNodes();
+    /// Return the number of nodes we've heard from recently (within NUM_ONLINE_SECS), this is O(1)
+    size_t getNumOnlineNodes() { return numOnline; }
+
+    /** Mark any nodes whose time has run out as offline (notifying observers if our counts changed).  Called by expiryThread.
+     * @return msecs until we should be called again
+     */
+    int32_t expireOnlineNodes();
 
   private:
-    /// Find a node in our DB, create an empty NodeInfo if missing
+    /// Find a node in our DB, create an empty NodeInfo if missing (paging it in from flash or evicting older nodes if needed)
     NodeInfo *getOrCreateNode(NodeNum n);
 
-    /// Notify observers of changes to the DB
+    /// @return the index in nodes[] of the least recently heard node (other than us)
+    size_t findOldestNode();
+
+    /// Move the least recently heard node out to flash
+    /// @return the index in nodes[] that is now free for reuse
+    size_t evictOldestNode();
+
+    /// Move nodes out to flash until we have no more than MAX_NUM_HOT_NODES (our saved DB can hold more), must be called
+    /// before anything indexes the arrays we only keep for our hot nodes
+    void evictExcessNodes();
+
+    /**
+     * Notify observers of changes to the DB, but only if our counts have changed (or forceUpdate is set).  Observers hear
+     * about it from the scheduler (so the screen isn't redrawn from inside packet processing), and several changes in a row
+     * become one notification with the latest counts.
+     */
     void notifyObservers(bool forceUpdate = false)
     {
-        // Notify observers of the current node state
-        const meshtastic::NodeStatus status = meshtastic::NodeStatus(getNumOnlineNodes(), getNumNodes(), forceUpdate);
-        newStatus.notifyObservers(&status);
+        size_t numTotal = getNumTotalNodes();
+        if (!forceUpdate && numOnline == lastNotifiedOnline && numTotal == lastNotifiedTotal)
+            return;
+
+        lastNotifiedOnline = numOnline;
+        lastNotifiedTotal = numTotal;
+
+        // Don't lose the forceUpdate of a notification which hasn't been delivered yet
+        forceUpdate |= newStatus.isPending() && pendingStatus.forceUpdate;
+
+        pendingStatus.set(numOnline, numTotal, forceUpdate);
+        newStatus.notifyObserversDeferred(&pendingStatus);
     }
 
+    /// Mark nodes[x] as changed in our current sync generation
+    void touchNode(size_t x) { nodeGenerations[x] = ++syncGeneration; }
+
+    /// Our nodes array was replaced, so any sync tokens we gave out are now meaningless
+    void invalidateSyncGenerations();
+
+    /// Call after the lastSeen time of nodes[x] might have changed, to update numOnline and our expiry schedule
+    void updateOnline(size_t x);
+
+    /// Stop counting nodes[x] as online (because it is about to be evicted)
+    void forgetOnline(size_t x);
+
+    /// Add an entry for this (online) node to our expiry schedule
+    void scheduleExpiry(const NodeInfo *info);
+
+    /// Recompute numOnline and our expiry schedule from scratch (after the nodes array was changed behind our back)
+    void recountOnline();
+
+    /// @return msecs until the first node in our schedule goes offline
+    int32_t msecsUntilExpiry();
+
     /// read our db from flash
     void loadFromDisk();
 
+    /// apply any changes from our journal on top of the snapshot we just loaded
+    void replayJournal();
+
+    /// Append a change to the journal (if we have one yet)
+    void journalChange(JournalRecordType type, const pb_msgdesc_t *fields, const void *src)
+    {
+        if (journal)
+            journal->append(type, fields, src);
+    }
+
     /// Reinit device state from scratch (not loading from disk)
     void installDefaultDeviceState();
 };
@@ -0,0 +1,149 @@
+#include "NodeDBJournal.h"
+#include "FSCommon.h"
+#include "configuration.h"
+#include <assert.h>
+#include <pb_encode.h>
+
+#define JOURNAL_HEADER_LEN 3
+
+/// The largest payload we will ever journal
+#define JOURNAL_MAX_PAYLOAD RadioConfig_size
+
+static const char *journalfile = "/db.journal";
+
+NodeDBJournal::NodeDBJournal(uint32_t snapshotGeneration, std::function<void()> _compact)
+    : concurrency::OSThread("Journal", JOURNAL_FLUSH_MSECS), generation(snapshotGeneration), compact(_compact)
+{
+    priority = concurrency::THREAD_PRIORITY_BACKGROUND;
+#ifdef FS
+    auto f = FS.open(journalfile);
+    if (f) {
+        fileSize = f.size();
+        f.close();
+    }
+#endif
+}
+
+void NodeDBJournal::append(JournalRecordType type, const pb_msgdesc_t *fields, const void *src)
+{
+    static_assert(JOURNAL_MAX_PAYLOAD + JOURNAL_HEADER_LEN <= JOURNAL_BUF_SIZE, "journal buffer too small");
+
+    if (numPending + JOURNAL_HEADER_LEN + JOURNAL_MAX_PAYLOAD > JOURNAL_BUF_SIZE)
+        flush(); // Make sure we have room for the biggest possible record
+
+    uint8_t *p = pending + numPending;
+    size_t len = pb_encode_to_bytes(p + JOURNAL_HEADER_LEN, JOURNAL_MAX_PAYLOAD, fields, src);
+    p[0] = type;
+    p[1] = len & 0xff;
+    p[2] = (len >> 8) & 0xff;
+
+    numPending += JOURNAL_HEADER_LEN + len;
+}
+
+void NodeDBJournal::flush()
+{
+    if (!numPending)
+        return;
+
+#ifdef FS
+    uint32_t start = millis();
+
+    auto f = FS.open(journalfile, FILE_O_APPEND);
+    if (f) {
+        size_t numWritten = numPending;
+        if (!fileSize) {
+            // A new journal, say which snapshot it belongs to
+            uint8_t header[JOURNAL_HEADER_LEN + sizeof(generation)] = {JOURNAL_GENERATION, sizeof(generation), 0};
+            for (size_t i = 0; i < sizeof(generation); i++)
+                header[JOURNAL_HEADER_LEN + i] = (generation >> (8 * i)) & 0xff;
+            if (f.write(header, sizeof(header)) != sizeof(header))
+                DEBUG_MSG("Error: can't write journal header\n");
+            numWritten += sizeof(header);
+        }
+        if (f.write(pending, numPending) != numPending)
+            DEBUG_MSG("Error: can't append to journal\n");
+        f.close();
+
+        fileSize += numWritten;
+        journalBytesWritten += numWritten;
+        journalWrites++;
+
+        uint32_t elapsed = millis() - start;
+        if (elapsed > maxFlushMsec)
+            maxFlushMsec = elapsed;
+        DEBUG_MSG("Journal: appended %u bytes in %u ms (%u bytes in %u writes since boot)\n", numPending, elapsed,
+                  journalBytesWritten, journalWrites);
+    } else
+        DEBUG_MSG("Error: can't open journal\n");
+#endif
+
+    numPending = 0;
+}
+
+void NodeDBJournal::clear(uint32_t snapshotGeneration)
+{
+    generation = snapshotGeneration;
+    numPending = 0;
+    fileSize = 0;
+#ifdef FS
+    FS.remove(journalfile);
+#endif
+}
+
+size_t NodeDBJournal::replay(std::function<void(JournalRecordType type, const uint8_t *payload, size_t len)> handler)
+{
+    size_t numRecords = 0;
+
+#ifdef FS
+    auto f = FS.open(journalfile);
+    if (!f)
+        return 0;
+
+    uint8_t header[JOURNAL_HEADER_LEN];
+    uint8_t payload[JOURNAL_MAX_PAYLOAD];
+    bool checkedGeneration = false;
+    while (f.read(header, sizeof(header)) == sizeof(header)) {
+        size_t len = header[1] | (header[2] << 8);
+        if (len > sizeof(payload) || f.read(payload, len) != (int)len) {
+            DEBUG_MSG("Warning: ignoring torn journal record\n");
+            break;
+        }
+
+        if (!checkedGeneration) {
+            uint32_t g = 0;
+            if (header[0] == JOURNAL_GENERATION && len == sizeof(g))
+                g = payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+            if (header[0] != JOURNAL_GENERATION || len != sizeof(g) || g != generation) {
+                // Probably we lost power between writing a snapshot and clearing the journal, so the snapshot has these already
+                DEBUG_MSG("Warning: discarding journal, it isn't for snapshot generation %u\n", generation);
+                f.close();
+                clear(generation);
+                return 0;
+            }
+            checkedGeneration = true;
+            continue;
+        }
+
+        handler((JournalRecordType)header[0], payload, len);
+        numRecords++;
+    }
+    f.close();
+
+    DEBUG_MSG("Replayed %d journal records\n", numRecords);
+#endif
+
+    return numRecords;
+}
+
+int32_t NodeDBJournal::runOnce()
+{
+    flush();
+
+    // If the journal has grown large, fold it into a new snapshot (which also empties the journal)
+    if (fileSize > JOURNAL_COMPACT_SIZE) {
+        DEBUG_MSG("Journal is %u bytes, compacting\n", fileSize);
+        compact();
+    }
+
+    return JOURNAL_FLUSH_MSECS;
+}
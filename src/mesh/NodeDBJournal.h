@@ -0,0 +1,81 @@
+#pragma once
+
+#include "concurrency/OSThread.h"
+#include "mesh-pb-constants.h"
+#include <functional>
+
+/// The types of delta records we can append to the journal
+enum JournalRecordType {
+    JOURNAL_NODE = 1,  // A NodeInfo, upsert the entire record
+    JOURNAL_POSITION,  // A NodeInfo with only num and position set
+    JOURNAL_USER,      // A NodeInfo with only num and user set
+    JOURNAL_RADIO,     // A RadioConfig
+    JOURNAL_CHANNEL,   // A Channel (which includes its own index)
+    JOURNAL_OWNER,     // A User, for our owner
+    JOURNAL_GENERATION // Always the first record: the generation (little endian uint32) of the snapshot the rest apply to
+};
+
+/// How many bytes of records we buffer in RAM before forcing a flash write
+#define JOURNAL_BUF_SIZE 512
+
+/// How long we let records sit in our RAM buffer before writing them to flash
+#define JOURNAL_FLUSH_MSECS (30 * 1000)
+
+/// Once the journal file grows past this size, we compact it into a new snapshot (i.e. NodeDB::saveToDisk)
+#define JOURNAL_COMPACT_SIZE (8 * 1024)
+
+/**
+ * A write-ahead journal of small changes to our DeviceState.
+ *
+ * Rewriting the entire DeviceState protobuf (db.proto) for every node update would be slow and wear out our flash.  Instead
+ * NodeDB appends small delta records here and only periodically writes a new snapshot (which empties the journal).  At boot we
+ * load the snapshot and then replay the journal on top of it.
+ *
+ * Each record on flash is a one byte JournalRecordType, a two byte (little endian) length and then the protobuf encoded payload.
+ * Records are batched in RAM and normally written by our thread, but append() writes the buffer itself if it is too full for
+ * another record (so a burst of changes can block a caller on flash).  A torn final record (because we lost power mid write) is
+ * detected and ignored during replay.
+ *
+ * The journal starts with the generation of the snapshot it was written on top of (see NodeDB::saveToDisk), so if we lose power
+ * after writing a new snapshot but before clearing the journal, replay skips the old records instead of applying them again.
+ */
+class NodeDBJournal : private concurrency::OSThread
+{
+    /// Records which have not yet been written to flash
+    uint8_t pending[JOURNAL_BUF_SIZE];
+    size_t numPending = 0;
+
+    /// The current size of the journal file (so we know when to compact)
+    size_t fileSize = 0;
+
+    /// The generation of the snapshot our records apply to
+    uint32_t generation;
+
+    /// Called (from our thread) once the journal is big enough to fold into a new snapshot, which must then call clear()
+    std::function<void()> compact;
+
+  public:
+    /// Stats, for measuring how hard we are on our flash
+    uint32_t journalBytesWritten = 0, journalWrites = 0, maxFlushMsec = 0;
+
+    NodeDBJournal(uint32_t snapshotGeneration, std::function<void()> compact);
+
+    /// Encode and queue a record for appending to flash
+    void append(JournalRecordType type, const pb_msgdesc_t *fields, const void *src);
+
+    /// Write any buffered records to flash now
+    void flush();
+
+    /// Discard all journal records (because they have been folded into a new snapshot), later records apply to snapshotGeneration
+    void clear(uint32_t snapshotGeneration);
+
+    /**
+     * Read all records in the journal (in the order they were written), calling handler for each one.  If the journal was
+     * written on top of some other snapshot than ours it is discarded instead.
+     * @return the number of records read
+     */
+    size_t replay(std::function<void(JournalRecordType type, const uint8_t *payload, size_t len)> handler);
+
+  protected:
+    virtual int32_t runOnce();
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// Round n up to the next power of two (usable at compile time)
+constexpr size_t nextPowerOfTwo(size_t n, size_t p = 1)
+{
+    return p >= n ? p : nextPowerOfTwo(n, p << 1);
+}
+
+/**
+ * An open addressing (linear probing) hash table from node number to the position of that node in an array of nodes (which
+ * the caller owns, Node just needs a num field).  Each slot holds the node index + 1, or 0 if the slot is empty.
+ *
+ * The caller must keep the table at most half full (numSlots >= 2 * the most nodes it will hold), so that probe sequences stay
+ * short and a probe always ends at an empty slot.
+ */
+template <class Node, size_t numSlots> class NodeIndex
+{
+    static_assert(numSlots && (numSlots & (numSlots - 1)) == 0, "numSlots must be a power of two");
+
+    uint16_t slots[numSlots];
+
+    /// @return the first slot we should probe when looking for n
+    static size_t slotFor(uint32_t n) { return ((uint32_t)(n * 2654435761u) >> 16) & (numSlots - 1); }
+
+    static size_t nextSlot(size_t slot) { return (slot + 1) & (numSlots - 1); }
+
+  public:
+    NodeIndex() { clear(); }
+
+    void clear() { memset(slots, 0, sizeof(slots)); }
+
+    /**
+     * @return the index in nodes[] of node n, or -1 if it isn't there
+     * NOTE: This might be called from an ISR, so it must not allocate or block.
+     */
+    int find(const Node *nodes, size_t numNodes, uint32_t n) const
+    {
+        for (size_t slot = slotFor(n);; slot = nextSlot(slot)) {
+            uint16_t entry = slots[slot];
+            if (!entry)
+                return -1;
+
+            size_t x = entry - 1;
+            if (x < numNodes && nodes[x].num == n)
+                return x;
+        }
+    }
+
+    /// Add nodes[x]
+    void add(const Node *nodes, size_t x)
+    {
+        size_t slot = slotFor(nodes[x].num);
+        while (slots[slot])
+            slot = nextSlot(slot);
+
+        slots[slot] = x + 1;
+    }
+
+    /**
+     * Remove nodes[x]
+     * Note: any entries later in the same probe chain are briefly absent from the table while we reinsert them, so an ISR
+     * calling find() during this window might miss them (but will never see the wrong node).
+     */
+    void remove(const Node *nodes, size_t x)
+    {
+        size_t slot = slotFor(nodes[x].num);
+        while (slots[slot] != x + 1) {
+            assert(slots[slot]); // the node must be in the table
+            slot = nextSlot(slot);
+        }
+        slots[slot] = 0;
+
+        // Reinsert the rest of this cluster, so that no probe sequence is broken by the hole we just made
+        for (slot = nextSlot(slot); slots[slot]; slot = nextSlot(slot)) {
+            size_t other = slots[slot] - 1;
+            slots[slot] = 0;
+            add(nodes, other);
+        }
+    }
+
+    /// Rebuild the table from scratch (after the nodes array was changed behind our back)
+    void rebuild(const Node *nodes, size_t numNodes)
+    {
+        clear();
+        for (size_t i = 0; i < numNodes; i++)
+            add(nodes, i);
+    }
+};
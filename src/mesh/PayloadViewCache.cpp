@@ -0,0 +1,72 @@
+#include "PayloadViewCache.h"
+#include "configuration.h"
+#include <assert.h>
+#include <stdlib.h>
+
+void PayloadViewCache::endDispatch()
+{
+    assert(depth > 0);
+    if (--depth == 0)
+        reset();
+}
+
+const void *PayloadViewCache::get(const MeshPacket &mp, const pb_msgdesc_t *fields, size_t structSize)
+{
+    assert(depth > 0); // We only keep views while dispatching
+    assert(mp.which_payloadVariant == MeshPacket_decoded_tag);
+
+    for (size_t i = 0; i < numViews; i++)
+        if (views[i].packet == &mp && views[i].packetId == mp.id && views[i].fields == fields) {
+            numReused++;
+            return views[i].decoded;
+        }
+
+    if (numViews == PAYLOAD_MAX_VIEWS) { // Only possible if dispatches nest very deeply
+        DEBUG_MSG("Error: too many payload views, can't decode portnum %d\n", mp.decoded.portnum);
+        return NULL;
+    }
+
+    View &v = views[numViews++];
+    v.packet = &mp;
+    v.packetId = mp.id;
+    v.fields = fields;
+    v.decoded = alloc(structSize, v.onHeap);
+
+    memset(v.decoded, 0, structSize);
+    numDecodes++;
+    if (!pb_decode_from_bytes(mp.decoded.payload.bytes, mp.decoded.payload.size, fields, v.decoded)) {
+        DEBUG_MSG("Error decoding payload for portnum %d\n", mp.decoded.portnum);
+        if (v.onHeap)
+            free(v.decoded);
+        v.decoded = NULL; // Remember the failure, so we don't try again
+        v.onHeap = false;
+    }
+
+    return v.decoded;
+}
+
+void *PayloadViewCache::alloc(size_t structSize, bool &onHeap)
+{
+    size_t aligned = (structSize + sizeof(arena.alignment) - 1) & ~(sizeof(arena.alignment) - 1);
+    if (arenaUsed + aligned <= sizeof(arena.bytes)) {
+        void *p = arena.bytes + arenaUsed;
+        arenaUsed += aligned;
+        onHeap = false;
+        return p;
+    }
+
+    // Only possible for nested dispatches, which are rare
+    onHeap = true;
+    void *p = malloc(structSize);
+    assert(p);
+    return p;
+}
+
+void PayloadViewCache::reset()
+{
+    for (size_t i = 0; i < numViews; i++)
+        if (views[i].onHeap)
+            free(views[i].decoded);
+    numViews = 0;
+    arenaUsed = 0;
+}
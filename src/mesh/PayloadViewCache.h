@@ -0,0 +1,64 @@
+#pragma once
+
+#include "mesh-pb-constants.h"
+
+/// How many bytes of decoded payloads we can hold during one dispatch (the biggest plugin payload, AdminMessage, is ~270)
+#define PAYLOAD_ARENA_SIZE 512
+
+/// How many different decoded payloads we remember during one dispatch (normally we need one per nested dispatch)
+#define PAYLOAD_MAX_VIEWS 8
+
+/**
+ * Decoded payloads for the packet(s) MeshPlugin::callPlugins is currently dispatching, so that if several plugins (or other
+ * consumers) want the same payload as the same protobuf type it is only decoded once.
+ *
+ * The decoded structs live in a small arena which is reset after each dispatch, so views are only valid until the consumer
+ * returns from handleReceived().  Dispatches can nest (a plugin can send a broadcast, which we also deliver to ourselves), so
+ * we only reset once the outermost dispatch is done.
+ */
+class PayloadViewCache
+{
+    struct View {
+        const MeshPacket *packet;
+        uint32_t packetId; // in case a packet is freed and another allocated in its place during a nested dispatch
+        const pb_msgdesc_t *fields;
+        void *decoded; // NULL if the payload could not be decoded
+        bool onHeap;   // because the arena was full
+    };
+
+    View views[PAYLOAD_MAX_VIEWS];
+    size_t numViews = 0;
+
+    /// Our arena (aligned for any protobuf struct) and how much of it is in use
+    union {
+        uint8_t bytes[PAYLOAD_ARENA_SIZE];
+        uint64_t alignment;
+    } arena;
+    size_t arenaUsed = 0;
+
+    /// How deeply nested our current dispatches are
+    int depth = 0;
+
+  public:
+    /// Stats, to see how much decoding we save
+    uint32_t numDecodes = 0, numReused = 0;
+
+    /// Call before dispatching a packet
+    void beginDispatch() { depth++; }
+
+    /// Call after dispatching a packet, frees our views once the outermost dispatch is done
+    void endDispatch();
+
+    /**
+     * @return the payload of mp decoded as a structSize byte protobuf described by fields, or NULL if it could not be decoded.
+     * Only call this while dispatching, the result is only valid until the current dispatch ends.
+     */
+    const void *get(const MeshPacket &mp, const pb_msgdesc_t *fields, size_t structSize);
+
+  private:
+    /// @return room for a structSize byte struct (from our arena if we can)
+    void *alloc(size_t structSize, bool &onHeap);
+
+    /// Forget all our views
+    void reset();
+};
@@ -5,6 +5,7 @@
 #include "PowerFSM.h"
 #include "RadioInterface.h"
 #include "Channels.h"
+#include "RecordBatch.h"
 #include <assert.h>
 
 #if FromRadio_size > MAX_TO_FROM_RADIO_SIZE
@@ -15,11 +16,45 @@
 #error ToRadio is too big
 #endif
 
+#if ONE_RECORD_BATCH_BYTES > MAX_TO_FROM_RADIO_SIZE
+#error FromRadio is too big to batch
+#endif
+
 PhoneAPI::PhoneAPI() {}
 
 void PhoneAPI::init()
 {
     observe(&service.fromNumChanged);
+    attachToPackets();
+}
+
+void PhoneAPI::attachToPackets()
+{
+    service.toPhoneQueue.attach(&packetReader);
+    if (service.phoneStore)
+        service.phoneStore->attach(&storeReader);
+}
+
+void PhoneAPI::detachFromPackets()
+{
+    service.toPhoneQueue.detach(&packetReader);
+    if (service.phoneStore)
+        service.phoneStore->detach(&storeReader);
+}
+
+bool PhoneAPI::isLegacyClient() const
+{
+    return clientSyncGeneration == SYNC_GENERATION_LEGACY;
+}
+
+void PhoneAPI::queueStatusFor(int32_t result, uint32_t packetId)
+{
+    if (isLegacyClient())
+        return;
+
+    queueStatusPending = true;
+    lastSendResult = result;
+    lastSendId = packetId;
 }
 
 PhoneAPI::~PhoneAPI() {
@@ -28,7 +63,10 @@ PhoneAPI::~PhoneAPI() {
 
 void PhoneAPI::close() {
     unobserve();
+    detachFromPackets();
     state = STATE_SEND_NOTHING;
+    batchBytes = 0; // The next client might not know about batching
+    pendingLen = 0;
     bool oldConnected = isConnected;
     isConnected = false;
     if(oldConnected != isConnected)
@@ -47,9 +85,26 @@ void PhoneAPI::checkConnectionTimeout()
 }
 
 /**
- * Handle a ToRadio protobuf
+ * Handle a ToRadio protobuf (or a batch of them)
  */
 void PhoneAPI::handleToRadio(const uint8_t *buf, size_t bufLength)
+{
+    if (!batchBytes) {
+        handleToRadioRecord(buf, bufLength);
+        return;
+    }
+
+    RecordBatchReader batch(buf, bufLength);
+    const uint8_t *record;
+    size_t recordLen;
+    while (batch.next(&record, &recordLen))
+        handleToRadioRecord(record, recordLen);
+
+    if (batch.isMalformed())
+        DEBUG_MSG("Error: ignoring rest of malformed toradio batch\n");
+}
+
+void PhoneAPI::handleToRadioRecord(const uint8_t *buf, size_t bufLength)
 {
     powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // As long as the phone keeps talking to us, don't let the radio go to sleep
     lastContactMsec = millis();
@@ -65,18 +120,36 @@ void PhoneAPI::handleToRadio(const uint8_t *buf, size_t bufLength)
         case ToRadio_packet_tag: {
             MeshPacket &p = toRadioScratch.packet;
             printPacket("PACKET FROM PHONE", &p);
-            service.handleToRadio(p);
+
+            // Newer clients are told how many packets they can send, and we hold them to that
+            ErrorCode res;
+            if (!isLegacyClient() && !service.getTxCredits()) {
+                DEBUG_MSG("Client has no tx credits, rejecting packet\n");
+                res = ERRNO_QUEUE_FULL;
+            } else
+                res = service.handleToRadio(p);
+
+            queueStatusFor(res, p.id);
             break;
         }
         case ToRadio_want_config_id_tag:
             config_nonce = toRadioScratch.want_config_id;
-            DEBUG_MSG("Client wants config, nonce=%u\n", config_nonce);
+            clientSyncGeneration = toRadioScratch.node_db_generation;
+            DEBUG_MSG("Client wants config, nonce=%u, node db generation=%u\n", config_nonce, clientSyncGeneration);
             state = STATE_SEND_MY_INFO;
 
-            DEBUG_MSG("Reset nodeinfo read pointer\n");
-            nodeInfoForPhone = NULL;   // Don't keep returning old nodeinfos
-            nodeDB.resetReadPointer(); // FIXME, this read pointer should be moved out of nodeDB and into this class - because
-                                       // this will break once we have multiple instances of PhoneAPI running independently
+            nodeReadIndex = 0; // Start sending nodeinfos from the beginning
+            attachToPackets(); // Some transports (i.e. HTTP) never call init()
+
+            // From now on the client's writes (and, after the MyNodeInfo which tells it we agreed, our reads) are batched
+            batchBytes = 0;
+            pendingLen = 0;
+            if (supportsBatching() && toRadioScratch.max_batch_bytes) {
+                batchBytes = toRadioScratch.max_batch_bytes;
+                if (batchBytes > MAX_TO_FROM_RADIO_SIZE)
+                    batchBytes = MAX_TO_FROM_RADIO_SIZE;
+                DEBUG_MSG("Client wants batches of up to %u bytes\n", batchBytes);
+            }
             break;
 
         default:
@@ -125,27 +198,44 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
                                  : (gps && gps->isConnected()); // Update with latest GPS connect info
         fromRadioScratch.which_payloadVariant = FromRadio_my_info_tag;
         fromRadioScratch.my_info = myNodeInfo;
+        // Any node which changes after this point will be sent again on the next incremental sync
+        fromRadioScratch.my_info.node_db_generation = nodeDB.getSyncGeneration();
+        fromRadioScratch.my_info.max_batch_bytes = batchBytes;
         state = STATE_SEND_NODEINFO;
 
         service.refreshMyNodeInfo();  // Update my NodeInfo because the client will be asking for it soon.
         break;
 
     case STATE_SEND_NODEINFO: {
-        const NodeInfo *info = nodeInfoForPhone;
-        nodeInfoForPhone = NULL; // We just consumed a nodeinfo, will need a new one next time
-
-        if (info) {
-            DEBUG_MSG("Sending nodeinfo: num=0x%x, lastseen=%u, id=%s, name=%s\n", info->num, info->position.time, info->user.id,
-                      info->user.long_name);
-            fromRadioScratch.which_payloadVariant = FromRadio_node_info_tag;
-            fromRadioScratch.node_info = *info;
-            // Stay in current state until done sending nodeinfos
+        if (clientSyncGeneration == SYNC_GENERATION_LEGACY) {
+            // Old clients only understand one nodeinfo per FromRadio
+            if (const NodeInfo *info = nodeDB.readNextInfo(nodeReadIndex, clientSyncGeneration)) {
+                DEBUG_MSG("Sending nodeinfo: num=0x%x, lastseen=%u, id=%s, name=%s\n", info->num, info->position.time,
+                          info->user.id, info->user.long_name);
+                fromRadioScratch.which_payloadVariant = FromRadio_node_info_tag;
+                fromRadioScratch.node_info = *info;
+            }
         } else {
+            // Fill a batch with as many nodes (changed since the client's generation) as will fit
+            NodeInfoBatch &batch = fromRadioScratch.node_infos;
+            const NodeInfo *info;
+            while (batch.nodes_count < sizeof(batch.nodes) / sizeof(batch.nodes[0]) &&
+                   (info = nodeDB.readNextInfo(nodeReadIndex, clientSyncGeneration)) != NULL)
+                batch.nodes[batch.nodes_count++] = *info;
+
+            if (batch.nodes_count) {
+                DEBUG_MSG("Sending %d nodeinfos, first num=0x%x\n", batch.nodes_count, batch.nodes[0].num);
+                fromRadioScratch.which_payloadVariant = FromRadio_node_infos_tag;
+            }
+        }
+
+        if (fromRadioScratch.which_payloadVariant == 0) {
             DEBUG_MSG("Done sending nodeinfos\n");
             state = STATE_SEND_COMPLETE_ID;
             // Go ahead and send that ID right now
             return getFromRadio(buf);
         }
+        // Stay in current state until done sending nodeinfos
         break;
     }
 
@@ -154,12 +244,28 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
         fromRadioScratch.config_complete_id = config_nonce;
         config_nonce = 0;
         state = STATE_SEND_PACKETS;
+        queueStatusFor(ERRNO_OK, 0); // Let the client know how many packets it can send
         break;
 
     case STATE_LEGACY: // Treat as the same as send packets
     case STATE_SEND_PACKETS:
+        if (queueStatusPending) {
+            fromRadioScratch.which_payloadVariant = FromRadio_queue_status_tag;
+            QueueStatus &status = fromRadioScratch.queue_status;
+            status.res = lastSendResult;
+            status.free = reportedCredits = service.getTxCredits();
+            status.maxlen = service.getMaxTxCredits();
+            status.mesh_packet_id = lastSendId;
+            queueStatusPending = false;
+        }
+        // Packets saved to flash are older than any in toPhoneQueue, so deliver them first
+        else if (service.phoneStore && service.phoneStore->peek(&storeReader, fromRadioScratch.packet)) {
+            printPacket("phone downloaded stored packet", &fromRadioScratch.packet);
+            fromRadioScratch.which_payloadVariant = FromRadio_packet_tag;
+            service.phoneStore->consume(&storeReader);
+        }
         // Do we have a message from the mesh?
-        if (packetForPhone) {
+        else if (const MeshPacket *packetForPhone = service.toPhoneQueue.peek(&packetReader)) {
 
             printPacket("phone downloaded packet", packetForPhone);
 
@@ -167,8 +273,7 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
             fromRadioScratch.which_payloadVariant = FromRadio_packet_tag;
             fromRadioScratch.packet = *packetForPhone;
 
-            service.releaseToPool(packetForPhone); // we just copied the bytes, so don't need this buffer anymore
-            packetForPhone = NULL;
+            service.toPhoneQueue.consume(&packetReader); // we just copied the bytes, the ring frees it once all clients have it
         }
         break;
 
@@ -188,11 +293,49 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
     return 0;
 }
 
+size_t PhoneAPI::getFromRadioBatch(uint8_t *buf, size_t preferredLen)
+{
+    if (!batchBytes || state == STATE_SEND_MY_INFO)
+        return getFromRadio(buf);
+
+    size_t limit = (preferredLen < batchBytes) ? preferredLen : batchBytes;
+
+    RecordBatchWriter batch(buf, limit);
+    for (;;) {
+        if (!pendingLen)
+            pendingLen = getFromRadio(pendingRecord);
+
+        if (!pendingLen)
+            break; // Nothing more to send
+
+        if (!batch.add(pendingRecord, pendingLen)) {
+            if (batch.count())
+                break; // It will go first in the next batch
+
+            // Too big for the MTU even on its own, so it goes alone in a batch the transport will have to fragment
+            RecordBatchWriter single(buf, ONE_RECORD_BATCH_BYTES);
+            bool added = single.add(pendingRecord, pendingLen);
+            assert(added);
+            pendingLen = 0;
+            DEBUG_MSG("Sending oversized batch of one FromRadio, %u bytes\n", single.length());
+            return single.length();
+        }
+
+        pendingLen = 0;
+    }
+
+    DEBUG_MSG("Sending batch of %u FromRadios, %u bytes\n", batch.count(), batch.length());
+    return batch.length();
+}
+
 /**
  * Return true if we have data available to send to the phone
  */
 bool PhoneAPI::available()
 {
+    if (pendingLen)
+        return true; // Left over from our last batch
+
     switch (state) {
     case STATE_SEND_NOTHING:
         return false;
@@ -201,8 +344,6 @@ bool PhoneAPI::available()
         return true;
 
     case STATE_SEND_NODEINFO:
-        if (!nodeInfoForPhone)
-            nodeInfoForPhone = nodeDB.readNextInfo();
         return true; // Always say we have something, because we might need to advance our state machine
 
     case STATE_SEND_COMPLETE_ID:
@@ -210,12 +351,19 @@ bool PhoneAPI::available()
 
     case STATE_LEGACY: // Treat as the same as send packets
     case STATE_SEND_PACKETS: {
-        // Try to pull a new packet from the service (if we haven't already)
-        if (!packetForPhone)
-            packetForPhone = service.getForPhone();
-        bool hasPacket = !!packetForPhone;
+        if (getNumDropped() != reportedDropped) {
+            DEBUG_MSG("Warning: client missed %u packets (%u total)\n", getNumDropped() - reportedDropped, getNumDropped());
+            reportedDropped = getNumDropped();
+        }
+
+        // If we told the client it had no credits, tell it as soon as it can send again
+        if (!reportedCredits && !queueStatusPending && !isLegacyClient() && service.getTxCredits())
+            queueStatusFor(ERRNO_OK, 0);
+
+        bool hasPacket = service.toPhoneQueue.peek(&packetReader) != NULL ||
+                         (service.phoneStore && service.phoneStore->hasUnread(&storeReader));
         // DEBUG_MSG("available hasPacket=%d\n", hasPacket);
-        return hasPacket;
+        return hasPacket || queueStatusPending;
     }
 
     default:
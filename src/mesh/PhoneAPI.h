@@ -1,12 +1,16 @@
 #pragma once
 
 #include "Observer.h"
+#include "PhonePacketRing.h"
 #include "mesh-pb-constants.h"
 #include <string>
 
 // Make sure that we never let our packets grow too large for one BLE packet
 #define MAX_TO_FROM_RADIO_SIZE 512
 
+/// The most bytes a batch holding just one FromRadio (plus its length) can take
+#define ONE_RECORD_BATCH_BYTES (FromRadio_size + 2)
+
 /**
  * Provides our protobuf based API which phone/PC clients can use to talk to our device
  * over UDP, bluetooth or serial.
@@ -37,12 +41,40 @@ class PhoneAPI
      */
     uint32_t fromRadioNum = 0;
 
-    /// We temporarily keep the packet here between the call to available and getFromRadio.  We will free it after the phone
-    /// downloads it
-    MeshPacket *packetForPhone = NULL;
+    /// Our cursor into service.toPhoneQueue (which is shared with any other connected clients)
+    PhonePacketRing::Reader packetReader;
+
+    /// Our cursor into service.phoneStore (also shared), see PhonePacketStore::Reader
+    PhonePacketRing::Reader storeReader;
+
+    /// The number of dropped packets we last reported (so we only log when it changes)
+    uint32_t reportedDropped = 0;
+
+    /// Our cursor into the node DB while we are sending nodeinfos (see NodeDB::readNextInfo)
+    uint32_t nodeReadIndex = 0;
+
+    /** The node DB generation the client had at the end of its last sync (or SYNC_GENERATION_LEGACY/SYNC_GENERATION_FULL).
+     * Unless this is SYNC_GENERATION_LEGACY we send nodeinfos packed several to a FromRadio.
+     */
+    uint32_t clientSyncGeneration = 0;
 
-    /// We temporarily keep the nodeInfo here between the call to available and getFromRadio
-    const NodeInfo *nodeInfoForPhone = NULL;
+    /// We owe the client a QueueStatus (telling it how many packets it may send us), never set for legacy clients
+    bool queueStatusPending = false;
+
+    /// The result and id of the last packet the client sent us, for that QueueStatus
+    int32_t lastSendResult = 0;
+    uint32_t lastSendId = 0;
+
+    /// The tx credits we last told the client about
+    uint32_t reportedCredits = 0;
+
+    /// If nonzero, the client asked for (and our transport supports) batches of up to this many bytes.  Then each write from
+    /// the client can contain several ToRadios and each read several FromRadios (see getFromRadioBatch()).
+    uint32_t batchBytes = 0;
+
+    /// An encoded FromRadio which didn't fit in the last batch, we send it first in the next one
+    uint8_t pendingRecord[FromRadio_size];
+    size_t pendingLen = 0;
 
     ToRadio toRadioScratch; // this is a static scratch object, any data must be copied elsewhere before returning
 
@@ -66,7 +98,7 @@ class PhoneAPI
     virtual void close();
 
     /**
-     * Handle a ToRadio protobuf
+     * Handle a ToRadio protobuf (or if the client asked for batching, a batch of length delimited ToRadios)
      */
     virtual void handleToRadio(const uint8_t *buf, size_t len);
 
@@ -78,11 +110,25 @@ class PhoneAPI
      */
     size_t getFromRadio(uint8_t *buf);
 
+    /**
+     * Get as many FromRadios as will fit in preferredLen bytes (i.e. what fits in one read at the negotiated BLE MTU, or the
+     * batch size the client asked for, if smaller), each preceded by its length as a varint.  If the next FromRadio won't fit
+     * on its own we return it as a batch of one anyway (up to ONE_RECORD_BATCH_BYTES), which the transport must fragment.  If the client did not ask for batching (and always for the MyNodeInfo which tells it whether we
+     * agreed) this returns a single unprefixed FromRadio, just like getFromRadio().
+     *
+     * We assume buf is at least MAX_TO_FROM_RADIO_SIZE bytes long.
+     * Returns number of bytes used in buf (or 0 if nothing is available)
+     */
+    size_t getFromRadioBatch(uint8_t *buf, size_t preferredLen);
+
     /**
      * Return true if we have data available to send to the phone
      */
     bool available();
 
+    /// @return how many packets from the mesh this client missed (because it didn't read them before they were discarded)
+    uint32_t getNumDropped() const { return packetReader.dropped + storeReader.dropped; }
+
   protected:
     /// Are we currently connected to a client?
     bool isConnected = false;
@@ -93,6 +139,9 @@ class PhoneAPI
     /// Hookable to find out when connection changes
     virtual void onConnectionChanged(bool connected) {}
 
+    /// Transports which read with getFromRadioBatch() should return true, so clients can ask for batching
+    virtual bool supportsBatching() { return false; }
+
   /// If we haven't heard from the other side in a while then say not connected
     void checkConnectionTimeout();
 
@@ -101,7 +150,23 @@ class PhoneAPI
      */
     virtual void onNowHasData(uint32_t fromRadioNum) {}
 
+    /// Start receiving packets from service.toPhoneQueue (if we aren't already)
+    void attachToPackets();
+
+    /// Stop holding packets in service.toPhoneQueue (and the phone store) for this client
+    void detachFromPackets();
+
   private:
+    /// Old clients only understand one NodeInfo per FromRadio and don't know about QueueStatus (they tell us they are new by
+    /// setting ToRadio.node_db_generation)
+    bool isLegacyClient() const;
+
+    /// Tell the client (on our next FromRadio) how many packets it can send us
+    void queueStatusFor(int32_t result, uint32_t packetId);
+
+    /// Handle one (unbatched) ToRadio protobuf
+    void handleToRadioRecord(const uint8_t *buf, size_t len);
+
     /**
      * Handle a packet that the phone wants us to send.  It is our responsibility to free the packet to the pool
      */
@@ -0,0 +1,198 @@
+#include "PhonePacketRing.h"
+#include "MeshTypes.h"
+#include "configuration.h"
+#include <assert.h>
+
+void PhonePacketRing::push(MeshPacket *p)
+{
+    if (isFull()) {
+        // Text messages are worth more than anything else we might be holding
+        if (classify(slot(tail)) != PHONE_CLASS_RETAINED || !dropOldestExpendable()) {
+            DEBUG_MSG("NOTE: tophone ring is full, discarding oldest\n");
+            dropOldest();
+        }
+    }
+
+    stats[classify(p)].queued++;
+    slot(head) = p;
+    refsFor(head) = numReaders;
+    head++;
+}
+
+bool PhonePacketRing::attach(Reader *r)
+{
+    if (find(r) >= 0)
+        return true;
+
+    if (numReaders == MAX_PHONE_READERS) {
+        DEBUG_MSG("Warning: too many phone clients, this one will not receive packets\n");
+        return false;
+    }
+    readers[numReaders++] = r;
+
+    // The new reader needs everything we currently hold
+    r->next = tail;
+    for (uint32_t seq = tail; seq != head; seq++)
+        refsFor(seq)++;
+
+    return true;
+}
+
+void PhonePacketRing::detach(Reader *r)
+{
+    int x = find(r);
+    if (x < 0)
+        return;
+
+    readers[x] = readers[--numReaders];
+
+    // This reader no longer needs anything it hasn't read yet
+    for (uint32_t seq = r->next; seq != head; seq++)
+        refsFor(seq)--;
+
+    releaseConsumed();
+}
+
+const MeshPacket *PhonePacketRing::peek(const Reader *r) const
+{
+    return (r->next != head) ? packets[r->next % MAX_RX_TOPHONE] : NULL;
+}
+
+void PhonePacketRing::consume(Reader *r)
+{
+    assert(r->next != head);
+
+    refsFor(r->next)--;
+    r->next++;
+
+    releaseConsumed();
+}
+
+bool PhonePacketRing::coalesce(MeshPacket *p)
+{
+    if (classify(p) != PHONE_CLASS_LATEST)
+        return false;
+
+    // Find the newest packet like this one, if any reader has read it then it has also read any older ones
+    for (uint32_t seq = head; seq != tail;) {
+        seq--;
+        MeshPacket *old = slot(seq);
+        if (old->from == p->from && old->to == p->to && classify(old) == PHONE_CLASS_LATEST &&
+            old->decoded.portnum == p->decoded.portnum) {
+            if (refsFor(seq) != numReaders)
+                return false;
+
+            packetPool.release(old);
+            slot(seq) = p;
+            stats[PHONE_CLASS_LATEST].coalesced++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+PhonePacketClass PhonePacketRing::classify(const MeshPacket *p)
+{
+    if (p->which_payloadVariant != MeshPacket_decoded_tag)
+        return PHONE_CLASS_OTHER;
+
+    switch (p->decoded.portnum) {
+    case PortNum_POSITION_APP:
+    case PortNum_NODEINFO_APP:
+    case PortNum_ENVIRONMENTAL_MEASUREMENT_APP:
+        return PHONE_CLASS_LATEST;
+
+    case PortNum_TEXT_MESSAGE_APP:
+    case PortNum_ADMIN_APP:
+        return PHONE_CLASS_RETAINED;
+
+    default:
+        return PHONE_CLASS_OTHER;
+    }
+}
+
+const char *PhonePacketRing::className(PhonePacketClass c)
+{
+    switch (c) {
+    case PHONE_CLASS_LATEST:
+        return "latest";
+    case PHONE_CLASS_RETAINED:
+        return "retained";
+    default:
+        return "other";
+    }
+}
+
+int PhonePacketRing::find(const Reader *r) const
+{
+    for (size_t i = 0; i < numReaders; i++)
+        if (readers[i] == r)
+            return i;
+
+    return -1;
+}
+
+void PhonePacketRing::releaseConsumed()
+{
+    // If no one is attached, keep our packets for whoever connects next
+    while (numReaders && tail != head && refsFor(tail) == 0) {
+        packetPool.release(slot(tail));
+        tail++;
+    }
+}
+
+MeshPacket *PhonePacketRing::popOldest(bool isSaved)
+{
+    assert(count());
+
+    if (!isSaved && refsFor(tail))
+        stats[classify(slot(tail))].dropped++;
+
+    for (size_t i = 0; i < numReaders; i++)
+        if (readers[i]->next == tail) {
+            readers[i]->next++;
+            if (!isSaved)
+                readers[i]->dropped++;
+        }
+
+    return slot(tail++);
+}
+
+void PhonePacketRing::dropOldest()
+{
+    stats[classify(slot(tail))].dropped++;
+
+    for (size_t i = 0; i < numReaders; i++)
+        if (readers[i]->next == tail) {
+            readers[i]->next++;
+            readers[i]->dropped++;
+        }
+
+    packetPool.release(slot(tail));
+    tail++;
+}
+
+bool PhonePacketRing::dropOldestExpendable()
+{
+    for (uint32_t seq = tail; seq != head; seq++)
+        if (refsFor(seq) == numReaders && classify(slot(seq)) != PHONE_CLASS_RETAINED) {
+            DEBUG_MSG("NOTE: tophone ring is full, discarding oldest %s packet\n", className(classify(slot(seq))));
+            stats[classify(slot(seq))].dropped++;
+            packetPool.release(slot(seq));
+
+            // Every attached reader was still waiting for it
+            for (size_t i = 0; i < numReaders; i++)
+                readers[i]->dropped++;
+
+            // No reader has gotten this far yet, so we can close the gap without moving any cursors
+            for (; seq + 1 != head; seq++) {
+                slot(seq) = slot(seq + 1);
+                refsFor(seq) = refsFor(seq + 1);
+            }
+            head--;
+            return true;
+        }
+
+    return false;
+}
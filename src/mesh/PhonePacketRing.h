@@ -0,0 +1,135 @@
+#pragma once
+
+#include "mesh-pb-constants.h"
+
+/// The max number of PhoneAPI instances which can read from the ring at once (BLE, serial, TCP, HTTP...)
+#ifndef MAX_PHONE_READERS
+#ifdef PORTDUINO
+#define MAX_PHONE_READERS 40 // Linux allows many TCP clients (see MAX_API_CLIENTS)
+#else
+#define MAX_PHONE_READERS 8
+#endif
+#endif
+
+/// How PhonePacketRing treats each kind of packet (see PhonePacketRing::classify)
+enum PhonePacketClass {
+    PHONE_CLASS_LATEST,   // positions, nodeinfos and telemetry: the phone only needs the newest one from each node
+    PHONE_CLASS_RETAINED, // text messages and admin responses: only discarded if we have nothing else to discard
+    PHONE_CLASS_OTHER,    // everything else (including packets we couldn't decode)
+    PHONE_CLASS_COUNT
+};
+
+/**
+ * A fixed size ring of packets received from the mesh, which are waiting to be delivered to phone clients.
+ *
+ * Unlike a simple queue (where the first reader takes each packet), every attached reader has its own cursor and sees every
+ * packet.  Each slot keeps a count of the readers which still need it, a packet is returned to packetPool as soon as all
+ * readers have consumed it.  If no readers are attached packets are retained, so a phone which connects later can still
+ * download them.
+ *
+ * When the ring is full the oldest packet is discarded, any reader which had not yet read it has its dropped count
+ * incremented.  If the oldest packet is a PHONE_CLASS_RETAINED one we instead discard the oldest other packet no reader has
+ * read yet (if there is one).  Callers can also coalesce() PHONE_CLASS_LATEST packets, so a chatty node's positions don't
+ * crowd everything else out of the ring.
+ *
+ * Note: not ISR safe, only call from the main thread.
+ */
+class PhonePacketRing
+{
+  public:
+    /// The per client state, normally embedded in a PhoneAPI
+    struct Reader {
+        uint32_t next = 0;    // the sequence number of the next packet this reader will read
+        uint32_t dropped = 0; // how many packets fell out of the ring before this reader could read them
+    };
+
+    /// Counters for each PhonePacketClass
+    struct ClassStats {
+        uint32_t queued = 0;    // added with push()
+        uint32_t coalesced = 0; // replaced an older packet from the same node by coalesce()
+        uint32_t dropped = 0;   // discarded because the ring was full
+    };
+
+    ClassStats stats[PHONE_CLASS_COUNT];
+
+  private:
+    MeshPacket *packets[MAX_RX_TOPHONE];
+
+    /// for each slot in packets, how many attached readers still need to read it
+    uint8_t refs[MAX_RX_TOPHONE];
+
+    /// Sequence numbers of the oldest packet we hold and of the next packet which will be added
+    uint32_t tail = 0, head = 0;
+
+    Reader *readers[MAX_PHONE_READERS];
+    size_t numReaders = 0;
+
+  public:
+    /// Add a packet to the ring, we take ownership of p (which must have been allocated from packetPool)
+    void push(MeshPacket *p);
+
+    /** If p is a PHONE_CLASS_LATEST packet and no reader has read the last one like it (same sender, destination and portnum),
+     * replace that packet with p (in place).
+     * @return true if we did, in which case we take ownership of p (otherwise the caller should push() it)
+     */
+    bool coalesce(MeshPacket *p);
+
+    /// @return which PhonePacketClass p belongs to
+    static PhonePacketClass classify(const MeshPacket *p);
+
+    /// @return a short name for class c, for logs and reports
+    static const char *className(PhonePacketClass c);
+
+    /** Start tracking a reader, it will first see the oldest packet we still have.  Attaching an attached reader is a no-op.
+     * @return false if we already have too many readers
+     */
+    bool attach(Reader *r);
+
+    /// Stop tracking a reader (releasing any packets that only it was waiting for)
+    void detach(Reader *r);
+
+    /// @return the next packet for this reader (or NULL if it is caught up).  The packet is only valid until the next call
+    /// to push() or consume().
+    const MeshPacket *peek(const Reader *r) const;
+
+    /// Mark the packet returned by peek() as read
+    void consume(Reader *r);
+
+    /// @return the number of packets in the ring
+    size_t count() const { return head - tail; }
+
+    /// @return true if the next push() will discard our oldest packet
+    bool isFull() const { return count() == MAX_RX_TOPHONE; }
+
+    /// @return true if we have a packet and no attached reader has read our oldest one yet
+    bool isOldestUnread() const { return count() && refs[tail % MAX_RX_TOPHONE] == numReaders; }
+
+    /// @return our oldest packet (we must have one)
+    const MeshPacket *oldest() const { return packets[tail % MAX_RX_TOPHONE]; }
+
+    /** Remove our oldest packet (so it can be saved elsewhere, see PhonePacketStore).
+     * @param isSaved true if the caller has saved it for every reader which had not read it yet, otherwise those readers are
+     * counted as having dropped it (just like when the ring overflows)
+     * @return the packet, which the caller now owns (it must eventually be released to packetPool)
+     */
+    MeshPacket *popOldest(bool isSaved);
+
+  private:
+    MeshPacket *&slot(uint32_t seq) { return packets[seq % MAX_RX_TOPHONE]; }
+
+    uint8_t &refsFor(uint32_t seq) { return refs[seq % MAX_RX_TOPHONE]; }
+
+    /// @return the index of r in readers, or -1 if not attached
+    int find(const Reader *r) const;
+
+    /// Free packets at the tail of the ring which no attached reader still needs
+    void releaseConsumed();
+
+    /// Free the oldest packet, even if some readers have not read it yet
+    void dropOldest();
+
+    /** Free the oldest packet which isn't PHONE_CLASS_RETAINED and which no reader has read yet
+     * @return false if there was no such packet
+     */
+    bool dropOldestExpendable();
+};
@@ -0,0 +1,359 @@
+#include "PhonePacketStore.h"
+#include "FSCommon.h"
+#include "configuration.h"
+#include <assert.h>
+
+/// The types of records in our log
+enum StoreRecordType {
+    STORE_PACKET = 1, // A priority byte and then an encoded MeshPacket
+    STORE_REMOVED     // The (little endian uint32) offset of a STORE_PACKET record which is no longer needed
+};
+
+#define STORE_HEADER_LEN 3
+
+/// The largest payload we will ever write
+#define STORE_MAX_PAYLOAD (1 + MeshPacket_size)
+
+/// Once the log grows past this size we compact it (it will then hold at most half this many bytes)
+#define PHONE_STORE_COMPACT_SIZE (2 * PHONE_STORE_MAX_PACKETS * (STORE_HEADER_LEN + STORE_MAX_PAYLOAD))
+
+/// When we run out of space we discard the oldest packet with the lowest priority first
+#define PRIORITY_LOW 0    // positions and nodeinfos, which are replaced by the next one a node sends
+#define PRIORITY_NORMAL 1 // everything else (including packets we can't decode)
+#define PRIORITY_TEXT 2   // text messages, which users really don't want to lose
+
+static const char *storefile = "/tophone.log";
+static const char *storetmp = "/tophone.log.tmp";
+
+static uint8_t priorityFor(const MeshPacket &p)
+{
+    if (p.which_payloadVariant != MeshPacket_decoded_tag)
+        return PRIORITY_NORMAL;
+
+    switch (p.decoded.portnum) {
+    case PortNum_TEXT_MESSAGE_APP:
+        return PRIORITY_TEXT;
+    case PortNum_POSITION_APP:
+    case PortNum_NODEINFO_APP:
+        return PRIORITY_LOW;
+    default:
+        return PRIORITY_NORMAL;
+    }
+}
+
+PhonePacketStore::PhonePacketStore() : concurrency::OSThread("PhoneStore", PHONE_STORE_FLUSH_MSECS)
+{
+    static_assert(STORE_HEADER_LEN + STORE_MAX_PAYLOAD <= PHONE_STORE_BUF_SIZE, "phone store buffer too small");
+    priority = concurrency::THREAD_PRIORITY_BACKGROUND;
+
+    load();
+}
+
+void PhonePacketStore::load()
+{
+#ifdef FS
+    auto f = FS.open(storefile);
+    if (!f)
+        return;
+
+    uint8_t header[STORE_HEADER_LEN];
+    uint8_t payload[STORE_MAX_PAYLOAD];
+    uint32_t offset = 0;
+    while (f.read(header, sizeof(header)) == sizeof(header)) {
+        size_t len = header[1] | (header[2] << 8);
+        if (len > sizeof(payload) || f.read(payload, len) != (int)len) {
+            DEBUG_MSG("Warning: ignoring torn phone store record\n");
+            break;
+        }
+
+        if (header[0] == STORE_PACKET && len > 1) {
+            if (numStored == PHONE_STORE_MAX_PACKETS) // Only possible if PHONE_STORE_MAX_PACKETS shrank, keep the newest
+                memmove(index, index + 1, --numStored * sizeof(index[0]));
+            index[numStored++] = {offset, nextSeq++, (uint16_t)(len - 1), payload[0]};
+        } else if (header[0] == STORE_REMOVED && len == sizeof(uint32_t)) {
+            uint32_t removed = payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+            for (size_t i = 0; i < numStored; i++)
+                if (index[i].offset == removed) {
+                    memmove(index + i, index + i + 1, (numStored - i - 1) * sizeof(index[0]));
+                    numStored--;
+                    break;
+                }
+        }
+
+        offset += STORE_HEADER_LEN + len;
+    }
+
+    bool isTorn = offset != f.size();
+    f.close();
+
+    fileSize = offset;
+    DEBUG_MSG("Loaded %u undelivered phone packets from flash\n", numStored);
+
+    if (isTorn)
+        compact(); // Get rid of the partial record, so we can append to the log again
+#endif
+}
+
+uint32_t PhonePacketStore::append(uint8_t type, const uint8_t *payload, size_t len)
+{
+    assert(len <= STORE_MAX_PAYLOAD);
+
+    if (numPending + STORE_HEADER_LEN + len > PHONE_STORE_BUF_SIZE)
+        flush();
+    if (!numPending)
+        setIntervalFromNow(PHONE_STORE_FLUSH_MSECS); // Don't leave this record in RAM for long
+
+    uint8_t *p = pending + numPending;
+    p[0] = type;
+    p[1] = len & 0xff;
+    p[2] = (len >> 8) & 0xff;
+    memcpy(p + STORE_HEADER_LEN, payload, len);
+
+    uint32_t offset = fileSize + numPending;
+    numPending += STORE_HEADER_LEN + len;
+    if (numPending >= PHONE_STORE_FLUSH_BYTES)
+        setIntervalFromNow(0);
+    return offset;
+}
+
+bool PhonePacketStore::save(const MeshPacket &p)
+{
+    uint8_t record[STORE_MAX_PAYLOAD];
+    record[0] = priorityFor(p);
+    size_t len = pb_encode_to_bytes(record + 1, MeshPacket_size, MeshPacket_fields, &p);
+
+    if (numStored == PHONE_STORE_MAX_PACKETS) {
+        size_t victim = 0;
+        for (size_t i = 1; i < numStored; i++)
+            if (index[i].priority < index[victim].priority)
+                victim = i;
+
+        numEvicted++;
+        if (index[victim].priority > record[0]) {
+            DEBUG_MSG("Phone store is full of more important packets, discarding 0x%x\n", p.id);
+            return false;
+        }
+
+        DEBUG_MSG("Phone store is full, discarding oldest packet with priority %d\n", index[victim].priority);
+        for (size_t i = 0; i < numReaders; i++)
+            if (readers[i]->next <= index[victim].seq)
+                readers[i]->dropped++;
+        remove(victim);
+    }
+
+    uint32_t offset = append(STORE_PACKET, record, 1 + len);
+    index[numStored++] = {offset, nextSeq++, (uint16_t)len, record[0]};
+    return true;
+}
+
+bool PhonePacketStore::attach(Reader *r)
+{
+    if (find(r) >= 0)
+        return true;
+
+    if (numReaders == MAX_PHONE_READERS) {
+        DEBUG_MSG("Warning: too many phone clients, this one will not receive stored packets\n");
+        return false;
+    }
+    readers[numReaders++] = r;
+
+    r->next = 0; // The new reader needs everything we currently hold
+    return true;
+}
+
+void PhonePacketStore::detach(Reader *r)
+{
+    int x = find(r);
+    if (x < 0)
+        return;
+
+    readers[x] = readers[--numReaders];
+    releaseConsumed();
+}
+
+bool PhonePacketStore::peek(const Reader *r, MeshPacket &p)
+{
+    uint8_t buf[MeshPacket_size];
+    size_t i;
+    while ((i = nextFor(r)) < numStored) {
+        if (readPacket(index[i], buf) && pb_decode_from_bytes(buf, index[i].len, MeshPacket_fields, &p))
+            return true;
+
+        DEBUG_MSG("Error: discarding unreadable stored packet\n");
+        remove(i);
+    }
+
+    return false;
+}
+
+void PhonePacketStore::consume(Reader *r)
+{
+    size_t i = nextFor(r);
+    assert(i < numStored);
+    r->next = index[i].seq + 1;
+
+    releaseConsumed();
+}
+
+size_t PhonePacketStore::nextFor(const Reader *r) const
+{
+    size_t i = 0;
+    while (i < numStored && index[i].seq < r->next)
+        i++;
+    return i;
+}
+
+int PhonePacketStore::find(const Reader *r) const
+{
+    for (size_t i = 0; i < numReaders; i++)
+        if (readers[i] == r)
+            return i;
+
+    return -1;
+}
+
+void PhonePacketStore::releaseConsumed()
+{
+    // If no one is attached, keep our packets for whoever connects next
+    while (numReaders && numStored) {
+        for (size_t i = 0; i < numReaders; i++)
+            if (readers[i]->next <= index[0].seq)
+                return; // Someone still needs our oldest packet
+        remove(0);
+    }
+}
+
+void PhonePacketStore::remove(size_t i)
+{
+    uint32_t offset = index[i].offset;
+    uint8_t payload[sizeof(uint32_t)] = {(uint8_t)offset, (uint8_t)(offset >> 8), (uint8_t)(offset >> 16),
+                                         (uint8_t)(offset >> 24)};
+    append(STORE_REMOVED, payload, sizeof(payload));
+
+    memmove(index + i, index + i + 1, (numStored - i - 1) * sizeof(index[0]));
+    numStored--;
+}
+
+bool PhonePacketStore::readPacket(const StoredPacket &e, uint8_t *buf)
+{
+    if (e.len > MeshPacket_size)
+        return false;
+
+    if (e.offset >= fileSize) { // Still in our RAM buffer
+        memcpy(buf, pending + (e.offset - fileSize) + STORE_HEADER_LEN + 1, e.len);
+        return true;
+    }
+
+#ifdef FS
+    auto f = FS.open(storefile);
+    if (!f)
+        return false;
+
+    bool ok = f.seek(e.offset + STORE_HEADER_LEN + 1) && f.read(buf, e.len) == (int)e.len;
+    f.close();
+    return ok;
+#else
+    return false;
+#endif
+}
+
+void PhonePacketStore::flush()
+{
+    if (!numPending)
+        return;
+
+#ifdef FS
+    auto f = FS.open(storefile, FILE_O_APPEND);
+    if (f) {
+        bool ok = f.write(pending, numPending) == numPending;
+        f.close();
+
+        if (ok) {
+            fileSize += numPending;
+            storeBytesWritten += numPending;
+            storeWrites++;
+            numPending = 0;
+            DEBUG_MSG("Phone store: appended to log (%u bytes in %u writes since boot)\n", storeBytesWritten, storeWrites);
+            return;
+        }
+    }
+    DEBUG_MSG("Error: can't append to phone store\n");
+#endif
+
+    // Our buffered records are lost, so forget any packets which were in them
+    numPending = 0;
+    size_t numKept = 0;
+    for (size_t i = 0; i < numStored; i++)
+        if (index[i].offset < fileSize)
+            index[numKept++] = index[i];
+    numStored = numKept;
+}
+
+void PhonePacketStore::compact()
+{
+#ifdef FS
+    flush();
+
+    if (!numStored) { // The common case, everything was delivered
+        FS.remove(storefile);
+        fileSize = 0;
+        return;
+    }
+
+    uint32_t start = millis();
+    auto f = FS.open(storetmp, FILE_O_WRITE);
+    if (!f) {
+        DEBUG_MSG("Error: can't compact phone store\n");
+        return;
+    }
+
+    // Don't touch our index until the new log is safely written
+    uint32_t newOffsets[PHONE_STORE_MAX_PACKETS];
+    uint8_t record[STORE_HEADER_LEN + STORE_MAX_PAYLOAD];
+    uint32_t newSize = 0;
+    for (size_t i = 0; i < numStored; i++) {
+        const StoredPacket &e = index[i];
+        size_t len = 1 + e.len;
+        record[0] = STORE_PACKET;
+        record[1] = len & 0xff;
+        record[2] = (len >> 8) & 0xff;
+        record[STORE_HEADER_LEN] = e.priority;
+        if (!readPacket(e, record + STORE_HEADER_LEN + 1) || f.write(record, STORE_HEADER_LEN + len) != STORE_HEADER_LEN + len) {
+            DEBUG_MSG("Error: can't copy stored packet, not compacting\n");
+            f.close();
+            FS.remove(storetmp);
+            return;
+        }
+
+        newOffsets[i] = newSize;
+        newSize += STORE_HEADER_LEN + len;
+    }
+    f.close();
+
+    // brief window of risk here ;-)
+    FS.remove(storefile);
+    if (!FS.rename(storetmp, storefile)) {
+        DEBUG_MSG("Error: can't rename new phone store\n");
+        numStored = 0; // Our old log is gone, so are the packets in it
+        fileSize = 0;
+        return;
+    }
+
+    for (size_t i = 0; i < numStored; i++)
+        index[i].offset = newOffsets[i];
+    fileSize = newSize;
+    storeBytesWritten += newSize;
+    storeWrites++;
+    DEBUG_MSG("Compacted phone store to %u packets, %u bytes in %u ms\n", numStored, newSize, millis() - start);
+#endif
+}
+
+int32_t PhonePacketStore::runOnce()
+{
+    flush();
+
+    if (fileSize > PHONE_STORE_COMPACT_SIZE || (fileSize && !numStored))
+        compact();
+
+    return INT32_MAX; // append() wakes us when there is something new to write
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "PhonePacketRing.h"
+#include "concurrency/OSThread.h"
+#include "mesh-pb-constants.h"
+
+/// The max number of undelivered packets we keep on flash (each costs up to about 300 bytes of flash and 8 bytes of RAM)
+#ifndef PHONE_STORE_MAX_PACKETS
+#ifdef NRF52_SERIES
+#define PHONE_STORE_MAX_PACKETS 16 // The nrf52 filesystem is only 28KB
+#else
+#define PHONE_STORE_MAX_PACKETS 64
+#endif
+#endif
+
+/// How many bytes of records we can buffer in RAM
+#define PHONE_STORE_BUF_SIZE 1024
+
+/// Once this many bytes of records are buffered we write them to flash (without waiting for PHONE_STORE_FLUSH_MSECS)
+#define PHONE_STORE_FLUSH_BYTES 512
+
+/// The longest we let records sit in our RAM buffer before writing them to flash
+#define PHONE_STORE_FLUSH_MSECS (5 * 1000)
+
+/**
+ * A flash backed store for packets from the mesh which no phone has downloaded yet.
+ *
+ * MeshService::toPhoneQueue only holds MAX_RX_TOPHONE packets in RAM.  When it overflows (because no phone has been in range
+ * for a while) or when we go into deep sleep, the packets no client has read are moved here.  PhoneAPI delivers our packets
+ * (which are always older than those in toPhoneQueue) before anything in toPhoneQueue.  Like PhonePacketRing, each attached
+ * reader has its own cursor and sees every packet, a packet is removed once all attached readers have consumed it (and kept
+ * if no readers are attached).
+ *
+ * On flash we keep a log file of records, each is a one byte StoreRecordType, a two byte (little endian) length and then the
+ * payload.  A STORE_PACKET payload is a priority byte and then the protobuf encoded MeshPacket, a STORE_REMOVED payload is the
+ * (little endian) file offset of a STORE_PACKET record which was delivered or evicted.  In RAM we only keep an index of the
+ * live packet records.  Like NodeDBJournal, records are batched in RAM and written by our thread, at most PHONE_STORE_FLUSH_MSECS
+ * after the first of them (or sooner, once PHONE_STORE_FLUSH_BYTES are waiting).  append() writes the buffer itself if it is
+ * too full for another record.  Once the log grows large we compact it by copying just the live records to a new file.
+ *
+ * When the store is full we evict the oldest packet of the lowest priority, so text messages survive in preference to
+ * positions (which are superseded by the next one anyway).
+ */
+class PhonePacketStore : private concurrency::OSThread
+{
+  public:
+    /// The per client state, normally embedded in a PhoneAPI.  Our cursors work like PhonePacketRing's: next is the seq of the
+    /// next packet the reader will read, dropped counts the packets we evicted before it read them.
+    typedef PhonePacketRing::Reader Reader;
+
+  private:
+    /// Index entry for a live packet record, in the order they were stored
+    struct StoredPacket {
+        uint32_t offset; // where the record starts in the log (including records still in pending)
+        uint32_t seq;    // increases with each packet we store (not saved, we renumber our packets at boot)
+        uint16_t len;    // length of the encoded MeshPacket
+        uint8_t priority;
+    };
+
+    StoredPacket index[PHONE_STORE_MAX_PACKETS];
+    size_t numStored = 0;
+
+    /// The seq we will give the next packet we store
+    uint32_t nextSeq = 1;
+
+    Reader *readers[MAX_PHONE_READERS];
+    size_t numReaders = 0;
+
+    /// Records which have not yet been written to flash, they start at fileSize
+    uint8_t pending[PHONE_STORE_BUF_SIZE];
+    size_t numPending = 0;
+
+    /// The size of the log file on flash
+    size_t fileSize = 0;
+
+  public:
+    /// Stats, for measuring how hard we are on our flash
+    uint32_t storeBytesWritten = 0, storeWrites = 0, numEvicted = 0;
+
+    /// Load our index from the log on flash
+    PhonePacketStore();
+
+    /** Save a copy of p
+     * @return false if we are full of packets which are more important than p (so p was not saved)
+     */
+    bool save(const MeshPacket &p);
+
+    /** Start tracking a reader, it will first see the oldest packet we have.  Attaching an attached reader is a no-op.
+     * @return false if we already have too many readers
+     */
+    bool attach(Reader *r);
+
+    /// Stop tracking a reader (removing any packets that only it was waiting for)
+    void detach(Reader *r);
+
+    /** Decode the next packet for this reader into p
+     * @return false if it has read all of our packets
+     */
+    bool peek(const Reader *r, MeshPacket &p);
+
+    /// Mark the packet returned by peek() as read
+    void consume(Reader *r);
+
+    /// @return true if we have a packet this reader hasn't read
+    bool hasUnread(const Reader *r) const { return numStored && index[numStored - 1].seq >= r->next; }
+
+    /// @return the number of packets we hold
+    size_t count() const { return numStored; }
+
+    /// Write any buffered records to flash now
+    void flush();
+
+  protected:
+    virtual int32_t runOnce();
+
+  private:
+    /// Read our log from flash and rebuild our index
+    void load();
+
+    /// Queue a record for appending to the log, @return its offset in the log
+    uint32_t append(uint8_t type, const uint8_t *payload, size_t len);
+
+    /// Remove index[i], appending a STORE_REMOVED record so it stays removed after a reboot
+    void remove(size_t i);
+
+    /// @return the index of r in readers, or -1 if not attached
+    int find(const Reader *r) const;
+
+    /// @return the position in index of the next packet for r (numStored if there isn't one)
+    size_t nextFor(const Reader *r) const;
+
+    /// Remove packets which every attached reader has read
+    void releaseConsumed();
+
+    /** Read the encoded MeshPacket for index entry e into buf (which must be at least MeshPacket_size bytes)
+     * @return false if it could not be read
+     */
+    bool readPacket(const StoredPacket &e, uint8_t *buf);
+
+    /// Rewrite the log with only our live packet records
+    void compact();
+};
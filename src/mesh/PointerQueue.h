@@ -3,7 +3,7 @@
 #include "TypedQueue.h"
 
 /**
- * A wrapper for freertos queues that assumes each element is a pointer
+ * A TypedQueue where each element is a pointer
  */
 template <class T> class PointerQueue : public TypedQueue<T *>
 {
@@ -11,14 +11,13 @@ template <class T> class PointerQueue : public TypedQueue<T *>
     PointerQueue(int maxElements) : TypedQueue<T *>(maxElements) {}
 
     // returns a ptr or null if the queue was empty
-    T *dequeuePtr(TickType_t maxWait = portMAX_DELAY)
+    T *dequeuePtr()
     {
         T *p;
 
-        return this->dequeue(&p, maxWait) ? p : nullptr;
+        return this->dequeue(&p) ? p : nullptr;
     }
 
-#ifdef HAS_FREE_RTOS
     // returns a ptr or null if the queue was empty
     T *dequeuePtrFromISR(BaseType_t *higherPriWoken)
     {
@@ -26,5 +25,4 @@ template <class T> class PointerQueue : public TypedQueue<T *>
 
         return this->dequeueFromISR(&p, higherPriWoken) ? p : nullptr;
     }
-#endif
 };
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/// getPortNum() returns this if a plugin might want packets for any portnum
+#define PORTNUM_ANY -1
+
+/**
+ * Which plugins to consider for each portnum, so we don't need to ask every plugin about every packet.  Each list is in the
+ * order the plugins were registered (which is the order we have always called them in).
+ */
+template <class Plugin> struct PortDispatchTable {
+    typedef std::pair<int, std::vector<Plugin *>> Entry;
+
+    /// For each portnum some plugin asked for (sorted by portnum), the plugins which might want it
+    std::vector<Entry> byPort;
+
+    /// For any other portnum, the plugins which might want it (those whose portnum is PORTNUM_ANY)
+    std::vector<Plugin *> anyPort;
+
+    /**
+     * Rebuild the table from plugins, where portNumOf(plugin) is the only portnum a plugin wants (or PORTNUM_ANY), and plugins
+     * for which include(plugin) is false are left out.
+     */
+    template <class PortNumOf, class Include>
+    void build(const std::vector<Plugin *> &plugins, PortNumOf portNumOf, Include include)
+    {
+        byPort.clear();
+        anyPort.clear();
+
+        // Every portnum some plugin asked for gets its own list
+        for (auto pi : plugins) {
+            int portNum = portNumOf(pi);
+            if (!include(pi) || portNum == PORTNUM_ANY)
+                continue;
+
+            auto entry = find(portNum);
+            if (entry == byPort.end() || entry->first != portNum)
+                byPort.insert(entry, Entry(portNum, std::vector<Plugin *>()));
+        }
+
+        // Then add each plugin (in registration order) to all the lists it belongs on
+        for (auto pi : plugins) {
+            if (!include(pi))
+                continue;
+
+            int portNum = portNumOf(pi);
+            for (auto &entry : byPort)
+                if (portNum == PORTNUM_ANY || entry.first == portNum)
+                    entry.second.push_back(pi);
+            if (portNum == PORTNUM_ANY)
+                anyPort.push_back(pi);
+        }
+    }
+
+    /// @return the plugins which might want a packet with this portnum
+    const std::vector<Plugin *> &lookup(int portNum) const
+    {
+        auto entry = find(portNum);
+        return (entry != byPort.end() && entry->first == portNum) ? entry->second : anyPort;
+    }
+
+  private:
+    /// @return the first entry in byPort whose portnum is not less than portNum
+    typename std::vector<Entry>::iterator find(int portNum)
+    {
+        return std::lower_bound(byPort.begin(), byPort.end(), portNum, [](const Entry &e, int p) { return e.first < p; });
+    }
+
+    typename std::vector<Entry>::const_iterator find(int portNum) const
+    {
+        return std::lower_bound(byPort.begin(), byPort.end(), portNum, [](const Entry &e, int p) { return e.first < p; });
+    }
+};
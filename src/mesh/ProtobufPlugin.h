@@ -60,15 +60,10 @@ template <class T> class ProtobufPlugin : protected SinglePortPlugin
         auto &p = mp.decoded;
         DEBUG_MSG("Received %s from=0x%0x, id=0x%x, portnum=%d, payloadlen=%d\n", name, mp.from, mp.id, p.portnum, p.payload.size);
 
-        T scratch;
-        T *decoded = NULL; 
-        if(mp.decoded.portnum == ourPortNum) {
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(p.payload.bytes, p.payload.size, fields, &scratch))
-                decoded = &scratch;
-            else
-                DEBUG_MSG("Error decoding protobuf plugin!\n");
-        }
+        // Shared with any other consumers of this payload (so it is only decoded once per packet)
+        const T *decoded = NULL;
+        if (mp.decoded.portnum == ourPortNum)
+            decoded = (const T *)getDecodedPayload(mp, fields, sizeof(T));
 
         return handleReceivedProtobuf(mp, decoded);
     }
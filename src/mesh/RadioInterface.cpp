@@ -12,6 +12,9 @@
 #include <pb_decode.h>
 #include <pb_encode.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_RADIO
+
 #define RDEF(name, freq, spacing, num_ch, power_limit)                                                                           \
     {                                                                                                                            \
         RegionCode_##name, num_ch, power_limit, freq, spacing, #name                                                             \
@@ -349,7 +352,11 @@ ErrorCode SimRadio::send(MeshPacket *p)
 void RadioInterface::deliverToReceiver(MeshPacket *p)
 {
     assert(rxDest);
-    assert(rxDest->enqueue(p, 0)); // NOWAIT - fixme, if queue is full, delete older messages
+    if (!rxDest->enqueue(p)) { // The router hasn't kept up, it will see the next one
+        ERROR_MSG("Error: fromRadioQueue full, dropping received packet\n");
+        packetPool.release(p);
+        return;
+    }
 
     // Nasty hack because our threading is primitive.  interfaces shouldn't need to know about routers FIXME
     if (router)
@@ -113,6 +113,9 @@ class RadioInterface
      */
     virtual ErrorCode send(MeshPacket *p) = 0;
 
+    /// @return how many more packets send() would currently accept
+    virtual size_t getTxQueueFree() { return MAX_TX_QUEUE; }
+
     /** Attempt to cancel a previously sent packet.  Returns true if a packet was found we could cancel */
     virtual bool cancelSending(NodeNum from, PacketId id) { return false; }
 
@@ -1,5 +1,6 @@
 #include "RadioLibInterface.h"
 #include "MeshTypes.h"
+#include "Metrics.h"
 #include "NodeDB.h"
 #include "SPILock.h"
 #include "error.h"
@@ -8,9 +9,16 @@
 #include <pb_decode.h>
 #include <pb_encode.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_RADIO
+
 // FIXME, we default to 4MHz SPI, SPI mode 0, check if the datasheet says it can really do that
 static SPISettings spiSettings(4000000, MSBFIRST, SPI_MODE0);
 
+static Counter txGood("radio_tx_packets_total", "Packets we finished transmitting");
+static Counter rxGood("radio_rx_packets_total", "Packets we received intact");
+static Counter rxBad("radio_rx_bad_packets_total", "Packets we received which failed to read or were too short");
+
 void LockingModule::SPItransfer(uint8_t cmd, uint8_t reg, uint8_t *dataOut, uint8_t *dataIn, uint8_t numBytes)
 {
     concurrency::LockGuard g(spiLock);
@@ -23,6 +31,7 @@ RadioLibInterface::RadioLibInterface(RADIOLIB_PIN_TYPE cs, RADIOLIB_PIN_TYPE irq
     : NotifiedWorkerThread("RadioIf"), module(cs, irq, rst, busy, spi, spiSettings), iface(_iface)
 {
     instance = this;
+    priority = concurrency::THREAD_PRIORITY_RADIO;
 }
 
 #ifndef NO_ESP32
@@ -103,7 +112,7 @@ ErrorCode RadioLibInterface::send(MeshPacket *p)
     printPacket("enqueuing for send", p);
     uint32_t xmitMsec = getPacketTime(p);
 
-    DEBUG_MSG("txGood=%d,rxGood=%d,rxBad=%d\n", txGood, rxGood, rxBad);
+    DEBUG_MSG("txGood=%u,rxGood=%u,rxBad=%u\n", txGood.get(), rxGood.get(), rxBad.get());
     ErrorCode res = txQueue.enqueue(p) ? ERRNO_OK : ERRNO_UNKNOWN;
 
     if (res != ERRNO_OK) { // we weren't able to queue it, so we must drop it to prevent leaks
@@ -225,7 +234,7 @@ void RadioLibInterface::completeSending()
     sendingPacket = NULL;
 
     if (p) {
-        txGood++;
+        txGood.inc();
         printPacket("Completed sending", p);
 
         // We are done sending that packet, release it
@@ -248,7 +257,7 @@ void RadioLibInterface::handleReceiveInterrupt()
     int state = iface->readData(radiobuf, length);
     if (state != ERR_NONE) {
         DEBUG_MSG("ignoring received packet due to error=%d\n", state);
-        rxBad++;
+        rxBad.inc();
 
         airTime->logAirtime(RX_ALL_LOG, xmitMsec);
 
@@ -260,12 +269,12 @@ void RadioLibInterface::handleReceiveInterrupt()
         // check for short packets
         if (payloadLen < 0) {
             DEBUG_MSG("ignoring received packet too short\n");
-            rxBad++;
+            rxBad.inc();
             airTime->logAirtime(RX_ALL_LOG, xmitMsec);
         } else {
             const PacketHeader *h = (PacketHeader *)radiobuf;
 
-            rxGood++;
+            rxGood.inc();
 
             // Note: we deliver _all_ packets to our router (i.e. our interface is intentionally promiscuous).
             // This allows the router and other apps on our node to sniff packets (usually routing) between other
@@ -0,0 +1,60 @@
+#include "RecordBatch.h"
+#include <string.h>
+
+size_t RecordBatchWriter::varintLen(size_t n)
+{
+    size_t numBytes = 1;
+    while (n >= 0x80) {
+        n >>= 7;
+        numBytes++;
+    }
+    return numBytes;
+}
+
+bool RecordBatchWriter::add(const uint8_t *record, size_t recordLen)
+{
+    if (!fits(recordLen))
+        return false;
+
+    size_t n = recordLen;
+    while (n >= 0x80) {
+        buf[len++] = (n & 0x7f) | 0x80;
+        n >>= 7;
+    }
+    buf[len++] = n;
+
+    memcpy(buf + len, record, recordLen);
+    len += recordLen;
+    numRecords++;
+    return true;
+}
+
+bool RecordBatchReader::next(const uint8_t **record, size_t *recordLen)
+{
+    if (pos >= len || malformed)
+        return false;
+
+    // Decode the length (we never need more than 32 bits)
+    uint32_t n = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        if (pos >= len || shift > 28) {
+            malformed = true;
+            return false;
+        }
+
+        uint8_t b = buf[pos++];
+        n |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+
+    if (n > len - pos) {
+        malformed = true;
+        return false;
+    }
+
+    *record = buf + pos;
+    *recordLen = n;
+    pos += n;
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Packs several records (i.e. encoded protobufs) into one buffer, each preceded by its length as a varint.  This is the same
+ * "length delimited" format the protobuf libraries use for a stream of messages (writeDelimitedTo() in java, parseDelimited()
+ * in python, pb_decode_delimited() in nanopb), so clients don't need any special code to unpack our batches.
+ *
+ * This class (and RecordBatchReader) has no dependencies on the rest of the firmware, so it can be built and tested on a host.
+ */
+class RecordBatchWriter
+{
+    uint8_t *buf;
+    size_t maxLen;
+    size_t len = 0, numRecords = 0;
+
+  public:
+    RecordBatchWriter(uint8_t *_buf, size_t _maxLen) : buf(_buf), maxLen(_maxLen) {}
+
+    /// @return true if a record of recordLen bytes would still fit
+    bool fits(size_t recordLen) const { return len + varintLen(recordLen) + recordLen <= maxLen; }
+
+    /** Append a record to the batch
+     * @return false (and leave the batch unchanged) if it won't fit
+     */
+    bool add(const uint8_t *record, size_t recordLen);
+
+    /// @return the number of bytes used so far
+    size_t length() const { return len; }
+
+    /// @return the number of records added so far
+    size_t count() const { return numRecords; }
+
+    /// @return how many bytes it takes to encode n as a varint
+    static size_t varintLen(size_t n);
+};
+
+/**
+ * Unpacks a batch made by RecordBatchWriter (or any other writer of length delimited protobufs)
+ */
+class RecordBatchReader
+{
+    const uint8_t *buf;
+    size_t len, pos = 0;
+    bool malformed = false;
+
+  public:
+    RecordBatchReader(const uint8_t *_buf, size_t _len) : buf(_buf), len(_len) {}
+
+    /** Find the next record in the batch
+     * @return false if there are no more records (or the rest of the batch is malformed, see isMalformed())
+     */
+    bool next(const uint8_t **record, size_t *recordLen);
+
+    /// @return true if we stopped early because a length was bad
+    bool isMalformed() const { return malformed; }
+};
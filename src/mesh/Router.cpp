@@ -7,6 +7,9 @@
 #include "mesh-pb-constants.h"
 #include "plugins/RoutingPlugin.h"
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_ROUTER
+
 /**
  * Router todo
  *
@@ -45,6 +48,7 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
     DEBUG_MSG("Size of MeshPacket %d\n", sizeof(MeshPacket)); */
 
     fromRadioQueue.setReader(this);
+    priority = concurrency::THREAD_PRIORITY_RADIO; // So packets we receive don't wait behind screen redraws
 }
 
 /**
@@ -54,7 +58,7 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
 int32_t Router::runOnce()
 {
     MeshPacket *mp;
-    while ((mp = fromRadioQueue.dequeuePtr(0)) != NULL) {
+    while ((mp = fromRadioQueue.dequeuePtr()) != NULL) {
         perhapsHandleReceived(mp);
     }
 
@@ -110,7 +114,7 @@ void Router::sendAckNak(Routing_Error err, NodeNum to, PacketId idFrom)
 
 void Router::abortSendAndNak(Routing_Error err, MeshPacket *p)
 {
-    DEBUG_MSG("Error=%d, returning NAK and dropping packet.\n", err);
+    ERROR_MSG("Error=%d, returning NAK and dropping packet.\n", err);
     sendAckNak(Routing_Error_NO_INTERFACE, getFrom(p), p->id);
     packetPool.release(p);
 }
@@ -124,7 +128,11 @@ ErrorCode Router::sendLocal(MeshPacket *p)
     // No need to deliver externally if the destination is the local node
     if (p->to == nodeDB.getNodeNum()) {
         printPacket("Enqueuing local", p);
-        fromRadioQueue.enqueue(p);
+        if (!fromRadioQueue.enqueue(p)) {
+            ERROR_MSG("Error: fromRadioQueue full, dropping local packet\n");
+            packetPool.release(p);
+            return ERRNO_QUEUE_FULL;
+        }
         setReceivedMessage();
         return ERRNO_OK;
     } else if (!iface) {
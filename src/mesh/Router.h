@@ -54,6 +54,12 @@ class Router : protected concurrency::OSThread
     /** Attempt to cancel a previously sent packet.  Returns true if a packet was found we could cancel */
     bool cancelSending(NodeNum from, PacketId id);    
 
+    /// @return how many more packets our interface would currently accept for sending
+    size_t getTxQueueFree() { return iface ? iface->getTxQueueFree() : 0; }
+
+    /// @return the msecs it would take our interface to send a packet of this many bytes
+    uint32_t getPacketTime(uint32_t totalPacketLen) { return iface ? iface->getPacketTime(totalPacketLen) : 0; }
+
     /** Allocate and return a meshpacket which defaults as send to broadcast from the current node.
      * The returned packet is guaranteed to have a unique packet ID already assigned
      */
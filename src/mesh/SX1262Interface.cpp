@@ -2,6 +2,9 @@
 #include "error.h"
 #include <configuration.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_RADIO
+
 // Particular boards might define a different max power based on what their hardware can do
 #ifndef SX1262_MAX_POWER
 #define SX1262_MAX_POWER 22
@@ -23,6 +23,9 @@ class SinglePortPlugin : public MeshPlugin
      */
     virtual bool wantPacket(const MeshPacket *p) { return p->decoded.portnum == ourPortNum; }
 
+    /// We only want our own portnum
+    virtual int getPortNum() { return ourPortNum; }
+
     /**
      * Return a mesh packet which has been preinited as a data packet with a particular port number.
      * You can then send this packet (after customizing any of the payload fields you might need) with
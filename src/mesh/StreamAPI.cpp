@@ -1,9 +1,6 @@
 #include "StreamAPI.h"
 #include "configuration.h"
-
-#define START1 0x94
-#define START2 0xc3
-#define HEADER_LEN 4
+#include <assert.h>
 
 void StreamAPI::loop()
 {
@@ -17,76 +14,106 @@ void StreamAPI::loop()
  */
 void StreamAPI::readStream()
 {
-    while (stream->available()) { // Currently we never want to block
-        uint8_t c = stream->read();
-
-        // Use the read pointer for a little state machine, first look for framing, then length bytes, then payload
-        size_t ptr = rxPtr++; // assume we will probably advance the rxPtr
-
-        rxBuf[ptr] = c; // store all bytes (including framing)
-
-        if (ptr == 0) { // looking for START1
-            if (c != START1)
-                rxPtr = 0;     // failed to find framing
-        } else if (ptr == 1) { // looking for START2
-            if (c != START2)
-                rxPtr = 0;                             // failed to find framing
-        } else if (ptr >= HEADER_LEN) {                // we have at least read our 4 byte framing
-            uint32_t len = (rxBuf[2] << 8) + rxBuf[3]; // big endian 16 bit length follows framing
-
-            if (ptr == HEADER_LEN) {
-                // we _just_ finished our 4 byte header, validate length now (note: a length of zero is a valid
-                // protobuf also)
-                if (len > MAX_TO_FROM_RADIO_SIZE)
-                    rxPtr = 0; // length is bogus, restart search for framing
-            }
-
-            if (rxPtr != 0 && ptr + 1 == len + HEADER_LEN) {
-                // If we didn't just fail the packet and we now have the right # of bytes, parse it
-                handleToRadio(rxBuf + HEADER_LEN, len);
-                rxPtr = 0; // start over again
-            }
-        }
+    int avail;
+    while ((avail = stream->available()) > 0) { // Currently we never want to block
+        size_t toRead = sizeof(rxBuf) - rxPtr;
+        if ((size_t)avail < toRead)
+            toRead = avail;
+
+        size_t n = readAvailable(rxBuf + rxPtr, toRead);
+        if (!n)
+            break;
+
+        rxPtr += n;
+        handleRxBuf();
     }
 }
 
+/**
+ * Find and handle any complete frames in rxBuf, keeping any partial frame for next time
+ */
+void StreamAPI::handleRxBuf()
+{
+    size_t done = streamFindFrames(rxBuf, rxPtr, MAX_TO_FROM_RADIO_SIZE,
+                                   [this](const uint8_t *payload, size_t len) { handleToRadio(payload, len); });
+
+    // Keep any partial frame at the beginning of our buffer
+    rxPtr -= done;
+    memmove(rxBuf, rxBuf + done, rxPtr);
+}
+
 /**
  * call getFromRadio() and deliver encapsulated packets to the Stream
  */
 void StreamAPI::writeStream()
 {
     if (canWrite) {
-        uint32_t len;
-        do {
-            // Send every packet we can
-            len = getFromRadio(txBuf + HEADER_LEN);
-            emitTxBuffer(len);
-        } while (len);
+        // Encode every packet we can directly into our batch (as long as our transport can accept them)
+        while (true) {
+            if (sizeof(txBuf) - txLen < MAX_STREAM_BUF_SIZE)
+                flushTx(); // No room for another max size frame, send what we have
+
+            if (!canWriteFrame())
+                break;
+
+            size_t len = getFromRadio(txBuf + txLen + STREAM_HEADER_LEN);
+            if (!len)
+                break;
+
+            addTxFrame(len);
+        }
+
+        // Don't hold a partial batch for too long
+        if (txLen && millis() - txFirstMsec >= STREAM_BATCH_MSECS)
+            flushTx();
     }
 }
 
+int32_t StreamAPI::msecsUntilFlush() const
+{
+    if (!txLen)
+        return INT32_MAX;
+
+    uint32_t held = millis() - txFirstMsec;
+    return held >= STREAM_BATCH_MSECS ? 0 : STREAM_BATCH_MSECS - held;
+}
+
 /**
- * Send the current txBuffer over our stream
+ * Add a frame to our batch, the payload (of len bytes) must already be at txBuf + txLen + STREAM_HEADER_LEN
  */
-void StreamAPI::emitTxBuffer(size_t len)
+void StreamAPI::addTxFrame(size_t len)
 {
-    if (len != 0) {
-        txBuf[0] = START1;
-        txBuf[1] = START2;
-        txBuf[2] = (len >> 8) & 0xff;
-        txBuf[3] = len & 0xff;
+    assert(txLen + STREAM_HEADER_LEN + len <= sizeof(txBuf));
+
+    if (!txLen)
+        txFirstMsec = millis();
 
-        stream->write(txBuf, len + HEADER_LEN);
+    streamFrameHeader(txBuf + txLen, len);
+    txLen += STREAM_HEADER_LEN + len;
+}
+
+/**
+ * Send our batch of frames over our stream
+ */
+void StreamAPI::flushTx()
+{
+    if (txLen) {
+        stream->write(txBuf, txLen);
+        txLen = 0;
     }
 }
 
 void StreamAPI::emitRebooted()
 {
+    if (sizeof(txBuf) - txLen < MAX_STREAM_BUF_SIZE)
+        flushTx();
+
     // In case we send a FromRadio packet
     memset(&fromRadioScratch, 0, sizeof(fromRadioScratch));
     fromRadioScratch.which_payloadVariant = FromRadio_rebooted_tag;
     fromRadioScratch.rebooted = true;
 
     DEBUG_MSG("Emitting reboot packet for serial shell\n");
-    emitTxBuffer(pb_encode_to_bytes(txBuf + HEADER_LEN, FromRadio_size, FromRadio_fields, &fromRadioScratch));
-}
\ No newline at end of file
+    addTxFrame(pb_encode_to_bytes(txBuf + txLen + STREAM_HEADER_LEN, FromRadio_size, FromRadio_fields, &fromRadioScratch));
+    flushTx();
+}
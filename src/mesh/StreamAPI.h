@@ -2,10 +2,19 @@
 
 #include "PhoneAPI.h"
 #include "Stream.h"
+#include "StreamFraming.h"
 
 // A To/FromRadio packet + our 32 bit header
 #define MAX_STREAM_BUF_SIZE (MAX_TO_FROM_RADIO_SIZE + sizeof(uint32_t))
 
+/// We batch outgoing frames into a buffer this large, so they can be sent with one write to the stream
+#define STREAM_TX_BATCH_SIZE (2 * MAX_STREAM_BUF_SIZE)
+
+/// The longest we will hold a partially filled batch of outgoing frames before sending it
+#ifndef STREAM_BATCH_MSECS
+#define STREAM_BATCH_MSECS 10
+#endif
+
 /**
  * A version of our 'phone' API that talks over a Stream.  So therefore well suited to use with serial links
  * or TCP connections.
@@ -34,9 +43,13 @@ class StreamAPI : public PhoneAPI
      */
     Stream *stream;
 
+    /// Bytes we have read but not yet handled (always starts with the beginning of a possible frame)
     uint8_t rxBuf[MAX_STREAM_BUF_SIZE];
     size_t rxPtr = 0;
 
+    /// When the oldest frame in txBuf was added
+    uint32_t txFirstMsec = 0;
+
   public:
     StreamAPI(Stream *_stream) : stream(_stream) {}
 
@@ -47,12 +60,20 @@ class StreamAPI : public PhoneAPI
      */
     void loop();
 
+    /// @return how many msecs until loop() must run again to send the partial batch we are holding (INT32_MAX if we aren't)
+    int32_t msecsUntilFlush() const;
+
   private:
     /**
      * Read any rx chars from the link and call handleToRadio
      */
     void readStream();
 
+    /**
+     * Find and handle any complete frames in rxBuf, keeping any partial frame for next time
+     */
+    void handleRxBuf();
+
     /**
      * call getFromRadio() and deliver encapsulated packets to the Stream
      */
@@ -65,13 +86,28 @@ class StreamAPI : public PhoneAPI
     void emitRebooted();
     
     /**
-     * Send the current txBuffer over our stream
+     * Add a frame to our batch, the payload (of len bytes) must already be at txBuf + txLen + STREAM_HEADER_LEN
      */
-    void emitTxBuffer(size_t len);
+    void addTxFrame(size_t len);
+
+    /**
+     * Send our batch of frames over our stream
+     */
+    void flushTx();
 
     /// Are we allowed to write packets to our output stream (subclasses can turn this off - i.e. SerialConsole)
     bool canWrite = true;
 
-    /// Subclasses can use this scratch buffer if they wish
-    uint8_t txBuf[MAX_STREAM_BUF_SIZE];
+    /// Subclasses with a limited output buffer can return false to stop us generating more frames until it drains
+    virtual bool canWriteFrame() { return true; }
+
+    /**
+     * Read up to len bytes which have already arrived (never blocks).  Stream::readBytes copies one byte at a time (checking
+     * its timeout for each), subclasses whose stream can hand over a whole block should override this.
+     */
+    virtual size_t readAvailable(uint8_t *buf, size_t len) { return stream->readBytes(buf, len); }
+
+    /// Outgoing frames waiting to be sent as one batch
+    uint8_t txBuf[STREAM_TX_BATCH_SIZE];
+    size_t txLen = 0;
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// The framing in front of each packet (see "Wire encoding" in StreamAPI.h)
+#define STREAM_START1 0x94
+#define STREAM_START2 0xc3
+#define STREAM_HEADER_LEN 4
+
+/// Write the header for a frame with a payload of len bytes
+inline void streamFrameHeader(uint8_t *header, size_t len)
+{
+    header[0] = STREAM_START1;
+    header[1] = STREAM_START2;
+    header[2] = (len >> 8) & 0xff;
+    header[3] = len & 0xff;
+}
+
+/**
+ * Find the complete frames in buf, calling onFrame(payload, payloadLen) for each.  Anything which can't be the start of a frame
+ * (i.e. debug text, or a header with a length over maxPayload) is skipped.
+ *
+ * @return how many bytes at the start of buf we are done with, the rest is the beginning of a frame we don't have all of yet
+ */
+template <class F> size_t streamFindFrames(const uint8_t *buf, size_t len, size_t maxPayload, F onFrame)
+{
+    size_t start = 0; // where the frame we are currently considering begins
+    while (start < len) {
+        const uint8_t *frame = buf + start;
+        size_t avail = len - start;
+
+        if (frame[0] != STREAM_START1) { // skip straight to the next possible frame
+            const uint8_t *next = (const uint8_t *)memchr(frame + 1, STREAM_START1, avail - 1);
+            start = next ? next - buf : len;
+            continue;
+        }
+
+        if (avail < 2)
+            break;                       // need more bytes
+        if (frame[1] != STREAM_START2) { // failed to find framing
+            start++;
+            continue;
+        }
+
+        if (avail < STREAM_HEADER_LEN)
+            break;
+        size_t payloadLen = (frame[2] << 8) + frame[3]; // big endian 16 bit length follows framing
+
+        // validate length now (note: a length of zero is a valid protobuf also)
+        if (payloadLen > maxPayload) { // length is bogus, restart search for framing
+            start++;
+            continue;
+        }
+
+        if (avail < STREAM_HEADER_LEN + payloadLen)
+            break; // wait for the rest of the payload
+
+        onFrame(frame + STREAM_HEADER_LEN, payloadLen);
+        start += STREAM_HEADER_LEN + payloadLen;
+    }
+
+    return start;
+}
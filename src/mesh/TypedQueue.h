@@ -1,113 +1,141 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <type_traits>
 
 #include "concurrency/OSThread.h"
 #include "freertosinc.h"
 
-#ifdef HAS_FREE_RTOS
-
 /**
- * A wrapper for freertos queues.  Note: each element object should be small
- * and POD (Plain Old Data type) as elements are memcpied by value.
+ * A bounded lock-free queue.  Note: each element object should be small and POD (Plain Old Data type) as elements are
+ * copied by value.
+ *
+ * We used to wrap FreeRTOS queues on the device (each call a kernel call inside a critical section) and an unbounded
+ * std::queue everywhere else, so the simulator never saw a full queue.  Now every platform runs this same ring.
+ *
+ * Any number of threads and ISRs may enqueue and dequeue at once: each slot has a sequence number saying whether it is
+ * waiting to be written or read (for which lap around the ring), and enqueuers/dequeuers claim a position with a single
+ * compare-and-swap.  Nothing ever waits for anyone else, so an ISR which interrupts a half finished enqueue just sees a slot
+ * which isn't ready yet (and a dequeue reports that as empty).  We never block - if the queue is full enqueue() fails and the
+ * caller must decide what to drop.
  */
 template <class T> class TypedQueue
 {
     static_assert(std::is_pod<T>::value, "T must be pod");
-    QueueHandle_t h;
-    concurrency::OSThread *reader = NULL;
 
-  public:
-    TypedQueue(int maxElements)
-    {
-        h = xQueueCreate(maxElements, sizeof(T));
-        assert(h);
-    }
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        T item;
+    };
 
-    ~TypedQueue() { vQueueDelete(h); }
+    Slot *slots;
+    uint32_t mask; // our capacity (a power of two) - 1
 
-    int numFree() { return uxQueueSpacesAvailable(h); }
+    std::atomic<uint32_t> enqueuePos, dequeuePos;
 
-    bool isEmpty() { return uxQueueMessagesWaiting(h) == 0; }
+    concurrency::OSThread *reader = NULL;
 
-    bool enqueue(T x, TickType_t maxWait = portMAX_DELAY)
+    bool push(const T &x)
     {
-        if (reader) {
-            reader->setInterval(0);
-            concurrency::mainDelay.interrupt();
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot *s = &slots[pos & mask];
+            int32_t diff = (int32_t)(s->sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s->item = x;
+                    s->sequence.store(pos + 1, std::memory_order_release); // ready to read
+                    return true;
+                }
+            } else if (diff < 0)
+                return false; // full (the reader hasn't finished with this slot from our last lap)
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed); // someone else got it first
         }
-        return xQueueSendToBack(h, &x, maxWait) == pdTRUE;
     }
 
-    bool enqueueFromISR(T x, BaseType_t *higherPriWoken)
+    bool pop(T *p)
     {
-        if (reader) {
-            reader->setInterval(0);
-            concurrency::mainDelay.interruptFromISR(higherPriWoken);
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot *s = &slots[pos & mask];
+            int32_t diff = (int32_t)(s->sequence.load(std::memory_order_acquire) - (pos + 1));
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    *p = s->item;
+                    s->sequence.store(pos + mask + 1, std::memory_order_release); // ready for the next lap
+                    return true;
+                }
+            } else if (diff < 0)
+                return false; // empty (or the writer of this slot hasn't finished yet)
+            else
+                pos = dequeuePos.load(std::memory_order_relaxed);
         }
-        return xQueueSendToBackFromISR(h, &x, higherPriWoken) == pdTRUE;
     }
 
-    bool dequeue(T *p, TickType_t maxWait = portMAX_DELAY) { return xQueueReceive(h, p, maxWait) == pdTRUE; }
-
-    bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return xQueueReceiveFromISR(h, p, higherPriWoken); }
-
-    /**
-     * Set a thread that is reading from this queue
-     * If a message is pushed to this queue that thread will be scheduled to run ASAP.
-     *
-     * Note: thread will not be automatically enabled, just have its interval set to 0
-     */
-    void setReader(concurrency::OSThread *t) { reader = t; }
-};
-
-#else
-
-#include <queue>
-
-/**
- * A wrapper for freertos queues.  Note: each element object should be small
- * and POD (Plain Old Data type) as elements are memcpied by value.
- */
-template <class T> class TypedQueue
-{
-    std::queue<T> q;
-    concurrency::OSThread *reader = NULL;
-
   public:
-    TypedQueue(int maxElements) {}
+    /// maxElements is rounded up to a power of two (of at least 2)
+    TypedQueue(int maxElements) : enqueuePos(0), dequeuePos(0)
+    {
+        assert(maxElements > 0);
+        uint32_t capacity = 2; // With one slot its sequence number can't tell a full slot from one free for the next lap
+        while (capacity < (uint32_t)maxElements)
+            capacity <<= 1;
+
+        mask = capacity - 1;
+        slots = new Slot[capacity];
+        for (uint32_t i = 0; i < capacity; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
 
-    int numFree() { return 1; } // Always claim 1 free, because we can grow to any size
+    ~TypedQueue() { delete[] slots; }
 
-    bool isEmpty() { return q.empty(); }
+    TypedQueue(const TypedQueue &) = delete;
+    TypedQueue &operator=(const TypedQueue &) = delete;
 
-    bool enqueue(T x, TickType_t maxWait = portMAX_DELAY)
+    /// @return how many more elements would fit (only a snapshot if others are using the queue)
+    int numFree()
     {
-        if (reader) {
-            reader->setInterval(0);
-            concurrency::mainDelay.interrupt();
-        }
+        uint32_t used = enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed);
+        return used > mask ? 0 : mask + 1 - used;
+    }
 
-        q.push(x);
-        return true;
+    /// @return true if a dequeue would find nothing right now
+    bool isEmpty()
+    {
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        return slots[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
     }
 
-    // bool enqueueFromISR(T x, BaseType_t *higherPriWoken) { return xQueueSendToBackFromISR(h, &x, higherPriWoken) == pdTRUE; }
+    /// Add an element, @return false (and don't add it) if we are full
+    bool enqueue(T x)
+    {
+        bool r = push(x);
+        if (r && reader)
+            reader->wake();
+        return r;
+    }
 
-    bool dequeue(T *p, TickType_t maxWait = portMAX_DELAY)
+    bool enqueueFromISR(T x, BaseType_t *higherPriWoken)
     {
-        if (isEmpty())
-            return false;
-        else {
-            *p = q.front();
-            q.pop();
-            return true;
-        }
+        bool r = push(x);
+        if (r && reader)
+            reader->wakeFromISR(higherPriWoken);
+        return r;
     }
 
-    // bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return xQueueReceiveFromISR(h, p, higherPriWoken); }
+    /// Remove the oldest element, @return false if there was none
+    bool dequeue(T *p) { return pop(p); }
+
+    bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return pop(p); }
 
+    /**
+     * Set a thread that is reading from this queue
+     * If a message is pushed to this queue that thread will be scheduled to run ASAP.
+     *
+     * Note: thread will not be automatically enabled, just woken
+     */
     void setReader(concurrency::OSThread *t) { reader = t; }
 };
-#endif
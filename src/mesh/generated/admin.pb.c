@@ -6,6 +6,24 @@
 #error Regenerate this file with the current version of nanopb generator.
 #endif
 
+PB_BIND(PluginStats, PluginStats, AUTO)
+
+
+PB_BIND(PluginStatsList, PluginStatsList, AUTO)
+
+
+PB_BIND(ThreadStats, ThreadStats, AUTO)
+
+
+PB_BIND(ThreadStatsList, ThreadStatsList, AUTO)
+
+
+PB_BIND(MetricValue, MetricValue, 2)
+
+
+PB_BIND(MetricList, MetricList, 2)
+
+
 PB_BIND(AdminMessage, AdminMessage, 2)
 
 
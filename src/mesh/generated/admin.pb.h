@@ -13,6 +13,60 @@
 #endif
 
 /* Struct definitions */
+typedef struct _PluginStats {
+    char name[16];
+    uint32_t calls;
+    uint32_t handled;
+    uint32_t total_usec;
+    uint32_t max_usec;
+    uint32_t bytes;
+    uint32_t replies;
+} PluginStats;
+
+typedef struct _PluginStatsList {
+    pb_size_t stats_count;
+    PluginStats stats[4];
+    uint32_t first_index;
+    uint32_t num_plugins;
+} PluginStatsList;
+
+typedef struct _ThreadStats {
+    char name[16];
+    uint32_t runs;
+    uint32_t total_usec;
+    uint32_t max_usec;
+    uint32_t missed;
+    uint32_t max_late_msec;
+    uint32_t wakeups;
+    uint32_t stack_free;
+} ThreadStats;
+
+typedef struct _ThreadStatsList {
+    pb_size_t stats_count;
+    ThreadStats stats[3];
+    uint32_t first_index;
+    uint32_t num_threads;
+    uint32_t wakeups_last_hour;
+} ThreadStatsList;
+
+typedef struct _MetricValue {
+    char name[32];
+    uint32_t type;
+    int64_t value;
+    uint32_t sum;
+    pb_size_t bounds_count;
+    uint32_t bounds[7];
+    pb_size_t counts_count;
+    uint32_t counts[8];
+} MetricValue;
+
+typedef struct _MetricList {
+    pb_size_t metrics_count;
+    MetricValue metrics[3];
+    uint32_t first_index;
+    uint32_t num_metrics;
+} MetricList;
+
 typedef struct _AdminMessage {
     pb_size_t which_variant;
     union {
@@ -23,6 +77,12 @@ typedef struct _AdminMessage {
         RadioConfig get_radio_response;
         uint32_t get_channel_request;
         Channel get_channel_response;
+        uint32_t get_plugin_stats_request;
+        PluginStatsList get_plugin_stats_response;
+        uint32_t get_thread_stats_request;
+        ThreadStatsList get_thread_stats_response;
+        uint32_t get_metrics_request;
+        MetricList get_metrics_response;
     };
 } AdminMessage;
 
@@ -32,10 +92,53 @@ extern "C" {
 #endif
 
 /* Initializer values for message structs */
+#define PluginStats_init_default                 {"", 0, 0, 0, 0, 0, 0}
+#define PluginStatsList_init_default             {0, {PluginStats_init_default, PluginStats_init_default, PluginStats_init_default, PluginStats_init_default}, 0, 0}
+#define ThreadStats_init_default                 {"", 0, 0, 0, 0, 0, 0, 0}
+#define ThreadStatsList_init_default             {0, {ThreadStats_init_default, ThreadStats_init_default, ThreadStats_init_default}, 0, 0, 0}
+#define MetricValue_init_default                 {"", 0, 0, 0, 0, {0, 0, 0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0, 0, 0, 0}}
+#define MetricList_init_default                  {0, {MetricValue_init_default, MetricValue_init_default, MetricValue_init_default}, 0, 0}
 #define AdminMessage_init_default                {0, {RadioConfig_init_default}}
+#define PluginStats_init_zero                    {"", 0, 0, 0, 0, 0, 0}
+#define PluginStatsList_init_zero                {0, {PluginStats_init_zero, PluginStats_init_zero, PluginStats_init_zero, PluginStats_init_zero}, 0, 0}
+#define ThreadStats_init_zero                    {"", 0, 0, 0, 0, 0, 0, 0}
+#define ThreadStatsList_init_zero                {0, {ThreadStats_init_zero, ThreadStats_init_zero, ThreadStats_init_zero}, 0, 0, 0}
+#define MetricValue_init_zero                    {"", 0, 0, 0, 0, {0, 0, 0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0, 0, 0, 0}}
+#define MetricList_init_zero                     {0, {MetricValue_init_zero, MetricValue_init_zero, MetricValue_init_zero}, 0, 0}
 #define AdminMessage_init_zero                   {0, {RadioConfig_init_zero}}
 
 /* Field tags (for use in manual encoding/decoding) */
+#define PluginStats_name_tag                     1
+#define PluginStats_calls_tag                    2
+#define PluginStats_handled_tag                  3
+#define PluginStats_total_usec_tag               4
+#define PluginStats_max_usec_tag                 5
+#define PluginStats_bytes_tag                    6
+#define PluginStats_replies_tag                  7
+#define PluginStatsList_stats_tag                1
+#define PluginStatsList_first_index_tag          2
+#define PluginStatsList_num_plugins_tag          3
+#define ThreadStats_name_tag                     1
+#define ThreadStats_runs_tag                     2
+#define ThreadStats_total_usec_tag               3
+#define ThreadStats_max_usec_tag                 4
+#define ThreadStats_missed_tag                   5
+#define ThreadStats_max_late_msec_tag            6
+#define ThreadStats_wakeups_tag                  7
+#define ThreadStats_stack_free_tag               8
+#define ThreadStatsList_stats_tag                1
+#define ThreadStatsList_first_index_tag          2
+#define ThreadStatsList_num_threads_tag          3
+#define ThreadStatsList_wakeups_last_hour_tag    4
+#define MetricValue_name_tag                     1
+#define MetricValue_type_tag                     2
+#define MetricValue_value_tag                    3
+#define MetricValue_sum_tag                      4
+#define MetricValue_bounds_tag                   5
+#define MetricValue_counts_tag                   6
+#define MetricList_metrics_tag                   1
+#define MetricList_first_index_tag               2
+#define MetricList_num_metrics_tag               3
 #define AdminMessage_set_radio_tag               1
 #define AdminMessage_set_owner_tag               2
 #define AdminMessage_set_channel_tag             3
@@ -43,8 +146,72 @@ extern "C" {
 #define AdminMessage_get_radio_response_tag      5
 #define AdminMessage_get_channel_request_tag     6
 #define AdminMessage_get_channel_response_tag    7
+#define AdminMessage_get_plugin_stats_request_tag 8
+#define AdminMessage_get_plugin_stats_response_tag 9
+#define AdminMessage_get_thread_stats_request_tag 10
+#define AdminMessage_get_thread_stats_response_tag 11
+#define AdminMessage_get_metrics_request_tag     12
+#define AdminMessage_get_metrics_response_tag    13
 
 /* Struct field encoding specification for nanopb */
+#define PluginStats_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, STRING,   name,              1) \
+X(a, STATIC,   SINGULAR, UINT32,   calls,             2) \
+X(a, STATIC,   SINGULAR, UINT32,   handled,           3) \
+X(a, STATIC,   SINGULAR, UINT32,   total_usec,        4) \
+X(a, STATIC,   SINGULAR, UINT32,   max_usec,          5) \
+X(a, STATIC,   SINGULAR, UINT32,   bytes,             6) \
+X(a, STATIC,   SINGULAR, UINT32,   replies,           7)
+#define PluginStats_CALLBACK NULL
+#define PluginStats_DEFAULT NULL
+
+#define PluginStatsList_FIELDLIST(X, a) \
+X(a, STATIC,   REPEATED, MESSAGE,  stats,             1) \
+X(a, STATIC,   SINGULAR, UINT32,   first_index,       2) \
+X(a, STATIC,   SINGULAR, UINT32,   num_plugins,       3)
+#define PluginStatsList_CALLBACK NULL
+#define PluginStatsList_DEFAULT NULL
+#define PluginStatsList_stats_MSGTYPE PluginStats
+
+#define ThreadStats_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, STRING,   name,              1) \
+X(a, STATIC,   SINGULAR, UINT32,   runs,              2) \
+X(a, STATIC,   SINGULAR, UINT32,   total_usec,        3) \
+X(a, STATIC,   SINGULAR, UINT32,   max_usec,          4) \
+X(a, STATIC,   SINGULAR, UINT32,   missed,            5) \
+X(a, STATIC,   SINGULAR, UINT32,   max_late_msec,     6) \
+X(a, STATIC,   SINGULAR, UINT32,   wakeups,           7) \
+X(a, STATIC,   SINGULAR, UINT32,   stack_free,        8)
+#define ThreadStats_CALLBACK NULL
+#define ThreadStats_DEFAULT NULL
+
+#define ThreadStatsList_FIELDLIST(X, a) \
+X(a, STATIC,   REPEATED, MESSAGE,  stats,             1) \
+X(a, STATIC,   SINGULAR, UINT32,   first_index,       2) \
+X(a, STATIC,   SINGULAR, UINT32,   num_threads,       3) \
+X(a, STATIC,   SINGULAR, UINT32,   wakeups_last_hour,   4)
+#define ThreadStatsList_CALLBACK NULL
+#define ThreadStatsList_DEFAULT NULL
+#define ThreadStatsList_stats_MSGTYPE ThreadStats
+
+#define MetricValue_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, STRING,   name,              1) \
+X(a, STATIC,   SINGULAR, UINT32,   type,              2) \
+X(a, STATIC,   SINGULAR, SINT64,   value,             3) \
+X(a, STATIC,   SINGULAR, UINT32,   sum,               4) \
+X(a, STATIC,   REPEATED, UINT32,   bounds,            5) \
+X(a, STATIC,   REPEATED, UINT32,   counts,            6)
+#define MetricValue_CALLBACK NULL
+#define MetricValue_DEFAULT NULL
+
+#define MetricList_FIELDLIST(X, a) \
+X(a, STATIC,   REPEATED, MESSAGE,  metrics,           1) \
+X(a, STATIC,   SINGULAR, UINT32,   first_index,       2) \
+X(a, STATIC,   SINGULAR, UINT32,   num_metrics,       3)
+#define MetricList_CALLBACK NULL
+#define MetricList_DEFAULT NULL
+#define MetricList_metrics_MSGTYPE MetricValue
+
 #define AdminMessage_FIELDLIST(X, a) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (variant,set_radio,set_radio),   1) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (variant,set_owner,set_owner),   2) \
@@ -52,7 +219,13 @@ X(a, STATIC,   ONEOF,    MESSAGE,  (variant,set_channel,set_channel),   3) \
 X(a, STATIC,   ONEOF,    BOOL,     (variant,get_radio_request,get_radio_request),   4) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (variant,get_radio_response,get_radio_response),   5) \
 X(a, STATIC,   ONEOF,    UINT32,   (variant,get_channel_request,get_channel_request),   6) \
-X(a, STATIC,   ONEOF,    MESSAGE,  (variant,get_channel_response,get_channel_response),   7)
+X(a, STATIC,   ONEOF,    MESSAGE,  (variant,get_channel_response,get_channel_response),   7) \
+X(a, STATIC,   ONEOF,    UINT32,   (variant,get_plugin_stats_request,get_plugin_stats_request),   8) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (variant,get_plugin_stats_response,get_plugin_stats_response),   9) \
+X(a, STATIC,   ONEOF,    UINT32,   (variant,get_thread_stats_request,get_thread_stats_request),  10) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (variant,get_thread_stats_response,get_thread_stats_response),  11) \
+X(a, STATIC,   ONEOF,    UINT32,   (variant,get_metrics_request,get_metrics_request),  12) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (variant,get_metrics_response,get_metrics_response),  13)
 #define AdminMessage_CALLBACK NULL
 #define AdminMessage_DEFAULT NULL
 #define AdminMessage_variant_set_radio_MSGTYPE RadioConfig
@@ -60,14 +233,35 @@ X(a, STATIC,   ONEOF,    MESSAGE,  (variant,get_channel_response,get_channel_res
 #define AdminMessage_variant_set_channel_MSGTYPE Channel
 #define AdminMessage_variant_get_radio_response_MSGTYPE RadioConfig
 #define AdminMessage_variant_get_channel_response_MSGTYPE Channel
+#define AdminMessage_variant_get_plugin_stats_response_MSGTYPE PluginStatsList
+#define AdminMessage_variant_get_thread_stats_response_MSGTYPE ThreadStatsList
+#define AdminMessage_variant_get_metrics_response_MSGTYPE MetricList
 
+extern const pb_msgdesc_t PluginStats_msg;
+extern const pb_msgdesc_t PluginStatsList_msg;
+extern const pb_msgdesc_t ThreadStats_msg;
+extern const pb_msgdesc_t ThreadStatsList_msg;
+extern const pb_msgdesc_t MetricValue_msg;
+extern const pb_msgdesc_t MetricList_msg;
 extern const pb_msgdesc_t AdminMessage_msg;
 
 /* Defines for backwards compatibility with code written before nanopb-0.4.0 */
+#define PluginStats_fields &PluginStats_msg
+#define PluginStatsList_fields &PluginStatsList_msg
+#define ThreadStats_fields &ThreadStats_msg
+#define ThreadStatsList_fields &ThreadStatsList_msg
+#define MetricValue_fields &MetricValue_msg
+#define MetricList_fields &MetricList_msg
 #define AdminMessage_fields &AdminMessage_msg
 
 /* Maximum encoded size of messages (where known) */
-#define AdminMessage_size                        351
+#define PluginStats_size                         53
+#define PluginStatsList_size                     232
+#define ThreadStats_size                         59
+#define ThreadStatsList_size                     201
+#define MetricValue_size                         135
+#define MetricList_size                          426
+#define AdminMessage_size                        429
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -27,12 +27,18 @@ PB_BIND(MeshPacket, MeshPacket, 2)
 PB_BIND(NodeInfo, NodeInfo, AUTO)
 
 
+PB_BIND(NodeInfoBatch, NodeInfoBatch, AUTO)
+
+
 PB_BIND(MyNodeInfo, MyNodeInfo, AUTO)
 
 
 PB_BIND(LogRecord, LogRecord, AUTO)
 
 
+PB_BIND(QueueStatus, QueueStatus, AUTO)
+
+
 PB_BIND(FromRadio, FromRadio, 2)
 
 
@@ -90,6 +90,8 @@ typedef struct _MyNodeInfo {
     uint32_t message_timeout_msec;
     uint32_t min_app_version;
     uint32_t max_channels;
+    uint32_t node_db_generation;
+    uint32_t max_batch_bytes;
 } MyNodeInfo;
 
 typedef struct _Position {
@@ -140,6 +142,11 @@ typedef struct _NodeInfo {
     float snr;
 } NodeInfo;
 
+typedef struct _NodeInfoBatch {
+    pb_size_t nodes_count;
+    NodeInfo nodes[3];
+} NodeInfoBatch;
+
 typedef struct _Routing {
     pb_size_t which_variant;
     union {
@@ -149,6 +156,13 @@ typedef struct _Routing {
     };
 } Routing;
 
+typedef struct _QueueStatus {
+    int32_t res;
+    uint32_t free;
+    uint32_t maxlen;
+    uint32_t mesh_packet_id;
+} QueueStatus;
+
 typedef struct _FromRadio {
     uint32_t num;
     pb_size_t which_payloadVariant;
@@ -159,6 +173,8 @@ typedef struct _FromRadio {
         uint32_t config_complete_id;
         bool rebooted;
         MeshPacket packet;
+        NodeInfoBatch node_infos;
+        QueueStatus queue_status;
     };
 } FromRadio;
 
@@ -168,6 +184,8 @@ typedef struct _ToRadio {
         MeshPacket packet;
         uint32_t want_config_id;
     };
+    uint32_t node_db_generation;
+    uint32_t max_batch_bytes;
 } ToRadio;
 
 
@@ -205,10 +223,12 @@ extern "C" {
 #define Data_init_default                        {_PortNum_MIN, {0, {0}}, 0, 0, 0, 0}
 #define MeshPacket_init_default                  {0, 0, 0, 0, {Data_init_default}, 0, 0, 0, 0, 0, _MeshPacket_Priority_MIN}
 #define NodeInfo_init_default                    {0, false, User_init_default, false, Position_init_default, 0, 0}
-#define MyNodeInfo_init_default                  {0, 0, 0, "", "", "", _CriticalErrorCode_MIN, 0, 0, 0, 0, 0}
+#define NodeInfoBatch_init_default               {0, {NodeInfo_init_default, NodeInfo_init_default, NodeInfo_init_default}}
+#define MyNodeInfo_init_default                  {0, 0, 0, "", "", "", _CriticalErrorCode_MIN, 0, 0, 0, 0, 0, 0, 0}
 #define LogRecord_init_default                   {"", 0, "", _LogRecord_Level_MIN}
+#define QueueStatus_init_default                 {0, 0, 0, 0}
 #define FromRadio_init_default                   {0, 0, {MyNodeInfo_init_default}}
-#define ToRadio_init_default                     {0, {MeshPacket_init_default}}
+#define ToRadio_init_default                     {0, {MeshPacket_init_default}, 0, 0}
 #define Position_init_zero                       {0, 0, 0, 0, 0}
 #define User_init_zero                           {"", "", "", {0}}
 #define RouteDiscovery_init_zero                 {0, {0, 0, 0, 0, 0, 0, 0, 0}}
@@ -216,10 +236,12 @@ extern "C" {
 #define Data_init_zero                           {_PortNum_MIN, {0, {0}}, 0, 0, 0, 0}
 #define MeshPacket_init_zero                     {0, 0, 0, 0, {Data_init_zero}, 0, 0, 0, 0, 0, _MeshPacket_Priority_MIN}
 #define NodeInfo_init_zero                       {0, false, User_init_zero, false, Position_init_zero, 0, 0}
-#define MyNodeInfo_init_zero                     {0, 0, 0, "", "", "", _CriticalErrorCode_MIN, 0, 0, 0, 0, 0}
+#define NodeInfoBatch_init_zero                  {0, {NodeInfo_init_zero, NodeInfo_init_zero, NodeInfo_init_zero}}
+#define MyNodeInfo_init_zero                     {0, 0, 0, "", "", "", _CriticalErrorCode_MIN, 0, 0, 0, 0, 0, 0, 0}
 #define LogRecord_init_zero                      {"", 0, "", _LogRecord_Level_MIN}
+#define QueueStatus_init_zero                    {0, 0, 0, 0}
 #define FromRadio_init_zero                      {0, 0, {MyNodeInfo_init_zero}}
-#define ToRadio_init_zero                        {0, {MeshPacket_init_zero}}
+#define ToRadio_init_zero                        {0, {MeshPacket_init_zero}, 0, 0}
 
 /* Field tags (for use in manual encoding/decoding) */
 #define Data_portnum_tag                         1
@@ -232,6 +254,10 @@ extern "C" {
 #define LogRecord_time_tag                       2
 #define LogRecord_source_tag                     3
 #define LogRecord_level_tag                      4
+#define QueueStatus_res_tag                      1
+#define QueueStatus_free_tag                     2
+#define QueueStatus_maxlen_tag                   3
+#define QueueStatus_mesh_packet_id_tag           4
 #define MyNodeInfo_my_node_num_tag               1
 #define MyNodeInfo_has_gps_tag                   2
 #define MyNodeInfo_num_bands_tag                 3
@@ -244,6 +270,8 @@ extern "C" {
 #define MyNodeInfo_message_timeout_msec_tag      13
 #define MyNodeInfo_min_app_version_tag           14
 #define MyNodeInfo_max_channels_tag              15
+#define MyNodeInfo_node_db_generation_tag        16
+#define MyNodeInfo_max_batch_bytes_tag           17
 #define Position_latitude_i_tag                  1
 #define Position_longitude_i_tag                 2
 #define Position_altitude_tag                    3
@@ -280,8 +308,12 @@ extern "C" {
 #define FromRadio_config_complete_id_tag         8
 #define FromRadio_rebooted_tag                   9
 #define FromRadio_packet_tag                     11
+#define FromRadio_node_infos_tag                 12
+#define FromRadio_queue_status_tag               13
 #define ToRadio_packet_tag                       2
 #define ToRadio_want_config_id_tag               100
+#define ToRadio_node_db_generation_tag           101
+#define ToRadio_max_batch_bytes_tag              102
 
 /* Struct field encoding specification for nanopb */
 #define Position_FIELDLIST(X, a) \
@@ -352,6 +384,12 @@ X(a, STATIC,   SINGULAR, FLOAT,    snr,               7)
 #define NodeInfo_user_MSGTYPE User
 #define NodeInfo_position_MSGTYPE Position
 
+#define NodeInfoBatch_FIELDLIST(X, a) \
+X(a, STATIC,   REPEATED, MESSAGE,  nodes,             1)
+#define NodeInfoBatch_CALLBACK NULL
+#define NodeInfoBatch_DEFAULT NULL
+#define NodeInfoBatch_nodes_MSGTYPE NodeInfo
+
 #define MyNodeInfo_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, UINT32,   my_node_num,       1) \
 X(a, STATIC,   SINGULAR, BOOL,     has_gps,           2) \
@@ -364,7 +402,9 @@ X(a, STATIC,   SINGULAR, UINT32,   error_address,     8) \
 X(a, STATIC,   SINGULAR, UINT32,   error_count,       9) \
 X(a, STATIC,   SINGULAR, UINT32,   message_timeout_msec,  13) \
 X(a, STATIC,   SINGULAR, UINT32,   min_app_version,  14) \
-X(a, STATIC,   SINGULAR, UINT32,   max_channels,     15)
+X(a, STATIC,   SINGULAR, UINT32,   max_channels,     15) \
+X(a, STATIC,   SINGULAR, UINT32,   node_db_generation,  16) \
+X(a, STATIC,   SINGULAR, UINT32,   max_batch_bytes,  17)
 #define MyNodeInfo_CALLBACK NULL
 #define MyNodeInfo_DEFAULT NULL
 
@@ -376,6 +416,14 @@ X(a, STATIC,   SINGULAR, UENUM,    level,             4)
 #define LogRecord_CALLBACK NULL
 #define LogRecord_DEFAULT NULL
 
+#define QueueStatus_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, INT32,    res,               1) \
+X(a, STATIC,   SINGULAR, UINT32,   free,              2) \
+X(a, STATIC,   SINGULAR, UINT32,   maxlen,            3) \
+X(a, STATIC,   SINGULAR, UINT32,   mesh_packet_id,    4)
+#define QueueStatus_CALLBACK NULL
+#define QueueStatus_DEFAULT NULL
+
 #define FromRadio_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, UINT32,   num,               1) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,my_info,my_info),   3) \
@@ -383,17 +431,23 @@ X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,node_info,node_info),   4) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,log_record,log_record),   7) \
 X(a, STATIC,   ONEOF,    UINT32,   (payloadVariant,config_complete_id,config_complete_id),   8) \
 X(a, STATIC,   ONEOF,    BOOL,     (payloadVariant,rebooted,rebooted),   9) \
-X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,packet,packet),  11)
+X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,packet,packet),  11) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,node_infos,node_infos),  12) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,queue_status,queue_status),  13)
 #define FromRadio_CALLBACK NULL
 #define FromRadio_DEFAULT NULL
 #define FromRadio_payloadVariant_my_info_MSGTYPE MyNodeInfo
 #define FromRadio_payloadVariant_node_info_MSGTYPE NodeInfo
 #define FromRadio_payloadVariant_log_record_MSGTYPE LogRecord
 #define FromRadio_payloadVariant_packet_MSGTYPE MeshPacket
+#define FromRadio_payloadVariant_node_infos_MSGTYPE NodeInfoBatch
+#define FromRadio_payloadVariant_queue_status_MSGTYPE QueueStatus
 
 #define ToRadio_FIELDLIST(X, a) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (payloadVariant,packet,packet),   2) \
-X(a, STATIC,   ONEOF,    UINT32,   (payloadVariant,want_config_id,want_config_id), 100)
+X(a, STATIC,   ONEOF,    UINT32,   (payloadVariant,want_config_id,want_config_id), 100) \
+X(a, STATIC,   SINGULAR, UINT32,   node_db_generation, 101) \
+X(a, STATIC,   SINGULAR, UINT32,   max_batch_bytes, 102)
 #define ToRadio_CALLBACK NULL
 #define ToRadio_DEFAULT NULL
 #define ToRadio_payloadVariant_packet_MSGTYPE MeshPacket
@@ -405,8 +459,10 @@ extern const pb_msgdesc_t Routing_msg;
 extern const pb_msgdesc_t Data_msg;
 extern const pb_msgdesc_t MeshPacket_msg;
 extern const pb_msgdesc_t NodeInfo_msg;
+extern const pb_msgdesc_t NodeInfoBatch_msg;
 extern const pb_msgdesc_t MyNodeInfo_msg;
 extern const pb_msgdesc_t LogRecord_msg;
+extern const pb_msgdesc_t QueueStatus_msg;
 extern const pb_msgdesc_t FromRadio_msg;
 extern const pb_msgdesc_t ToRadio_msg;
 
@@ -418,8 +474,10 @@ extern const pb_msgdesc_t ToRadio_msg;
 #define Data_fields &Data_msg
 #define MeshPacket_fields &MeshPacket_msg
 #define NodeInfo_fields &NodeInfo_msg
+#define NodeInfoBatch_fields &NodeInfoBatch_msg
 #define MyNodeInfo_fields &MyNodeInfo_msg
 #define LogRecord_fields &LogRecord_msg
+#define QueueStatus_fields &QueueStatus_msg
 #define FromRadio_fields &FromRadio_msg
 #define ToRadio_fields &ToRadio_msg
 
@@ -431,10 +489,12 @@ extern const pb_msgdesc_t ToRadio_msg;
 #define Data_size                                260
 #define MeshPacket_size                          298
 #define NodeInfo_size                            130
-#define MyNodeInfo_size                          89
+#define NodeInfoBatch_size                       399
+#define MyNodeInfo_size                          103
 #define LogRecord_size                           81
-#define FromRadio_size                           307
-#define ToRadio_size                             301
+#define QueueStatus_size                         29
+#define FromRadio_size                           408
+#define ToRadio_size                             315
 
 #ifdef __cplusplus
 } /* extern "C" */
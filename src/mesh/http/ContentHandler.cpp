@@ -1,9 +1,11 @@
+#include "Metrics.h"
 #include "NodeDB.h"
 #include "PowerFSM.h"
 #include "airtime.h"
 #include "main.h"
 #include "mesh/http/ContentHelper.h"
 #include "mesh/http/ContentStatic.h"
+#include "mesh/http/StaticFileCache.h"
 #include "mesh/http/WiFiAPClient.h"
 #include "power.h"
 #include "sleep.h"
@@ -54,7 +56,36 @@ char contentTypes[][2][32] = {{".txt", "text/plain"},     {".html", "text/html"}
 // Our API to handle messages to and from the radio.
 HttpAPI webAPI;
 
-uint32_t numberOfRequests = 0;
+/// If no client has asked for anything in this long we assume they have all gone away
+#define HTTP_API_IDLE_MSECS (60 * 1000)
+
+void HttpAPI::onRequest()
+{
+    lastRequestMsec = millis();
+    if (isIdle) {
+        DEBUG_MSG("HTTP client is back, holding packets for it again\n");
+        isIdle = false;
+        attachToPackets(); // it gets whatever is still in the ring
+    }
+}
+
+void HttpAPI::checkIdle()
+{
+    if (!isIdle && lastRequestMsec && millis() - lastRequestMsec >= HTTP_API_IDLE_MSECS) {
+        DEBUG_MSG("No HTTP client requests in %u secs, no longer holding packets for them\n", HTTP_API_IDLE_MSECS / 1000);
+        isIdle = true;
+        detachFromPackets();
+    }
+}
+
+static Counter webRequests("http_requests_total", "Requests our web server has handled");
+
+// How long each static file took to send (or to answer with a 304), and how much we sent
+static const uint32_t staticRequestBounds[] = {2, 5, 10, 20, 50, 100, 500};
+static FixedHistogram<7> staticRequestMsec("http_static_request_msec", "Time to answer each request for a static file",
+                                           staticRequestBounds);
+static Counter staticBytes("http_static_bytes_total", "Bytes of static files we have sent");
+static Counter staticNotModified("http_static_not_modified_total", "Requests for a static file we answered with a 304");
 uint32_t timeSpeedUp = 0;
 
 uint32_t getTimeSpeedUp()
@@ -67,6 +98,84 @@ void setTimeSpeedUp()
     timeSpeedUp = millis();
 }
 
+/// Content-Type is guessed using the definition of the contentTypes-table defined above
+static void setContentType(HTTPResponse *res, const std::string &filename)
+{
+    int cTypeIdx = 0;
+    do {
+        if (filename.rfind(contentTypes[cTypeIdx][0]) != std::string::npos) {
+            res->setHeader("Content-Type", contentTypes[cTypeIdx][1]);
+            return;
+        }
+        cTypeIdx += 1;
+    } while (strlen(contentTypes[cTypeIdx][0]) > 0);
+
+    // Set a default content type
+    res->setHeader("Content-Type", "application/octet-stream");
+}
+
+/**
+ * Send a file from SPIFFS, preferring the gzipped copy (filename + ".gz", see bin/gzip-static.py) if the client accepts gzip.
+ * We send a strong ETag with each file, so browsers can revalidate their cached copy, and if it is still current just send a 304
+ * (without touching flash).
+ *
+ * @return false if neither the file nor a gzipped copy exist (and we haven't sent anything)
+ */
+static bool sendStaticFile(HTTPRequest *req, HTTPResponse *res, const std::string &filename)
+{
+    uint32_t start = millis();
+    std::string filenameGzip = filename + ".gz";
+    bool acceptsGzip = req->getHeader("Accept-Encoding").find("gzip") != std::string::npos;
+
+    const StaticFileCache::Entry *file = acceptsGzip ? staticFileCache.get(filenameGzip) : NULL;
+    bool isGzip = file != NULL;
+    if (!file)
+        file = staticFileCache.get(filename);
+    if (!file && !acceptsGzip) {
+        // If all we have is the gzipped copy, send it anyway (like we always have)
+        file = staticFileCache.get(filenameGzip);
+        isGzip = true;
+    }
+    if (!file)
+        return false;
+
+    setContentType(res, filename);
+    if (isGzip)
+        res->setHeader("Content-Encoding", "gzip");
+    res->setHeader("ETag", file->etag);
+    res->setHeader("Vary", "Accept-Encoding");
+    res->setHeader("Cache-Control", "no-cache"); // Browsers may keep a copy, but must check with us (files can be uploaded)
+
+    if (req->getHeader("If-None-Match").find(file->etag) != std::string::npos) {
+        res->setStatusCode(304);
+        res->setStatusText("Not Modified");
+        staticNotModified.inc();
+        staticRequestMsec.observe(millis() - start);
+        DEBUG_MSG("Static %s not modified, %u ms\n", file->path.c_str(), millis() - start);
+        return true;
+    }
+
+    res->setHeader("Content-Length", httpsserver::intToString(file->size));
+
+    if (file->body)
+        res->write(file->body, file->size);
+    else {
+        // Read the file from SPIFFS and write it to the HTTP response body
+        File f = SPIFFS.open(file->path.c_str());
+        uint8_t buffer[256];
+        size_t length;
+        while ((length = f.read(buffer, sizeof(buffer))) > 0)
+            res->write(buffer, length);
+        f.close();
+    }
+
+    staticBytes.inc(file->size);
+    staticRequestMsec.observe(millis() - start);
+    DEBUG_MSG("Static %s sent %u bytes%s, %u ms\n", file->path.c_str(), file->size, file->body ? " from RAM" : "",
+              millis() - start);
+    return true;
+}
+
 void registerHandlers(HTTPServer *insecureServer, HTTPSServer *secureServer)
 {
 
@@ -89,6 +198,7 @@ void registerHandlers(HTTPServer *insecureServer, HTTPSServer *secureServer)
     ResourceNode *nodeJsonScanNetworks = new ResourceNode("/json/scanNetworks", "GET", &handleScanNetworks);
     ResourceNode *nodeJsonBlinkLED = new ResourceNode("/json/blink", "POST", &handleBlinkLED);
     ResourceNode *nodeJsonReport = new ResourceNode("/json/report", "GET", &handleReport);
+    ResourceNode *nodeMetrics = new ResourceNode("/metrics", "GET", &handleMetrics);
     ResourceNode *nodeJsonSpiffsBrowseStatic = new ResourceNode("/json/spiffs/browse/static", "GET", &handleSpiffsBrowseStatic);
     ResourceNode *nodeJsonDelete = new ResourceNode("/json/spiffs/delete/static", "DELETE", &handleSpiffsDeleteStatic);
 
@@ -109,6 +219,7 @@ void registerHandlers(HTTPServer *insecureServer, HTTPSServer *secureServer)
     secureServer->registerNode(nodeJsonSpiffsBrowseStatic);
     secureServer->registerNode(nodeJsonDelete);
     secureServer->registerNode(nodeJsonReport);
+    secureServer->registerNode(nodeMetrics);
     secureServer->setDefaultNode(node404);
 
     secureServer->addMiddleware(&middlewareSpeedUp240);
@@ -130,6 +241,7 @@ void registerHandlers(HTTPServer *insecureServer, HTTPSServer *secureServer)
     insecureServer->registerNode(nodeJsonSpiffsBrowseStatic);
     insecureServer->registerNode(nodeJsonDelete);
     insecureServer->registerNode(nodeJsonReport);
+    insecureServer->registerNode(nodeMetrics);
     insecureServer->setDefaultNode(node404);
 
     insecureServer->addMiddleware(&middlewareSpeedUp160);
@@ -147,7 +259,7 @@ void middlewareSpeedUp240(HTTPRequest *req, HTTPResponse *res, std::function<voi
     setCpuFrequencyMhz(240);
     setTimeSpeedUp();
 
-    numberOfRequests++;
+    webRequests.inc();
 }
 
 void middlewareSpeedUp160(HTTPRequest *req, HTTPResponse *res, std::function<void()> next)
@@ -167,7 +279,7 @@ void middlewareSpeedUp160(HTTPRequest *req, HTTPResponse *res, std::function<voi
     }
     setTimeSpeedUp();
 
-    numberOfRequests++;
+    webRequests.inc();
 }
 
 void handleAPIv1FromRadio(HTTPRequest *req, HTTPResponse *res)
@@ -196,6 +308,8 @@ void handleAPIv1FromRadio(HTTPRequest *req, HTTPResponse *res)
     res->setHeader("Access-Control-Allow-Methods", "GET");
     res->setHeader("X-Protobuf-Schema", "https://raw.githubusercontent.com/meshtastic/Meshtastic-protobufs/master/mesh.proto");
 
+    webAPI.onRequest();
+
     uint8_t txBuf[MAX_STREAM_BUF_SIZE];
     uint32_t len = 1;
 
@@ -205,19 +319,19 @@ void handleAPIv1FromRadio(HTTPRequest *req, HTTPResponse *res)
         //   to us at this point in time.
         if (valueAll == "true") {
             while (len) {
-                len = webAPI.getFromRadio(txBuf);
+                len = webAPI.getFromRadioBatch(txBuf, sizeof(txBuf));
                 res->write(txBuf, len);
             }
 
             // Otherwise, just return one protobuf
         } else {
-            len = webAPI.getFromRadio(txBuf);
+            len = webAPI.getFromRadioBatch(txBuf, sizeof(txBuf));
             res->write(txBuf, len);
         }
 
         // the param "all" was not spcified. Return just one protobuf
     } else {
-        len = webAPI.getFromRadio(txBuf);
+        len = webAPI.getFromRadioBatch(txBuf, sizeof(txBuf));
         res->write(txBuf, len);
     }
 
@@ -255,6 +369,7 @@ void handleAPIv1ToRadio(HTTPRequest *req, HTTPResponse *res)
     size_t s = req->readBytes(buffer, MAX_TO_FROM_RADIO_SIZE);
 
     DEBUG_MSG("Received %d bytes from PUT request\n", s);
+    webAPI.onRequest();
     webAPI.handleToRadio(buffer, s);
 
     res->write(buffer, s);
@@ -318,6 +433,7 @@ void handleStaticPost(HTTPRequest *req, HTTPResponse *res)
             // we use it and write the file contents directly to the SPIFFS:
             size_t fieldLength = 0;
             File file = SPIFFS.open(filename.c_str(), "w");
+            staticFileCache.clear();
             savedFile = true;
             while (!parser.endOfField()) {
                 byte buf[512];
@@ -404,6 +520,7 @@ void handleSpiffsDeleteStatic(HTTPRequest *req, HTTPResponse *res)
     if (params->getQueryParameter("delete", paramValDelete)) {
         std::string pathDelete = "/" + paramValDelete;
         if (SPIFFS.remove(pathDelete.c_str())) {
+            staticFileCache.clear();
             Serial.println(pathDelete.c_str());
             res->println("{");
             res->println("\"status\": \"ok\"");
@@ -437,9 +554,8 @@ void handleRoot(HTTPRequest *req, HTTPResponse *res)
     // DEBUG_MSG(cookie.c_str());
 
     std::string filename = "/static/index.html";
-    std::string filenameGzip = "/static/index.html.gz";
 
-    if (!SPIFFS.exists(filename.c_str()) && !SPIFFS.exists(filenameGzip.c_str())) {
+    if (!sendStaticFile(req, res, filename)) {
         // Send "404 Not Found" as response, as the file doesn't seem to exist
         res->setStatusCode(404);
         res->setStatusText("Not found");
@@ -450,34 +566,7 @@ void handleRoot(HTTPRequest *req, HTTPResponse *res)
         res->printf("<p>Please review the 'Common Problems' section of the <a "
                     "href=https://github.com/meshtastic/Meshtastic-device/wiki/"
                     "How-to-use-the-Meshtastic-Web-Interface-over-WiFi>web interface</a> documentation.</p>\n");
-        return;
-    }
-
-    // Try to open the file from SPIFFS
-    File file;
-
-    if (SPIFFS.exists(filename.c_str())) {
-        file = SPIFFS.open(filename.c_str());
-        if (!file.available()) {
-            DEBUG_MSG("File not available - %s\n", filename.c_str());
-        }
-
-    } else if (SPIFFS.exists(filenameGzip.c_str())) {
-        file = SPIFFS.open(filenameGzip.c_str());
-        res->setHeader("Content-Encoding", "gzip");
-        if (!file.available()) {
-            DEBUG_MSG("File not available\n");
-        }
     }
-
-    // Read the file from SPIFFS and write it to the HTTP response body
-    size_t length = 0;
-    do {
-        char buffer[256];
-        length = file.read((uint8_t *)buffer, 256);
-        std::string bufferString(buffer, length);
-        res->write((uint8_t *)bufferString.c_str(), bufferString.size());
-    } while (length > 0);
 }
 
 void handleStaticBrowse(HTTPRequest *req, HTTPResponse *res)
@@ -496,6 +585,7 @@ void handleStaticBrowse(HTTPRequest *req, HTTPResponse *res)
     if (params->getQueryParameter("delete", paramValDelete)) {
         std::string pathDelete = "/" + paramValDelete;
         if (SPIFFS.remove(pathDelete.c_str())) {
+            staticFileCache.clear();
             Serial.println(pathDelete.c_str());
             res->println("<html><head><meta http-equiv=\"refresh\" content=\"1;url=/static\" /><title>File "
                          "deleted!</title></head><body><h1>File deleted!</h1>");
@@ -629,64 +719,15 @@ void handleStatic(HTTPRequest *req, HTTPResponse *res)
     if (params->getPathParameter(0, parameter1)) {
 
         std::string filename = "/static/" + parameter1;
-        std::string filenameGzip = "/static/" + parameter1 + ".gz";
 
-        if (!SPIFFS.exists(filename.c_str()) && !SPIFFS.exists(filenameGzip.c_str())) {
+        if (!sendStaticFile(req, res, filename)) {
             // Send "404 Not Found" as response, as the file doesn't seem to exist
             res->setStatusCode(404);
             res->setStatusText("Not found");
             res->println("404 Not Found");
             res->printf("<p>File not found: %s</p>\n", filename.c_str());
-            return;
-        }
-
-        // Try to open the file from SPIFFS
-        File file;
-
-        if (SPIFFS.exists(filename.c_str())) {
-            file = SPIFFS.open(filename.c_str());
-            if (!file.available()) {
-                DEBUG_MSG("File not available - %s\n", filename.c_str());
-            }
-
-        } else if (SPIFFS.exists(filenameGzip.c_str())) {
-            file = SPIFFS.open(filenameGzip.c_str());
-            res->setHeader("Content-Encoding", "gzip");
-            if (!file.available()) {
-                DEBUG_MSG("File not available\n");
-            }
-        }
-
-        res->setHeader("Content-Length", httpsserver::intToString(file.size()));
-
-        bool has_set_content_type = false;
-        // Content-Type is guessed using the definition of the contentTypes-table defined above
-        int cTypeIdx = 0;
-        do {
-            if (filename.rfind(contentTypes[cTypeIdx][0]) != std::string::npos) {
-                res->setHeader("Content-Type", contentTypes[cTypeIdx][1]);
-                has_set_content_type = true;
-                break;
-            }
-            cTypeIdx += 1;
-        } while (strlen(contentTypes[cTypeIdx][0]) > 0);
-
-        if (!has_set_content_type) {
-            // Set a default content type
-            res->setHeader("Content-Type", "application/octet-stream");
         }
 
-        // Read the file from SPIFFS and write it to the HTTP response body
-        size_t length = 0;
-        do {
-            char buffer[256];
-            length = file.read((uint8_t *)buffer, 256);
-            std::string bufferString(buffer, length);
-            res->write((uint8_t *)bufferString.c_str(), bufferString.size());
-        } while (length > 0);
-
-        file.close();
-
         return;
 
     } else {
@@ -786,6 +827,7 @@ void handleFormUpload(HTTPRequest *req, HTTPResponse *res)
 
         // Create a new file on spiffs to stream the data into
         File file = SPIFFS.open(pathname.c_str(), "w");
+        staticFileCache.clear();
         size_t fileLength = 0;
         didwrite = true;
 
@@ -827,6 +869,17 @@ void handleFormUpload(HTTPRequest *req, HTTPResponse *res)
     delete parser;
 }
 
+/// Print one of our airtime logs as a JSON array member
+static void printAirtimeLog(Print &out, const char *name, reportTypes reportType)
+{
+    uint32_t *logArray = airtimeReport(reportType);
+
+    out.printf("\"%s\": [", name);
+    for (int i = 0; i < getPeriodsToLog(); i++)
+        out.printf("%s%u", i ? ", " : "", logArray[i]);
+    out.println("],");
+}
+
 void handleReport(HTTPRequest *req, HTTPResponse *res)
 {
 
@@ -847,101 +900,84 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
         res->println("<pre>");
     }
 
-    res->println("{");
-
-    res->println("\"data\": {");
-
-    res->println("\"airtime\": {");
-
-    uint32_t *logArray;
-
-    res->print("\"tx_log\": [");
-
-    logArray = airtimeReport(TX_LOG);
-    for (int i = 0; i < getPeriodsToLog(); i++) {
-        uint32_t tmp;
-        tmp = *(logArray + i);
-        res->printf("%d", tmp);
-        if (i != getPeriodsToLog() - 1) {
-            res->print(", ");
-        }
-    }
-
-    res->println("],");
-    res->print("\"rx_log\": [");
-
-    logArray = airtimeReport(RX_LOG);
-    for (int i = 0; i < getPeriodsToLog(); i++) {
-        uint32_t tmp;
-        tmp = *(logArray + i);
-        res->printf("%d", tmp);
-        if (i != getPeriodsToLog() - 1) {
-            res->print(", ");
-        }
-    }
-
-    res->println("],");
-    res->print("\"rx_all_log\": [");
-
-    logArray = airtimeReport(RX_ALL_LOG);
-    for (int i = 0; i < getPeriodsToLog(); i++) {
-        uint32_t tmp;
-        tmp = *(logArray + i);
-        res->printf("%d", tmp);
-        if (i != getPeriodsToLog() - 1) {
-            res->print(", ");
-        }
-    }
-
-    res->println("],");
-    res->printf("\"seconds_since_boot\": %u,\n", getSecondsSinceBoot());
-    res->printf("\"seconds_per_period\": %u,\n", getSecondsPerPeriod());
-    res->printf("\"periods_to_log\": %u\n", getPeriodsToLog());
-
-    res->println("},");
-
-    res->println("\"wifi\": {");
-
-    res->printf("\"web_request_count\": %d,\n", numberOfRequests);
-    res->println("\"rssi\": " + String(WiFi.RSSI()) + ",");
-
+    // Each write to res is a socket send, so we collect the report into bigger chunks
+    BufferedPrint out(*res);
+
+    out.println("{");
+
+    out.println("\"data\": {");
+
+    out.println("\"airtime\": {");
+    printAirtimeLog(out, "tx_log", TX_LOG);
+    printAirtimeLog(out, "rx_log", RX_LOG);
+    printAirtimeLog(out, "rx_all_log", RX_ALL_LOG);
+    out.printf("\"seconds_since_boot\": %u,\n", getSecondsSinceBoot());
+    out.printf("\"seconds_per_period\": %u,\n", getSecondsPerPeriod());
+    out.printf("\"periods_to_log\": %u\n", getPeriodsToLog());
+    out.println("},");
+
+    out.println("\"wifi\": {");
+    out.printf("\"web_request_count\": %u,\n", webRequests.get());
+    out.printf("\"static_cache_hits\": %u,\n", staticFileCache.hits);
+    out.printf("\"static_cache_misses\": %u,\n", staticFileCache.misses);
+    out.printf("\"static_cache_bytes\": %u,\n", staticFileCache.getBodyBytes());
+    out.printf("\"static_bytes_sent\": %u,\n", staticBytes.get());
+    out.printf("\"rssi\": %d,\n", WiFi.RSSI());
     if (radioConfig.preferences.wifi_ap_mode || isSoftAPForced()) {
-        res->println("\"ip\": \"" + String(WiFi.softAPIP().toString().c_str()) + "\"");
+        out.printf("\"ip\": \"%s\"\n", WiFi.softAPIP().toString().c_str());
     } else {
-        res->println("\"ip\": \"" + String(WiFi.localIP().toString().c_str()) + "\"");
+        out.printf("\"ip\": \"%s\"\n", WiFi.localIP().toString().c_str());
     }
+    out.println("},");
+
+    out.println("\"memory\": {");
+    out.printf("\"heap_total\": %d,\n", ESP.getHeapSize());
+    out.printf("\"heap_free\": %d,\n", ESP.getFreeHeap());
+    out.printf("\"psram_total\": %d,\n", ESP.getPsramSize());
+    out.printf("\"psram_free\": %d,\n", ESP.getFreePsram());
+    out.printf("\"spiffs_total\": %u,\n", (uint32_t)SPIFFS.totalBytes());
+    out.printf("\"spiffs_used\": %u,\n", (uint32_t)SPIFFS.usedBytes());
+    out.printf("\"spiffs_free\": %u\n", (uint32_t)(SPIFFS.totalBytes() - SPIFFS.usedBytes()));
+    out.println("},");
+
+    out.println("\"power\": {");
+    out.printf("\"battery_percent\": %u,\n", powerStatus->getBatteryChargePercent());
+    out.printf("\"battery_voltage_mv\": %u,\n", powerStatus->getBatteryVoltageMv());
+    out.printf("\"has_battery\": %s,\n", BoolToString(powerStatus->getHasBattery()));
+    out.printf("\"has_usb\": %s,\n", BoolToString(powerStatus->getHasUSB()));
+    out.printf("\"is_charging\": %s\n", BoolToString(powerStatus->getIsCharging()));
+    out.println("},");
+
+    out.println("\"radio\": {");
+    out.printf("\"frequecy\": %f,\n", RadioLibInterface::instance->getFreq());
+    out.printf("\"lora_channel\": %d\n", RadioLibInterface::instance->getChannelNum());
+    out.println("},");
+
+    // Everything in our metrics registry (the same as /metrics), including the plugin, thread and tophone stats
+    out.print("\"metrics\": ");
+    JsonWriter metrics(out);
+    writeMetrics(metrics);
+    metrics.finish();
+    out.println();
+
+    out.println("},");
+
+    out.println("\"status\": \"ok\"");
+    out.println("}");
+}
 
-    res->println("},");
-
-    res->println("\"memory\": {");
-    res->printf("\"heap_total\": %d,\n", ESP.getHeapSize());
-    res->printf("\"heap_free\": %d,\n", ESP.getFreeHeap());
-    res->printf("\"psram_total\": %d,\n", ESP.getPsramSize());
-    res->printf("\"psram_free\": %d,\n", ESP.getFreePsram());
-    res->println("\"spiffs_total\" : " + String(SPIFFS.totalBytes()) + ",");
-    res->println("\"spiffs_used\" : " + String(SPIFFS.usedBytes()) + ",");
-    res->println("\"spiffs_free\" : " + String(SPIFFS.totalBytes() - SPIFFS.usedBytes()));
-    res->println("},");
-
-    res->println("\"power\": {");
-    res->printf("\"battery_percent\": %u,\n", powerStatus->getBatteryChargePercent());
-    res->printf("\"battery_voltage_mv\": %u,\n", powerStatus->getBatteryVoltageMv());
-    res->printf("\"has_battery\": %s,\n", BoolToString(powerStatus->getHasBattery()));
-    res->printf("\"has_usb\": %s,\n", BoolToString(powerStatus->getHasUSB()));
-    res->printf("\"is_charging\": %s\n", BoolToString(powerStatus->getIsCharging()));
-    res->println("},");
-
-    res->println("\"radio\": {");
-    res->printf("\"frequecy\": %f,\n", RadioLibInterface::instance->getFreq());
-    res->printf("\"lora_channel\": %d\n", RadioLibInterface::instance->getChannelNum());
-    res->println("}");
-
-    res->println("},");
-
-
+/**
+ * Our metrics registry in the Prometheus text format, so a Prometheus server (or anything else which understands the format)
+ * can scrape us directly.
+ */
+void handleMetrics(HTTPRequest *req, HTTPResponse *res)
+{
+    res->setHeader("Content-Type", "text/plain; version=0.0.4");
+    res->setHeader("Access-Control-Allow-Origin", "*");
 
-    res->println("\"status\": \"ok\"");
-    res->println("}");
+    BufferedPrint out(*res);
+    PrometheusWriter w(out);
+    writeMetrics(w);
 }
 
 // --------
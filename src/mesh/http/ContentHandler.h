@@ -19,6 +19,7 @@ void handleSpiffsBrowseStatic(HTTPRequest *req, HTTPResponse *res);
 void handleSpiffsDeleteStatic(HTTPRequest *req, HTTPResponse *res);
 void handleBlinkLED(HTTPRequest *req, HTTPResponse *res);
 void handleReport(HTTPRequest *req, HTTPResponse *res);
+void handleMetrics(HTTPRequest *req, HTTPResponse *res);
 void handleFavicon(HTTPRequest *req, HTTPResponse *res);
 
 void middlewareSpeedUp240(HTTPRequest *req, HTTPResponse *res, std::function<void()> next);
@@ -34,13 +35,24 @@ class HttpAPI : public PhoneAPI
 {
 
   public:
-    // Nothing here yet
+    /// Note that a client asked us for something (and start holding packets for it again if we had stopped)
+    void onRequest();
+
+    /// HTTP clients just stop asking when they go away, so if nobody has asked for a while stop holding packets for them
+    void checkIdle();
 
   private:
-    // Nothing here yet
+    /// millis() of the last request from a client
+    uint32_t lastRequestMsec = 0;
+
+    /// Did checkIdle() detach us from the packets?
+    bool isIdle = false;
 
   protected:
-    // Nothing here yet
+    /// We read with getFromRadioBatch()
+    virtual bool supportsBatching() { return true; }
 };
 
+extern HttpAPI webAPI;
+
 
@@ -0,0 +1,140 @@
+#include "mesh/http/StaticFileCache.h"
+#include "configuration.h"
+#include <SPIFFS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+StaticFileCache staticFileCache;
+
+/// FNV-1a, we only need to notice when a file changes
+static uint32_t hashBytes(uint32_t hash, const uint8_t *buf, size_t len)
+{
+    while (len--) {
+        hash ^= *buf++;
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+#define FNV_OFFSET_BASIS 2166136261u
+
+const StaticFileCache::Entry *StaticFileCache::get(const std::string &path)
+{
+    useCount++;
+    for (size_t i = 0; i < numEntries; i++)
+        if (entries[i].path == path) {
+            entries[i].lastUsed = useCount;
+            hits++;
+            return &entries[i];
+        }
+
+    for (size_t i = 0; i < STATIC_CACHE_MISSING; i++)
+        if (missing[i] == path) {
+            hits++;
+            return NULL;
+        }
+
+    misses++;
+    if (!SPIFFS.exists(path.c_str())) {
+        missing[nextMissing] = path;
+        nextMissing = (nextMissing + 1) % STATIC_CACHE_MISSING;
+        return NULL;
+    }
+
+    File file = SPIFFS.open(path.c_str());
+    if (!file)
+        return NULL;
+
+    Entry &e = allocEntry();
+    e.path = path;
+    e.size = file.size();
+    e.lastUsed = useCount;
+
+    if (e.size <= STATIC_CACHE_MAX_FILE) {
+        makeRoom(e.size);
+        e.body = (uint8_t *)malloc(e.size ? e.size : 1);
+        if (e.body)
+            bodyBytes += e.size;
+    }
+
+    // Read the whole file once, to hash it (and keep the contents if we can)
+    uint32_t hash = FNV_OFFSET_BASIS;
+    uint8_t buf[256];
+    size_t pos = 0;
+    int len;
+    while (pos < e.size && (len = file.read(buf, sizeof(buf))) > 0) {
+        hash = hashBytes(hash, buf, len);
+        if (e.body)
+            memcpy(e.body + pos, buf, len);
+        pos += len;
+    }
+    file.close();
+
+    if (pos != e.size) {
+        DEBUG_MSG("Error: short read of %s\n", path.c_str());
+        releaseBody(e);
+        e.path.clear(); // Don't let anyone find this entry
+        return NULL;
+    }
+
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%x-%x\"", e.size, hash);
+    e.etag = etag;
+
+    return &e;
+}
+
+void StaticFileCache::clear()
+{
+    for (size_t i = 0; i < numEntries; i++) {
+        releaseBody(entries[i]);
+        entries[i].path.clear();
+    }
+    numEntries = 0;
+
+    for (size_t i = 0; i < STATIC_CACHE_MISSING; i++)
+        missing[i].clear();
+}
+
+void StaticFileCache::releaseBody(Entry &e)
+{
+    if (e.body) {
+        free(e.body);
+        e.body = NULL;
+        bodyBytes -= e.size;
+    }
+}
+
+StaticFileCache::Entry &StaticFileCache::allocEntry()
+{
+    // Reuse an entry from a failed load, if we have one
+    for (size_t i = 0; i < numEntries; i++)
+        if (entries[i].path.empty())
+            return entries[i];
+
+    if (numEntries < STATIC_CACHE_ENTRIES)
+        return entries[numEntries++];
+
+    Entry *oldest = &entries[0];
+    for (size_t i = 1; i < numEntries; i++)
+        if (entries[i].lastUsed < oldest->lastUsed)
+            oldest = &entries[i];
+
+    releaseBody(*oldest);
+    return *oldest;
+}
+
+void StaticFileCache::makeRoom(size_t len)
+{
+    while (bodyBytes + len > STATIC_CACHE_MAX_BYTES) {
+        Entry *oldest = NULL;
+        for (size_t i = 0; i < numEntries; i++)
+            if (entries[i].body && (!oldest || entries[i].lastUsed < oldest->lastUsed))
+                oldest = &entries[i];
+
+        if (!oldest)
+            break;
+        releaseBody(*oldest);
+    }
+}
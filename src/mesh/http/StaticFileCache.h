@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/// How many files we remember (the ETag of each, and the contents of the small ones)
+#define STATIC_CACHE_ENTRIES 16
+
+/// Files larger than this are always streamed from SPIFFS, we only remember their ETag
+#define STATIC_CACHE_MAX_FILE (8 * 1024)
+
+/// The most RAM we will use for cached file contents
+#define STATIC_CACHE_MAX_BYTES (32 * 1024)
+
+/// How many paths we remember don't exist (i.e. the gzipped copy of a file we only have uncompressed)
+#define STATIC_CACHE_MISSING 16
+
+/**
+ * A small LRU cache of the files our web server sends from SPIFFS.
+ *
+ * For each file we remember its size and a strong ETag (a hash of its contents), so we can answer If-None-Match requests with
+ * a 304 without touching flash.  The contents of small files (the hottest assets of the web UI) are kept in RAM too.  We also
+ * remember a few paths which don't exist, because sendStaticFile() looks for a gzipped copy of every file first.
+ *
+ * Anything which writes or deletes files in SPIFFS must call clear().
+ */
+class StaticFileCache
+{
+  public:
+    struct Entry {
+        std::string path; // the file in SPIFFS
+        uint32_t size = 0;
+        std::string etag;      // including the quotes, ready for use as a header
+        uint8_t *body = NULL;  // the contents (if the file was small enough to cache)
+        uint32_t lastUsed = 0; // for LRU replacement
+    };
+
+  private:
+    Entry entries[STATIC_CACHE_ENTRIES];
+    size_t numEntries = 0;
+
+    /// bytes of file contents we are holding
+    size_t bodyBytes = 0;
+
+    /// incremented on each lookup, so we know which entries are least recently used
+    uint32_t useCount = 0;
+
+    /// Paths we know don't exist, replaced round robin
+    std::string missing[STATIC_CACHE_MISSING];
+    size_t nextMissing = 0;
+
+  public:
+    /// Stats for /json/report (a hit is any lookup we answered without touching flash, including for a missing file)
+    uint32_t hits = 0, misses = 0;
+
+    /** Find (or load) the cache entry for a file in SPIFFS.
+     * @return NULL if the file doesn't exist.  The entry is only valid until the next call to get() or clear().
+     */
+    const Entry *get(const std::string &path);
+
+    /// Forget everything (because a file changed, or was uploaded or deleted)
+    void clear();
+
+    /// @return the number of bytes of file contents we are holding in RAM
+    size_t getBodyBytes() const { return bodyBytes; }
+
+  private:
+    /// Free the contents of e (if any)
+    void releaseBody(Entry &e);
+
+    /// @return an entry we can reuse, evicting the least recently used if we are full
+    Entry &allocEntry();
+
+    /// Free cached contents (least recently used first) until we have room for len more bytes
+    void makeRoom(size_t len);
+};
+
+extern StaticFileCache staticFileCache;
@@ -172,6 +172,7 @@ int32_t WebServerThread::runOnce()
 {
     // DEBUG_MSG("WebServerThread::runOnce()\n");
     handleWebResponse();
+    webAPI.checkIdle();
 
     // Loop every 5ms.
     return (5);
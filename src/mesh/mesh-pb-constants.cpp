@@ -37,24 +37,34 @@ bool pb_decode_from_bytes(const uint8_t *srcbuf, size_t srcbufsize, const pb_msg
     }
 }
 
-/// Read from an Arduino File
+/// Read from an Arduino File, stream->state must point to a PBFileReader
 bool readcb(pb_istream_t *stream, uint8_t *buf, size_t count)
 {
-    bool status = false;
-    File *file = (File *)stream->state;
-
-    if (buf == NULL) {
-        while (count-- && file->read() != EOF)
-            ;
-        return count == 0;
-    }
+    PBFileReader *reader = (PBFileReader *)stream->state;
+    File *file = (File *)reader->file;
 
-    status = (file->read(buf, count) == (int)count);
+    while (count) {
+        if (reader->pos == reader->len) { // buffer is empty, fetch the next block
+            int n = file->read(reader->buf, sizeof(reader->buf));
+            reader->numReads++;
+            if (n <= 0) {
+                stream->bytes_left = 0;
+                return false;
+            }
+            reader->len = n;
+            reader->pos = 0;
+        }
 
-    if (file->available() == 0)
-        stream->bytes_left = 0;
+        size_t toCopy = min(count, reader->len - reader->pos);
+        if (buf) { // a NULL buf means nanopb just wants us to skip bytes
+            memcpy(buf, reader->buf + reader->pos, toCopy);
+            buf += toCopy;
+        }
+        reader->pos += toCopy;
+        count -= toCopy;
+    }
 
-    return status;
+    return true;
 }
 
 /// Write to an arduino file
@@ -27,7 +27,27 @@ size_t pb_encode_to_bytes(uint8_t *destbuf, size_t destbufsize, const pb_msgdesc
 /// helper function for decoding a record as a protobuf, we will return false if the decoding failed
 bool pb_decode_from_bytes(const uint8_t *srcbuf, size_t srcbufsize, const pb_msgdesc_t *fields, void *dest_struct);
 
-/// Read from an Arduino File
+/// How many bytes we read from flash at a time when decoding protobufs from files
+#define PB_FILE_BLOCK_SIZE 256
+
+/**
+ * Block buffered state for reading a protobuf from an Arduino File, use as the state for a pb_istream_t with readcb.
+ *
+ * nanopb asks for many tiny reads (often a single byte for each tag and varint), which are quite slow if each one goes
+ * all the way down to the filesystem.
+ */
+struct PBFileReader {
+    void *file; // Really a File *, but that type is different for each platform
+    uint8_t buf[PB_FILE_BLOCK_SIZE];
+    size_t len = 0, pos = 0;
+
+    /// How many times we actually read from the filesystem (for profiling)
+    uint32_t numReads = 0;
+
+    PBFileReader(void *_file) : file(_file) {}
+};
+
+/// Read from an Arduino File, stream->state must point to a PBFileReader
 bool readcb(pb_istream_t *stream, uint8_t *buf, size_t count);
 
 /// Write to an arduino file
@@ -0,0 +1,109 @@
+#include "SocketStream.h"
+#include "configuration.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#ifdef PORTDUINO
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#else
+#include <lwip/sockets.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // lwip never raises SIGPIPE
+#endif
+
+SocketStream::SocketStream(int _fd) : fd(_fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    int one = 1; // We do our own coalescing (see flush()), so don't let Nagle delay our frames
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) != 0)
+        DEBUG_MSG("Warning: can't set TCP_NODELAY\n");
+}
+
+void SocketStream::checkError(const char *op)
+{
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        DEBUG_MSG("Socket %s failed, errno=%d, closing\n", op, errno);
+        open = false;
+    }
+}
+
+void SocketStream::fillRx()
+{
+    if (rxPos < rxLen || !open || !mightHaveRx)
+        return;
+
+    ssize_t n = recv(fd, rxBuf, sizeof(rxBuf), MSG_DONTWAIT);
+    if (n > 0) {
+        rxLen = n;
+        rxPos = 0;
+    } else if (n == 0)
+        open = false; // the other side closed the connection
+    else {
+        checkError("recv");
+        if (useRxNotify)
+            mightHaveRx = false; // socket is drained, wait to be told about more
+    }
+}
+
+int SocketStream::available()
+{
+    fillRx();
+    return rxLen - rxPos;
+}
+
+int SocketStream::read()
+{
+    fillRx();
+    return (rxPos < rxLen) ? rxBuf[rxPos++] : -1;
+}
+
+size_t SocketStream::read(uint8_t *buf, size_t len)
+{
+    fillRx();
+    size_t n = rxLen - rxPos;
+    if (n > len)
+        n = len;
+    memcpy(buf, rxBuf + rxPos, n);
+    rxPos += n;
+    return n;
+}
+
+int SocketStream::peek()
+{
+    fillRx();
+    return (rxPos < rxLen) ? rxBuf[rxPos] : -1;
+}
+
+size_t SocketStream::write(const uint8_t *buf, size_t len)
+{
+    if (len > txSpace())
+        flush(); // try to make room
+
+    if (len > txSpace()) {
+        DEBUG_MSG("Warning: TCP client is too slow, dropping %u bytes\n", len);
+        return 0;
+    }
+
+    memcpy(txBuf + txLen, buf, len);
+    txLen += len;
+    return len;
+}
+
+void SocketStream::flush()
+{
+    if (!txLen || !open)
+        return;
+
+    ssize_t n = send(fd, txBuf, txLen, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n > 0) {
+        txLen -= n;
+        memmove(txBuf, txBuf + n, txLen);
+    } else if (n < 0)
+        checkError("send");
+}
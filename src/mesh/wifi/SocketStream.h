@@ -0,0 +1,73 @@
+#pragma once
+
+#include "StreamAPI.h"
+#include <Arduino.h>
+
+/// How many bytes we read from the socket at a time
+#define SOCKET_RX_BUF_SIZE 256
+
+/// How many bytes of outgoing frames we will hold for a slow client (a few full size frames)
+#define SOCKET_TX_BUF_SIZE (4 * MAX_STREAM_BUF_SIZE)
+
+/**
+ * A Stream on top of a TCP socket (either a lwip socket on ESP32 or a regular POSIX socket on Linux), which never blocks.
+ *
+ * Reads are done in blocks.  Writes are only copied into our tx buffer, call flush() to send as much of that buffer as the
+ * socket will currently accept.  Because we turn off Nagle's algorithm (TCP_NODELAY), the caller should do all the writes
+ * it has for this pass and then flush() once - so multiple frames are coalesced into one TCP segment without any added
+ * latency.
+ *
+ * Note: we do not own the socket, the caller must close it.
+ */
+class SocketStream : public Stream
+{
+    int fd;
+
+    /// false once the other side has closed the connection (or we had a socket error)
+    bool open = true;
+
+    /// If our owner tells us when data arrives (i.e. from epoll), we don't need to try a recv() on every call to available()
+    bool useRxNotify = false, mightHaveRx = true;
+
+    uint8_t rxBuf[SOCKET_RX_BUF_SIZE];
+    size_t rxLen = 0, rxPos = 0;
+
+    uint8_t txBuf[SOCKET_TX_BUF_SIZE];
+    size_t txLen = 0;
+
+  public:
+    SocketStream(int _fd);
+
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+
+    /// Copy up to len bytes we have already received into buf (never blocks), @return how many
+    size_t read(uint8_t *buf, size_t len);
+
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t *buf, size_t len);
+
+    /// Send as much of our tx buffer as the socket will take right now
+    virtual void flush();
+
+    /// @return the number of bytes which can be written without dropping data
+    size_t txSpace() const { return sizeof(txBuf) - txLen; }
+
+    /// @return true until the connection has been closed
+    bool isOpen() const { return open; }
+
+    /// Call when the socket becomes readable, after the first call we will only recv() after being notified
+    void notifyReadable()
+    {
+        useRxNotify = true;
+        mightHaveRx = true;
+    }
+
+  private:
+    /// Fill our rx buffer from the socket (if it is empty)
+    void fillRx();
+
+    /// If the last socket call failed for a reason other than 'would block', mark the connection closed
+    void checkError(const char *op);
+};
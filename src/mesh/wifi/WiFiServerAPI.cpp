@@ -3,16 +3,29 @@
 #include "configuration.h"
 #include <Arduino.h>
 
-WiFiServerAPI::WiFiServerAPI(WiFiClient &_client) : StreamAPI(&client), client(_client)
+#ifdef PORTDUINO
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+int WiFiServerAPI::numConnected;
+
+#ifdef PORTDUINO
+WiFiServerAPI::WiFiServerAPI(int _fd) : StreamAPI(&socketStream), fd(_fd), socketStream(_fd)
+#else
+WiFiServerAPI::WiFiServerAPI(WiFiClient &_client)
+    : StreamAPI(&socketStream), client(_client), fd(_client.fd()), socketStream(_client.fd())
+#endif
 {
     DEBUG_MSG("Incoming wifi connection\n");
 }
 
 WiFiServerAPI::~WiFiServerAPI()
 {
-    client.stop();
-
-    // FIXME - delete this if the client dropps the connection!
+    close();
 }
 
 /// Hookable to find out when connection changes
@@ -21,64 +34,152 @@ void WiFiServerAPI::onConnectionChanged(bool connected)
     // FIXME - we really should be doing global reference counting to see if anyone is currently using serial or wifi and if so,
     // block sleep
 
+    // Several TCP clients might be connected, only tell powerFSM when the first one arrives or the last one leaves
     if (connected) { // To prevent user confusion, turn off bluetooth while using the serial port api
-        powerFSM.trigger(EVENT_SERIAL_CONNECTED);
+        if (numConnected++ == 0)
+            powerFSM.trigger(EVENT_SERIAL_CONNECTED);
     } else {
-        powerFSM.trigger(EVENT_SERIAL_DISCONNECTED);
+        if (--numConnected == 0)
+            powerFSM.trigger(EVENT_SERIAL_DISCONNECTED);
     }
 }
 
 /// override close to also shutdown the TCP link
-void WiFiServerAPI::close() {
+void WiFiServerAPI::close()
+{
+    socketStream.flush(); // Try to get out any final frames
+#ifdef PORTDUINO
+    if (fd >= 0) {
+        ::close(fd); // drop tcp connection
+        fd = -1;
+    }
+#else
     client.stop(); // drop tcp connection
+#endif
     StreamAPI::close();
 }
 
 bool WiFiServerAPI::loop()
 {
-    if (client.connected()) {
+    if (socketStream.isOpen()) {
         StreamAPI::loop();
+        socketStream.flush(); // All the frames we just wrote go out together
         return true;
     } else {
-        return false;       
+        return false;
     }
 }
 
 #define MESHTASTIC_PORTNUM 4403
 
+#ifdef PORTDUINO
+WiFiServerPort::WiFiServerPort() : concurrency::OSThread("ApiServer") {}
+#else
 WiFiServerPort::WiFiServerPort() : WiFiServer(MESHTASTIC_PORTNUM), concurrency::OSThread("ApiServer") {}
+#endif
 
 void WiFiServerPort::init()
 {
-    DEBUG_MSG("API server sistening on TCP port %d\n", MESHTASTIC_PORTNUM);
+    DEBUG_MSG("API server listening on TCP port %d\n", MESHTASTIC_PORTNUM);
+#ifdef PORTDUINO
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(MESHTASTIC_PORTNUM);
+
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, MAX_API_CLIENTS) != 0) {
+        DEBUG_MSG("Error: can't listen on TCP port %d, errno=%d\n", MESHTASTIC_PORTNUM, errno);
+        setEnabled(false); // no point in running our thread
+        return;
+    }
+
+    epollFd = epoll_create1(0);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL; // NULL means our listen socket
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+#else
+    setNoDelay(true); // Accepted clients inherit this
     begin();
+#endif
 }
 
-int32_t WiFiServerPort::runOnce()
+void WiFiServerPort::addClient(WiFiServerAPI *api)
+{
+    assert(numOpen < MAX_API_CLIENTS);
+    openAPIs[numOpen++] = api;
+
+#ifdef PORTDUINO
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = api;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, api->getFd(), &ev);
+#endif
+
+    DEBUG_MSG("%d API clients connected\n", numOpen);
+}
+
+void WiFiServerPort::acceptClients()
 {
+#ifdef PORTDUINO
+    int fd;
+    while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+        if (numOpen == MAX_API_CLIENTS) {
+            DEBUG_MSG("Too many API clients, refusing connection\n");
+            ::close(fd);
+        } else
+            addClient(new WiFiServerAPI(fd));
+    }
+#else
     auto client = available();
     if (client) {
-        // Close any previous connection (see FIXME in header file)
-        if (openAPI) {
-            DEBUG_MSG("Force closing previous TCP connection\n");
-            delete openAPI;
-        }
-
-        openAPI = new WiFiServerAPI(client);
+        if (numOpen == MAX_API_CLIENTS) {
+            DEBUG_MSG("Too many API clients, refusing connection\n");
+            client.stop();
+        } else
+            addClient(new WiFiServerAPI(client));
     }
+#endif
+}
 
-    if (openAPI) {
-        // Allow idle processing so the API can read from its incoming stream
-        if(!openAPI->loop()) {
-            // If our API link was up, shut it down
+int32_t WiFiServerPort::runOnce()
+{
+#ifdef PORTDUINO
+    // Find out which sockets have something for us (without blocking, our caller is the main loop)
+    struct epoll_event events[MAX_API_CLIENTS + 1];
+    int numEvents = epoll_wait(epollFd, events, MAX_API_CLIENTS + 1, 0);
+    for (int i = 0; i < numEvents; i++) {
+        WiFiServerAPI *api = (WiFiServerAPI *)events[i].data.ptr;
+        if (api)
+            api->notifyReadable(); // The next read will see the new data (or the hangup)
+        else
+            acceptClients();
+    }
+#else
+    acceptClients();
+#endif
 
+    // Allow idle processing so each API can read from its incoming stream and send any new packets
+    for (size_t i = 0; i < numOpen;) {
+        WiFiServerAPI *api = openAPIs[i];
+        if (!api->loop()) {
             DEBUG_MSG("Client dropped connection, closing API client\n");
-            // Note: we can't call delete here because this object includes other state
-            // besides the stream API.  Instead kill it later when we start a new instance
-            delete openAPI;
-            openAPI = NULL;
-        }
-        return 0; // run fast while our API server is running
-    } else
+            // Note: closing the socket also removes it from our epoll set
+            delete api;
+            openAPIs[i] = openAPIs[--numOpen];
+        } else
+            i++;
+    }
+
+    if (numOpen)
+        return 0; // run fast while our API server has clients
+    else
         return 100; // only check occasionally for incoming connections
-}
\ No newline at end of file
+}
@@ -1,23 +1,57 @@
 #pragma once
 
+#include "SocketStream.h"
 #include "StreamAPI.h"
 #include "concurrency/OSThread.h"
+
+#ifndef PORTDUINO
 #include <WiFi.h>
+#endif
+
+/// The max number of TCP API clients we allow at once
+#ifndef MAX_API_CLIENTS
+#ifdef PORTDUINO
+#define MAX_API_CLIENTS 32 // plenty for load testing with many local clients
+#else
+#define MAX_API_CLIENTS 4 // each client costs about 3KB of RAM
+#endif
+#endif
 
 /**
  * Provides both debug printing and, if the client starts sending protobufs to us, switches to send/receive protobufs
  * (and starts dropping debug printing - FIXME, eventually those prints should be encapsulated in protobufs).
+ *
+ * There is one instance of this class per open TCP connection.
  */
 class WiFiServerAPI : public StreamAPI
 {
   private:
-    WiFiClient client;
+#ifndef PORTDUINO
+    WiFiClient client; // Owns our socket
+#endif
+    int fd;
+
+    SocketStream socketStream;
+
+    /// How many WiFiServerAPIs currently have a connected client (so we only tell powerFSM about the first and last)
+    static int numConnected;
 
   public:
+#ifdef PORTDUINO
+    /// We take ownership of the (already accepted) socket fd
+    WiFiServerAPI(int _fd);
+#else
     WiFiServerAPI(WiFiClient &_client);
+#endif
 
     virtual ~WiFiServerAPI();
 
+    /// @return the socket for this connection
+    int getFd() const { return fd; }
+
+    /// Our listener saw that there is data waiting for us to read
+    void notifyReadable() { socketStream.notifyReadable(); }
+
     /// @return true if we want to keep running, or false if we are ready to be destroyed
     virtual bool loop(); // Check for dropped client connections
 
@@ -27,19 +61,33 @@ class WiFiServerAPI : public StreamAPI
   protected:
     /// Hookable to find out when connection changes
     virtual void onConnectionChanged(bool connected);
+
+    /// Don't generate more frames than our socket buffer can hold (StreamAPI writes a full batch at a time)
+    virtual bool canWriteFrame() { return socketStream.txSpace() >= STREAM_TX_BATCH_SIZE; }
+
+    /// Copy straight out of the socket's rx buffer
+    virtual size_t readAvailable(uint8_t *buf, size_t len) { return socketStream.read(buf, len); }
 };
 
 /**
- * Listens for incoming connections and does accepts and creates instances of WiFiServerAPI as needed
+ * Listens for incoming connections and does accepts and creates instances of WiFiServerAPI as needed.
+ *
+ * Up to MAX_API_CLIENTS connections can be open at once, each with its own WiFiServerAPI.  On Linux we use epoll so that we
+ * only wake up when there is something to do, on ESP32 we poll the WiFiServer.
  */
+#ifdef PORTDUINO
+class WiFiServerPort : private concurrency::OSThread
+#else
 class WiFiServerPort : public WiFiServer, private concurrency::OSThread
+#endif
 {
-    /** The currently open port
-     *
-     * FIXME: We currently only allow one open TCP connection at a time, because we depend on the loop() call in this class to
-     * delegate to the worker.  Once coroutines are implemented we can relax this restriction.
-     */
-    WiFiServerAPI *openAPI = NULL;
+    /// The currently open connections (the first numOpen entries are valid)
+    WiFiServerAPI *openAPIs[MAX_API_CLIENTS];
+    size_t numOpen = 0;
+
+#ifdef PORTDUINO
+    int listenFd = -1, epollFd = -1;
+#endif
 
   public:
     WiFiServerPort();
@@ -47,4 +95,11 @@ class WiFiServerPort : public WiFiServer, private concurrency::OSThread
     void init();
 
     int32_t runOnce();
+
+  private:
+    /// Start running the API for a newly accepted connection
+    void addClient(WiFiServerAPI *api);
+
+    /// Check for new connections and add them (closing them if we already have too many)
+    void acceptClients();
 };
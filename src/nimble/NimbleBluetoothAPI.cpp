@@ -7,7 +7,8 @@
 
 // This scratch buffer is used for various bluetooth reads/writes - but it is safe because only one bt operation can be in
 // proccess at once
-static uint8_t trBytes[FromRadio_size < ToRadio_size ? ToRadio_size : FromRadio_size];
+// Big enough for a batch of FromRadios/ToRadios (see PhoneAPI::getFromRadioBatch)
+static uint8_t trBytes[MAX_TO_FROM_RADIO_SIZE];
 static uint32_t fromNum;
 
 uint16_t fromNumValHandle;
@@ -49,7 +50,8 @@ int toradio_callback(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt
 
 int fromradio_callback(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
-    size_t numBytes = bluetoothPhoneAPI->getFromRadio(trBytes);
+    // If the client asked for batching, fill one ATT read (so it doesn't need a long read)
+    size_t numBytes = bluetoothPhoneAPI->getFromRadioBatch(trBytes, ble_att_mtu(conn_handle) - 1);
 
     DEBUG_MSG("BLE fromRadio called omlen=%d, ourlen=%d\n", OS_MBUF_PKTLEN(ctxt->om),
               numBytes); // the normal case has omlen 1 here
@@ -10,6 +10,9 @@ class BluetoothPhoneAPI : public PhoneAPI
      * Subclasses can use this as a hook to provide custom notifications for their transport (i.e. bluetooth notifies)
      */
     virtual void onNowHasData(uint32_t fromRadioNum);
+
+    /// We read with getFromRadioBatch()
+    virtual bool supportsBatching() { return true; }
 };
 
 extern PhoneAPI *bluetoothPhoneAPI;
\ No newline at end of file
@@ -18,8 +18,8 @@ static BLEDfu bledfu; // DFU software update helper service
 // This scratch buffer is used for various bluetooth reads/writes - but it is safe because only one bt operation can be in
 // proccess at once
 // static uint8_t trBytes[_max(_max(_max(_max(ToRadio_size, RadioConfig_size), User_size), MyNodeInfo_size), FromRadio_size)];
-static uint8_t fromRadioBytes[FromRadio_size];
-static uint8_t toRadioBytes[ToRadio_size];
+static uint8_t fromRadioBytes[MAX_TO_FROM_RADIO_SIZE]; // Big enough for a batch (see PhoneAPI::getFromRadioBatch)
+static uint8_t toRadioBytes[MAX_TO_FROM_RADIO_SIZE];
 
 class BluetoothPhoneAPI : public PhoneAPI
 {
@@ -33,6 +33,9 @@ class BluetoothPhoneAPI : public PhoneAPI
         DEBUG_MSG("BLE notify fromNum\n");
         fromNum.notify32(fromRadioNum);
     }
+
+    /// We read with getFromRadioBatch()
+    virtual bool supportsBatching() { return true; }
 };
 
 static BluetoothPhoneAPI *bluetoothPhoneAPI;
@@ -121,7 +124,8 @@ void fromRadioAuthorizeCb(uint16_t conn_hdl, BLECharacteristic *chr, ble_gatts_e
     if (request->offset == 0) {
         // If the read is long, we will get multiple authorize invocations - we only populate data on the first
 
-        size_t numBytes = bluetoothPhoneAPI->getFromRadio(fromRadioBytes);
+        // If the client asked for batching, fill one ATT read (so it doesn't need a long read)
+        size_t numBytes = bluetoothPhoneAPI->getFromRadioBatch(fromRadioBytes, Bluefruit.Connection(conn_hdl)->getMtu() - 1);
 
         // DEBUG_MSG("fromRadioAuthorizeCb numBytes=%u\n", numBytes);
         // if (numBytes >= 2) DEBUG_MSG("fromRadio bytes %x %x\n", fromRadioBytes[0], fromRadioBytes[1]);
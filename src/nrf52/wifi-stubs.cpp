@@ -5,7 +5,22 @@
 
 //#include "mesh/wifi/WiFiAPClient.h"
 
-void initWifi(bool forceSoftAP) {}
+#ifdef PORTDUINO
+#include "mesh/wifi/WiFiServerAPI.h"
+
+static WiFiServerPort *apiPort;
+#endif
+
+/// We don't have wifi to bring up, but on Linux we do want our TCP API server
+void initWifi(bool forceSoftAP)
+{
+#ifdef PORTDUINO
+    if (!apiPort) {
+        apiPort = new WiFiServerPort();
+        apiPort->init();
+    }
+#endif
+}
 
 void deinitWifi() {}
 
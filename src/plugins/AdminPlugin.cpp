@@ -1,10 +1,15 @@
 #include "AdminPlugin.h"
 #include "Channels.h"
 #include "MeshService.h"
+#include "Metrics.h"
 #include "NodeDB.h"
 #include "Router.h"
 #include "configuration.h"
 #include "main.h"
+#include <pb_encode.h>
+
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
 
 AdminPlugin *adminPlugin;
 
@@ -35,6 +40,121 @@ void AdminPlugin::handleGetRadio(const MeshPacket &req)
     }
 }
 
+void AdminPlugin::handleGetPluginStats(const MeshPacket &req, uint32_t firstIndex)
+{
+    if (req.decoded.want_response) {
+        // We have more plugins than fit in one packet, so clients page through them using firstIndex
+        auto &plugins = MeshPlugin::getPlugins();
+        AdminMessage r = AdminMessage_init_default;
+        PluginStatsList &l = r.get_plugin_stats_response;
+        l.first_index = firstIndex;
+        l.num_plugins = plugins.size();
+
+        const size_t maxStats = sizeof(l.stats) / sizeof(l.stats[0]);
+        for (size_t i = firstIndex; i < plugins.size() && l.stats_count < maxStats; i++) {
+            auto p = plugins[i];
+            PluginStats &s = l.stats[l.stats_count++];
+            strncpy(s.name, p->getName(), sizeof(s.name) - 1);
+            s.calls = p->stats.calls;
+            s.handled = p->stats.handled;
+            s.total_usec = p->stats.totalUsec;
+            s.max_usec = p->stats.maxUsec;
+            s.bytes = p->stats.bytes;
+            s.replies = p->stats.replies;
+        }
+
+        r.which_variant = AdminMessage_get_plugin_stats_response_tag;
+        reply = allocDataProtobuf(r);
+    }
+}
+
+void AdminPlugin::handleGetThreadStats(const MeshPacket &req, uint32_t firstIndex)
+{
+    if (req.decoded.want_response) {
+        // Like plugin stats, clients page through our threads using firstIndex
+        auto &threads = concurrency::mainController.getThreads();
+        AdminMessage r = AdminMessage_init_default;
+        ThreadStatsList &l = r.get_thread_stats_response;
+        l.first_index = firstIndex;
+        l.num_threads = threads.size();
+        l.wakeups_last_hour = concurrency::mainController.wakeupsLastHour;
+
+        const size_t maxStats = sizeof(l.stats) / sizeof(l.stats[0]);
+        for (size_t i = firstIndex; i < threads.size() && l.stats_count < maxStats; i++) {
+            auto t = threads[i];
+            ThreadStats &s = l.stats[l.stats_count++];
+            strncpy(s.name, t->ThreadName.c_str(), sizeof(s.name) - 1);
+            s.runs = t->threadStats.runs;
+            s.total_usec = t->threadStats.totalUsec;
+            s.max_usec = t->threadStats.maxUsec;
+            s.missed = t->threadStats.missed;
+            s.max_late_msec = t->threadStats.maxLateMsec;
+            s.wakeups = t->threadStats.wakeups;
+            s.stack_free = t->threadStats.stackFree;
+        }
+
+        r.which_variant = AdminMessage_get_thread_stats_response_tag;
+        reply = allocDataProtobuf(r);
+    }
+}
+
+/// Fill in v from m
+static void snapshotMetric(const Metric *m, MetricValue &v)
+{
+    strncpy(v.name, m->name, sizeof(v.name) - 1);
+    v.type = m->type;
+    switch (m->type) {
+    case METRIC_COUNTER:
+        v.value = static_cast<const Counter *>(m)->get();
+        break;
+    case METRIC_GAUGE:
+        v.value = static_cast<const Gauge *>(m)->get();
+        break;
+    case METRIC_HISTOGRAM: {
+        auto h = static_cast<const Histogram *>(m);
+        v.value = h->getCount();
+        v.sum = h->getSum();
+        v.bounds_count = h->getNumBounds();
+        memcpy(v.bounds, h->getBounds(), v.bounds_count * sizeof(v.bounds[0]));
+        v.counts_count = v.bounds_count + 1;
+        h->getCounts(v.counts);
+        break;
+    }
+    }
+}
+
+void AdminPlugin::handleGetMetrics(const MeshPacket &req, uint32_t firstIndex)
+{
+    if (req.decoded.want_response) {
+        // Like plugin stats, clients page through our metrics registry using firstIndex.  Histograms are much bigger than
+        // other metrics, so we add metrics until the reply would no longer fit in a packet.
+        AdminMessage r = AdminMessage_init_default;
+        r.which_variant = AdminMessage_get_metrics_response_tag;
+        MetricList &l = r.get_metrics_response;
+        l.first_index = firstIndex;
+        l.num_metrics = Metric::count();
+
+        const Metric *m = Metric::getFirst();
+        for (uint32_t i = 0; m && i < firstIndex; i++)
+            m = m->getNext();
+
+        const size_t maxMetrics = sizeof(l.metrics) / sizeof(l.metrics[0]);
+        for (; m && l.metrics_count < maxMetrics; m = m->getNext()) {
+            MetricValue &v = l.metrics[l.metrics_count++];
+            snapshotMetric(m, v);
+
+            size_t size;
+            if (l.metrics_count > 1 && (!pb_get_encoded_size(&size, AdminMessage_fields, &r) ||
+                                        size > sizeof(((Data *)0)->payload.bytes))) {
+                l.metrics_count--; // That one will have to go in the next reply
+                break;
+            }
+        }
+
+        reply = allocDataProtobuf(r);
+    }
+}
+
 bool AdminPlugin::handleReceivedProtobuf(const MeshPacket &mp, const AdminMessage *r)
 {
     assert(r);
@@ -64,6 +184,21 @@ bool AdminPlugin::handleReceivedProtobuf(const MeshPacket &mp, const AdminMessag
         handleGetRadio(mp);
         break;
 
+    case AdminMessage_get_plugin_stats_request_tag:
+        DEBUG_MSG("Client is getting plugin stats from %d\n", r->get_plugin_stats_request);
+        handleGetPluginStats(mp, r->get_plugin_stats_request);
+        break;
+
+    case AdminMessage_get_thread_stats_request_tag:
+        DEBUG_MSG("Client is getting thread stats from %d\n", r->get_thread_stats_request);
+        handleGetThreadStats(mp, r->get_thread_stats_request);
+        break;
+
+    case AdminMessage_get_metrics_request_tag:
+        DEBUG_MSG("Client is getting metrics from %d\n", r->get_metrics_request);
+        handleGetMetrics(mp, r->get_metrics_request);
+        break;
+
     default:
         break;
     }
@@ -32,6 +32,9 @@ class AdminPlugin : public ProtobufPlugin<AdminMessage>
 
     void handleGetChannel(const MeshPacket &req, uint32_t channelIndex);
     void handleGetRadio(const MeshPacket &req);
+    void handleGetPluginStats(const MeshPacket &req, uint32_t firstIndex);
+    void handleGetThreadStats(const MeshPacket &req, uint32_t firstIndex);
+    void handleGetMetrics(const MeshPacket &req, uint32_t firstIndex);
 };
 
 extern AdminPlugin *adminPlugin;
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include "configuration.h"
 #include <Arduino.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 //#include <assert.h>
 
 /*
@@ -6,6 +6,9 @@
 #include "configuration.h"
 #include "main.h"
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 NodeInfoPlugin *nodeInfoPlugin;
 
 bool NodeInfoPlugin::handleReceivedProtobuf(const MeshPacket &mp, const User *pptr)
@@ -52,6 +55,7 @@ NodeInfoPlugin::NodeInfoPlugin()
     : ProtobufPlugin("nodeinfo", PortNum_NODEINFO_APP, User_fields), concurrency::OSThread("NodeInfoPlugin")
 {
     isPromiscuous = true; // We always want to update our nodedb, even if we are sniffing on others
+    priority = concurrency::THREAD_PRIORITY_BACKGROUND; // Our periodic broadcasts can wait for more urgent work
     setIntervalFromNow(30 *
                        1000); // Send our initial owner announcement 30 seconds after we start (to give network time to setup)
 }
@@ -28,7 +28,7 @@ void setupPlugins()
     // Note: if the rest of meshtastic doesn't need to explicitly use your plugin, you do not need to assign the instance
     // to a global variable.
 
-    new RemoteHardwarePlugin();
+    remoteHardwarePlugin = new RemoteHardwarePlugin();
     new ReplyPlugin();
 
 #ifndef NO_ESP32
@@ -37,7 +37,7 @@ void setupPlugins()
     /*
         Maintained by MC Hamster (Jm Casler) jm@casler.org
     */
-    new SerialPlugin();
+    serialPlugin = new SerialPlugin();
     new ExternalNotificationPlugin();
 
     // rangeTestPlugin = new RangeTestPlugin();
@@ -5,12 +5,16 @@
 #include "Router.h"
 #include "configuration.h"
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 PositionPlugin *positionPlugin;
 
 PositionPlugin::PositionPlugin()
     : ProtobufPlugin("position", PortNum_POSITION_APP, Position_fields), concurrency::OSThread("PositionPlugin")
 {
     isPromiscuous = true; // We always want to update our nodedb, even if we are sniffing on others
+    priority = concurrency::THREAD_PRIORITY_BACKGROUND; // Our periodic broadcasts can wait for more urgent work
     setIntervalFromNow(60 *
                        1000); // Send our initial position 60 seconds after we start (to give GPS time to setup)
 
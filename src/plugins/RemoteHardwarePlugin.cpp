@@ -3,8 +3,13 @@
 #include "NodeDB.h"
 #include "RTC.h"
 #include "Router.h"
+#include "SerialPlugin.h"
 #include "configuration.h"
 #include "main.h"
+#include <RadioLib.h> // some of our radio pins are RADIOLIB_NC
+
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
 
 #define NUM_GPIOS 64
 
@@ -14,10 +19,16 @@
 // a max of one change per 30 seconds
 #define WATCH_INTERVAL_MSEC (30 * 1000)
 
+// We are woken by pin change interrupts, but also read our watched pins this often in case a pin can't interrupt (some
+// platforms have a limited number of interrupt channels)
+#define WATCH_POLL_MSEC (60 * 1000)
+
+RemoteHardwarePlugin *remoteHardwarePlugin;
+
 /// Set pin modes for every set bit in a mask
 static void pinModes(uint64_t mask, uint8_t mode) {
     for (uint8_t i = 0; i < NUM_GPIOS; i++) {
-        if (mask & (1 << i)) {
+        if (mask & ((uint64_t)1 << i)) {
             pinMode(i, mode);
         }
     }
@@ -30,7 +41,7 @@ static uint64_t digitalReads(uint64_t mask) {
     pinModes(mask, INPUT_PULLUP);
 
     for (uint8_t i = 0; i < NUM_GPIOS; i++) {
-        uint64_t m = 1 << i;
+        uint64_t m = (uint64_t)1 << i;
         if (mask & m) {
             if (digitalRead(i))
                 res |= m;
@@ -40,6 +51,106 @@ static uint64_t digitalReads(uint64_t mask) {
     return res;
 }
 
+/// Add a pin to a mask (unless it is not connected)
+static void addPin(uint64_t &mask, int pin)
+{
+    if (pin >= 0 && pin < NUM_GPIOS)
+        mask |= (uint64_t)1 << pin;
+}
+
+/**
+ * The pins the firmware itself uses (the radio, buttons, GPS, I2C and so on).  Remote nodes may not touch these: changing their
+ * pin modes, or attaching our interrupt to them, would take them away from the drivers which own them.
+ */
+static uint64_t firmwarePins()
+{
+    uint64_t mask = 0;
+#ifdef RF95_NSS
+    addPin(mask, RF95_NSS);
+#endif
+#ifdef RF95_IRQ
+    addPin(mask, RF95_IRQ);
+#endif
+#ifdef RF95_RESET
+    addPin(mask, RF95_RESET);
+#endif
+#ifdef RF95_SCK
+    addPin(mask, RF95_SCK);
+#endif
+#ifdef RF95_MISO
+    addPin(mask, RF95_MISO);
+#endif
+#ifdef RF95_MOSI
+    addPin(mask, RF95_MOSI);
+#endif
+#ifdef LORA_DIO0
+    addPin(mask, LORA_DIO0);
+#endif
+#ifdef LORA_DIO1
+    addPin(mask, LORA_DIO1);
+#endif
+#ifdef LORA_DIO2
+    addPin(mask, LORA_DIO2);
+#endif
+#ifdef LORA_RESET
+    addPin(mask, LORA_RESET);
+#endif
+#ifdef SX1262_CS
+    addPin(mask, SX1262_CS);
+#endif
+#ifdef SX1262_DIO1
+    addPin(mask, SX1262_DIO1);
+#endif
+#ifdef SX1262_BUSY
+    addPin(mask, SX1262_BUSY);
+#endif
+#ifdef SX1262_RESET
+    addPin(mask, SX1262_RESET);
+#endif
+#ifdef SX1262_TXEN
+    addPin(mask, SX1262_TXEN);
+#endif
+#ifdef SX1262_RXEN
+    addPin(mask, SX1262_RXEN);
+#endif
+#ifdef BUTTON_PIN
+    addPin(mask, BUTTON_PIN);
+#endif
+#ifdef BUTTON_PIN_ALT
+    addPin(mask, BUTTON_PIN_ALT);
+#endif
+#ifdef GPS_RX_PIN
+    addPin(mask, GPS_RX_PIN);
+#endif
+#ifdef GPS_TX_PIN
+    addPin(mask, GPS_TX_PIN);
+#endif
+#ifdef I2C_SDA
+    addPin(mask, I2C_SDA);
+#endif
+#ifdef I2C_SCL
+    addPin(mask, I2C_SCL);
+#endif
+#ifdef LED_PIN
+    addPin(mask, LED_PIN);
+#endif
+#ifdef PMU_IRQ
+    addPin(mask, PMU_IRQ);
+#endif
+#ifdef BATTERY_PIN
+    addPin(mask, BATTERY_PIN);
+#endif
+    if (radioConfig.preferences.serialplugin_enabled) {
+        if (radioConfig.preferences.serialplugin_rxd && radioConfig.preferences.serialplugin_txd) {
+            addPin(mask, radioConfig.preferences.serialplugin_rxd);
+            addPin(mask, radioConfig.preferences.serialplugin_txd);
+        } else {
+            addPin(mask, RXD2);
+            addPin(mask, TXD2);
+        }
+    }
+    return mask;
+}
 
 RemoteHardwarePlugin::RemoteHardwarePlugin()
     : ProtobufPlugin("remotehardware", PortNum_REMOTE_HARDWARE_APP, HardwareMessage_fields),
@@ -47,11 +158,37 @@ RemoteHardwarePlugin::RemoteHardwarePlugin()
 {
 }
 
+IRAM_ATTR void RemoteHardwarePlugin::onWatchedPinChange()
+{
+    BaseType_t higherWake = 0;
+    remoteHardwarePlugin->wakeFromISR(&higherWake);
+}
+
+void RemoteHardwarePlugin::attachWatchInterrupts(uint64_t mask)
+{
+    for (uint8_t i = 0; i < NUM_GPIOS; i++)
+        if (mask & ((uint64_t)1 << i))
+            attachInterrupt(i, onWatchedPinChange, CHANGE);
+}
+
+void RemoteHardwarePlugin::detachWatchInterrupts(uint64_t mask)
+{
+    for (uint8_t i = 0; i < NUM_GPIOS; i++)
+        if (mask & ((uint64_t)1 << i))
+            detachInterrupt(i);
+}
+
 bool RemoteHardwarePlugin::handleReceivedProtobuf(const MeshPacket &req, const HardwareMessage *pptr)
 {
     auto p = *pptr;
     DEBUG_MSG("Received RemoteHardware typ=%d\n", p.typ);
 
+    uint64_t refused = p.gpio_mask & firmwarePins();
+    if (refused) {
+        DEBUG_MSG("Refusing to touch GPIOs 0x%llx, the firmware uses them\n", refused);
+        p.gpio_mask &= ~refused;
+    }
+
     switch (p.typ) {
     case HardwareMessage_Type_WRITE_GPIOS:
         // Print notification to LCD screen
@@ -84,10 +221,12 @@ bool RemoteHardwarePlugin::handleReceivedProtobuf(const MeshPacket &req, const H
     }
 
     case HardwareMessage_Type_WATCH_GPIOS: {
+        detachWatchInterrupts(watchGpios & ~p.gpio_mask);
         watchGpios = p.gpio_mask;
         lastWatchMsec = 0; // Force a new publish soon
         previousWatch = ~watchGpios; // generate a 'previous' value which is guaranteed to not match (to force an initial publish)
-        enabled = true; // Let our thread run at least once
+        setEnabled(true); // Let our thread run at least once
+        setIntervalFromNow(0);
         DEBUG_MSG("Now watching GPIOs 0x%llx\n", watchGpios);
         break;
     }
@@ -108,26 +247,35 @@ int32_t RemoteHardwarePlugin::runOnce() {
     if(watchGpios) {
         uint32_t now = millis();
 
-        if(now - lastWatchMsec >= WATCH_INTERVAL_MSEC) {
-            uint64_t curVal = digitalReads(watchGpios);
+        uint32_t sinceLastWatch = now - lastWatchMsec;
+        if(sinceLastWatch < WATCH_INTERVAL_MSEC) {
+            // Something might have changed, but we are throttled - look again once we are allowed to send
+            return WATCH_INTERVAL_MSEC - sinceLastWatch;
+        }
+
+        uint64_t curVal = digitalReads(watchGpios);
 
-            if(curVal != previousWatch) {
-                previousWatch = curVal;
-                DEBUG_MSG("Broadcasting GPIOS 0x%llx changed!\n", curVal);
+        if(curVal != previousWatch) {
+            previousWatch = curVal;
+            lastWatchMsec = now;
+            DEBUG_MSG("Broadcasting GPIOS 0x%llx changed!\n", curVal);
 
-                // Something changed!  Tell the world with a broadcast message
-                HardwareMessage reply = HardwareMessage_init_default;
-                reply.typ = HardwareMessage_Type_GPIOS_CHANGED;
-                reply.gpio_value = curVal;
-                MeshPacket *p = allocDataProtobuf(reply);
-                service.sendToMesh(p);
-            }
+            // Something changed!  Tell the world with a broadcast message
+            HardwareMessage reply = HardwareMessage_init_default;
+            reply.typ = HardwareMessage_Type_GPIOS_CHANGED;
+            reply.gpio_value = curVal;
+            MeshPacket *p = allocDataProtobuf(reply);
+            service.sendToMesh(p);
         }
+
+        // Reading the pins sets their pin modes, which (on some platforms) forgets their interrupts
+        attachWatchInterrupts(watchGpios);
+        return WATCH_POLL_MSEC;
     }
     else {
         // No longer watching anything - stop using CPU
-        enabled = false;
+        setEnabled(false);
     }
 
-    return 200; // Poll our GPIOs every 200ms (FIXME, make adjustable via protobuf arg)
+    return WATCH_POLL_MSEC;
 }
\ No newline at end of file
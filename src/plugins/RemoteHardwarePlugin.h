@@ -38,6 +38,14 @@ class RemoteHardwarePlugin : public ProtobufPlugin<HardwareMessage>, private con
      * Returns desired period for next invocation (or RUN_SAME for no change)
      */
     virtual int32_t runOnce();
+
+  private:
+    /// Interrupt handler for our watched pins, so we only run when one of them changes
+    static void onWatchedPinChange();
+
+    /// Start (or stop) getting interrupts when our watched pins change
+    void attachWatchInterrupts(uint64_t mask);
+    void detachWatchInterrupts(uint64_t mask);
 };
 
-extern RemoteHardwarePlugin remoteHardwarePlugin;
\ No newline at end of file
+extern RemoteHardwarePlugin *remoteHardwarePlugin;
\ No newline at end of file
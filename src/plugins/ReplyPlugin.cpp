@@ -5,6 +5,9 @@
 
 #include <assert.h>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 MeshPacket *ReplyPlugin::allocReply()
 {
     assert(currentRequest); // should always be !NULL
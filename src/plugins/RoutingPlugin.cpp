@@ -5,6 +5,9 @@
 #include "configuration.h"
 #include "main.h"
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 RoutingPlugin *routingPlugin;
 
 bool RoutingPlugin::handleReceivedProtobuf(const MeshPacket &mp, const Routing *r)
@@ -28,6 +28,8 @@ class RoutingPlugin : public ProtobufPlugin<Routing>
     /// Override wantPacket to say we want to see all packets, not just those for our port number
     virtual bool wantPacket(const MeshPacket *p) { return true; }
 
+    virtual int getPortNum() { return PORTNUM_ANY; }
+
     void sendAckNak(Routing_Error err, NodeNum to, PacketId idFrom);
 };
 
@@ -8,6 +8,13 @@
 
 #include <assert.h>
 
+#ifndef NO_ESP32
+#include <soc/gpio_struct.h>
+#endif
+
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 /*
     SerialPlugin
         A simple interface to send messages over the mesh network by sending strings
@@ -46,21 +53,40 @@
 
 */
 
-#define RXD2 16
-#define TXD2 17
 #define SERIALPLUGIN_RX_BUFFER 128
 #define SERIALPLUGIN_STRING_MAX Constants_DATA_PAYLOAD_LEN
 #define SERIALPLUGIN_TIMEOUT 250
 #define SERIALPLUGIN_BAUD 38400
 #define SERIALPLUGIN_ACK 1
+#define SERIALPLUGIN_POLL_MSECS 50     // How often we still look for characters while the port is busy
+#define SERIALPLUGIN_ACTIVE_MSECS 2000 // How long after the last character the port counts as busy
 
 SerialPlugin *serialPlugin;
 SerialPluginRadio *serialPluginRadio;
 
+volatile uint32_t SerialPlugin::lastRxActivity;
+int SerialPlugin::rxPin;
+volatile bool SerialPlugin::rxEdgeEnabled;
+
 SerialPlugin::SerialPlugin() : concurrency::OSThread("SerialPlugin") {}
 
 char serialStringChar[Constants_DATA_PAYLOAD_LEN];
 
+IRAM_ATTR void SerialPlugin::onRxEdge()
+{
+    lastRxActivity = millis();
+
+    // Every bit of every character is another falling edge, and we only need the first: turn our pin's interrupt off (as
+    // detachInterrupt() would, but that isn't safe in an ISR) until runOnce() sees the port go quiet
+#ifndef NO_ESP32
+    GPIO.pin[rxPin].int_ena = 0;
+#endif
+    rxEdgeEnabled = false;
+
+    BaseType_t higherWake = 0;
+    serialPlugin->wakeFromISR(&higherWake);
+}
+
 int32_t SerialPlugin::runOnce()
 {
 #ifndef NO_ESP32
@@ -83,7 +109,9 @@ int32_t SerialPlugin::runOnce()
             // Interface with the serial peripheral from in here.
             DEBUG_MSG("Initializing serial peripheral interface\n");
 
+            rxPin = RXD2;
             if (radioConfig.preferences.serialplugin_rxd && radioConfig.preferences.serialplugin_txd) {
+                rxPin = radioConfig.preferences.serialplugin_rxd;
                 Serial2.begin(SERIALPLUGIN_BAUD, SERIAL_8N1, radioConfig.preferences.serialplugin_rxd,
                               radioConfig.preferences.serialplugin_txd);
 
@@ -91,6 +119,10 @@ int32_t SerialPlugin::runOnce()
                 Serial2.begin(SERIALPLUGIN_BAUD, SERIAL_8N1, RXD2, TXD2);
             }
 
+            // Rather than polling, we run when a start bit arrives (the UART keeps receiving the pin as usual)
+            rxEdgeEnabled = true;
+            attachInterrupt(rxPin, onRxEdge, FALLING);
+
             if (radioConfig.preferences.serialplugin_timeout) {
                 Serial2.setTimeout(
                     radioConfig.preferences.serialplugin_timeout); // Number of MS to wait to set the timeout for the string.
@@ -115,10 +147,20 @@ int32_t SerialPlugin::runOnce()
                 serialPluginRadio->sendPayload();
 
                 DEBUG_MSG("Received: %s\n", serialStringChar);
+                lastRxActivity = millis();
             }
         }
 
-        return (10);
+        // onRxEdge wakes us when a new burst starts, but that can be before the UART has the bytes for us - so while the port
+        // is busy we poll (with the interrupt off), and only wait on the interrupt again once it has gone quiet
+        if (millis() - lastRxActivity < SERIALPLUGIN_ACTIVE_MSECS)
+            return SERIALPLUGIN_POLL_MSECS;
+
+        if (!rxEdgeEnabled) {
+            rxEdgeEnabled = true;
+            attachInterrupt(rxPin, onRxEdge, FALLING);
+        }
+        return INT32_MAX;
     } else {
         DEBUG_MSG("Serial Plugin Disabled\n");
 
@@ -6,15 +6,31 @@
 #include <Arduino.h>
 #include <functional>
 
+/// The pins we use if serialplugin_rxd and serialplugin_txd aren't set
+#define RXD2 16
+#define TXD2 17
+
 class SerialPlugin : private concurrency::OSThread
 {
     bool firstTime = 1;
 
+    /// millis() when we last saw an RX edge or read characters, so we keep polling for a while after (the edge can wake us
+    /// before the UART has put the bytes where we can read them)
+    static volatile uint32_t lastRxActivity;
+
+    /// The pin we receive on, and whether its interrupt is on (onRxEdge turns it off, we turn it back on once the port is quiet)
+    static int rxPin;
+    static volatile bool rxEdgeEnabled;
+
   public:
     SerialPlugin();
 
   protected:
     virtual int32_t runOnce();
+
+  private:
+    /// Interrupt handler for our RX pin, so we only run when characters arrive
+    static void onRxEdge();
 };
 
 extern SerialPlugin *serialPlugin;
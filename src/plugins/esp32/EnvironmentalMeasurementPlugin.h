@@ -10,6 +10,7 @@ class EnvironmentalMeasurementPlugin : private concurrency::OSThread, public Pro
   public:
     EnvironmentalMeasurementPlugin(): concurrency::OSThread("EnvironmentalMeasurementPlugin"), ProtobufPlugin("EnvironmentalMeasurement", PortNum_ENVIRONMENTAL_MEASUREMENT_APP, &EnvironmentalMeasurement_msg) { 
       lastMeasurementPacket = nullptr;
+      priority = concurrency::THREAD_PRIORITY_BACKGROUND;
     }
     virtual bool wantUIFrame();
     virtual void drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state, int16_t x, int16_t y);
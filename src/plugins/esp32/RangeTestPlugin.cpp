@@ -7,6 +7,10 @@
 #include "configuration.h"
 #include <Arduino.h>
 #include <SPIFFS.h>
+
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 //#include <assert.h>
 
 /*
@@ -8,6 +8,9 @@
 #include <Arduino.h>
 #include <map>
 
+#undef DEBUG_LEVEL_FILE
+#define DEBUG_LEVEL_FILE DEBUG_LEVEL_PLUGINS
+
 #define STOREFORWARD_MAX_PACKETS 7500
 #define STOREFORWARD_SEND_HISTORY_SHORT 600
 
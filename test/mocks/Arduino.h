@@ -0,0 +1,23 @@
+#pragma once
+
+// Host stand-in for Arduino.h, with just what the code under test uses
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+using std::max;
+using std::min;
+
+/// The time millis() returns, which tests set as they like
+inline uint32_t &mockMillis()
+{
+    static uint32_t now;
+    return now;
+}
+
+inline uint32_t millis()
+{
+    return mockMillis();
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for the Arduino FS library, our files are in the RAM filesystem in SPIFFS.h
+
+#include "SPIFFS.h"
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for src/FSCommon.h, our filesystem is the RAM one in SPIFFS.h
+
+#include "SPIFFS.h"
+#include "configuration.h"
+
+#define FS SPIFFS
+#define FSBegin() true
+#define FILE_O_WRITE "w"
+#define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
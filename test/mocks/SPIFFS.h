@@ -0,0 +1,104 @@
+#pragma once
+
+// Host stand-in for the ESP32 SPIFFS library: a filesystem in RAM, which counts how often it was asked to touch flash
+
+#include <map>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+class File
+{
+    std::string *contents = NULL;
+    size_t pos = 0;
+
+  public:
+    File() {}
+    File(std::string *_contents, size_t _pos) : contents(_contents), pos(_pos) {}
+
+    explicit operator bool() const { return contents != NULL; }
+
+    size_t size() const { return contents ? contents->size() : 0; }
+
+    int read(uint8_t *buf, size_t len);
+
+    size_t write(const uint8_t *buf, size_t len);
+
+    void close() { contents = NULL; }
+};
+
+class MockFS
+{
+  public:
+    /// path to contents
+    std::map<std::string, std::string> files;
+
+    /// Calls which would have gone to flash, and the bytes read from and written to it
+    uint32_t numExists = 0, numOpens = 0, numWrites = 0;
+    uint32_t bytesRead = 0, bytesWritten = 0;
+
+    bool exists(const char *path)
+    {
+        numExists++;
+        return files.count(path) != 0;
+    }
+
+    /// Open path for reading ("r"), writing from scratch ("w") or appending ("a")
+    File open(const char *path, const char *mode = "r")
+    {
+        numOpens++;
+        if (mode[0] == 'w')
+            files[path].clear();
+        else if (mode[0] == 'a')
+            files[path]; // create it if need be
+
+        auto f = files.find(path);
+        if (f == files.end())
+            return File();
+        return File(&f->second, mode[0] == 'a' ? f->second.size() : 0);
+    }
+
+    bool remove(const char *path) { return files.erase(path) != 0; }
+
+    bool rename(const char *from, const char *to)
+    {
+        auto f = files.find(from);
+        if (f == files.end())
+            return false;
+        files[to] = f->second;
+        files.erase(f);
+        return true;
+    }
+};
+
+/// Defined here (rather than in a test) because every native test links the firmware code which uses it
+inline MockFS &mockSPIFFS()
+{
+    static MockFS fs;
+    return fs;
+}
+
+#define SPIFFS mockSPIFFS()
+
+inline int File::read(uint8_t *buf, size_t len)
+{
+    if (!contents)
+        return -1;
+    if (len > contents->size() - pos)
+        len = contents->size() - pos;
+    memcpy(buf, contents->data() + pos, len);
+    pos += len;
+    SPIFFS.bytesRead += len;
+    return len;
+}
+
+inline size_t File::write(const uint8_t *buf, size_t len)
+{
+    if (!contents)
+        return 0;
+    contents->replace(pos, len, (const char *)buf, len);
+    pos += len;
+    SPIFFS.numWrites++;
+    SPIFFS.bytesWritten += len;
+    return len;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Host stand-in for src/concurrency/OSThread.h: a thread which never runs by itself (tests call runOnce()), and just counts how
+// often it was woken
+
+#include "freertosinc.h"
+#include <atomic>
+
+namespace concurrency
+{
+
+enum ThreadPriority { THREAD_PRIORITY_RADIO, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_BACKGROUND };
+
+class OSThread
+{
+  public:
+    std::atomic<uint32_t> numWakes;
+    ThreadPriority priority = THREAD_PRIORITY_NORMAL;
+
+    OSThread(const char *name = "", uint32_t period = 0) : numWakes(0) {}
+
+    virtual ~OSThread() {}
+
+    void wake() { numWakes++; }
+
+    void wakeFromISR(BaseType_t *higherPriWoken) { numWakes++; }
+
+  protected:
+    virtual int32_t runOnce() { return 0; }
+};
+
+} // namespace concurrency
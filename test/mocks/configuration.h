@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for src/configuration.h, with just the debug logging the code under test uses
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#define DEBUG_MSG(...) printf(__VA_ARGS__)
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for src/freertosinc.h, with just the types the code under test uses
+
+#include <stdint.h>
+
+typedef int32_t BaseType_t;
@@ -0,0 +1,195 @@
+#include "BinaryLog.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <unity.h>
+
+/// millis() of every message we make (so each line starts "??:??:?? 12 ", we send no wall clock time)
+#define MESSAGE_MSEC 12345
+
+static size_t pack(uint8_t *out, size_t room, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t len = binaryLogPackArgs(out, room, format, args);
+    va_end(args);
+    return len;
+}
+
+/**
+ * Builds what a device would send (frames, with some plain text in between) and, for each message, the line we expect
+ * bin/log_decoder.py to turn it back into.
+ */
+class Capture
+{
+    uint32_t nextId = 1;
+    bool atLineStart = true;
+
+    void frame(BinaryLogFrame kind, const void *payload, size_t len, const void *more = NULL, size_t moreLen = 0)
+    {
+        uint8_t header[BINARY_LOG_HEADER_LEN];
+        binaryLogFrameHeader(header, kind, len + moreLen);
+        bytes.append((const char *)header, sizeof(header));
+        bytes.append((const char *)payload, len);
+        bytes.append((const char *)more, moreLen);
+    }
+
+  public:
+    std::string bytes, expected;
+
+    void text(const char *s)
+    {
+        bytes += s;
+        expected += s;
+    }
+
+    void clock(uint32_t msec, uint32_t secs)
+    {
+        uint32_t payload[] = {msec, secs};
+        frame(BINARY_LOG_CLOCK, payload, sizeof(payload));
+    }
+
+    void message(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        uint32_t ids[] = {nextId++, 0, MESSAGE_MSEC};
+        frame(BINARY_LOG_STRING, &ids[0], sizeof(ids[0]), format, strlen(format));
+
+        uint8_t args[BINARY_LOG_MAX_ARGS];
+        char line[256];
+        va_list arg;
+        va_start(arg, format);
+        size_t argsLen = binaryLogPackArgs(args, sizeof(args), format, arg);
+        va_end(arg);
+        va_start(arg, format);
+        vsnprintf(line, sizeof(line), format, arg);
+        va_end(arg);
+        frame(BINARY_LOG_MESSAGE, ids, sizeof(ids), args, argsLen);
+
+        if (atLineStart) {
+            char header[32];
+            snprintf(header, sizeof(header), "??:??:?? %u ", MESSAGE_MSEC / 1000);
+            expected += header;
+        }
+        expected += line;
+        atLineStart = line[0] && line[strlen(line) - 1] == '\n';
+    }
+};
+
+/// Run bin/log_decoder.py on bytes, @return false if we couldn't
+static bool decode(const std::string &bytes, std::string *out)
+{
+    char path[] = "/tmp/binary_log_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    bool ok = write(fd, bytes.data(), bytes.size()) == (ssize_t)bytes.size();
+    close(fd);
+
+    std::string cmd = std::string("python3 bin/log_decoder.py ") + path;
+    FILE *f = ok ? popen(cmd.c_str(), "r") : NULL;
+    if (f) {
+        char buf[256];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            out->append(buf, n);
+        ok = pclose(f) == 0;
+    } else
+        ok = false;
+
+    unlink(path);
+    return ok;
+}
+
+void test_pack_sizes()
+{
+    uint8_t buf[BINARY_LOG_MAX_ARGS];
+
+    // ints are 4 bytes, long longs 8, strings a length byte and their text
+    TEST_ASSERT_EQUAL(4 + 4 + 8 + 1 + 3, pack(buf, sizeof(buf), "%d %u %lld %s", -1, 2u, 3LL, "abc"));
+
+    // A width from the arguments is an int too, and %% takes nothing
+    TEST_ASSERT_EQUAL(4 + 4, pack(buf, sizeof(buf), "%% %*d %%", 5, 6));
+
+    // Doubles and pointers are always 8
+    TEST_ASSERT_EQUAL(8 + 8 + 8, pack(buf, sizeof(buf), "%f %p %.3g", 1.0, (void *)buf, 2.0));
+}
+
+void test_pack_strings()
+{
+    uint8_t buf[BINARY_LOG_MAX_ARGS];
+
+    TEST_ASSERT_EQUAL(1 + 6, pack(buf, sizeof(buf), "%s", (const char *)NULL));
+    TEST_ASSERT_EQUAL(6, buf[0]);
+    TEST_ASSERT_EQUAL_MEMORY("(null)", buf + 1, 6);
+
+    // Long strings are cut to BINARY_LOG_MAX_STRING
+    char longString[BINARY_LOG_MAX_STRING * 2 + 1];
+    memset(longString, 'x', sizeof(longString) - 1);
+    longString[sizeof(longString) - 1] = '\0';
+    TEST_ASSERT_EQUAL(1 + BINARY_LOG_MAX_STRING, pack(buf, sizeof(buf), "%s", longString));
+    TEST_ASSERT_EQUAL(BINARY_LOG_MAX_STRING, buf[0]);
+}
+
+void test_pack_stops_when_full()
+{
+    uint8_t buf[BINARY_LOG_MAX_ARGS];
+
+    // The second int doesn't fit, so we stop before it
+    TEST_ASSERT_EQUAL(4, pack(buf, 6, "%d %d", 1, 2));
+
+    // A string which doesn't fit is cut short to what does
+    TEST_ASSERT_EQUAL(4 + 3, pack(buf, 7, "%d %s", 1, "abcdef"));
+    TEST_ASSERT_EQUAL(2, buf[4]);
+
+    // We can't know what an unknown conversion took from the arguments, so we stop there
+    TEST_ASSERT_EQUAL(4, pack(buf, sizeof(buf), "%d %k %d", 1, 2));
+}
+
+void test_frame_header()
+{
+    uint8_t header[BINARY_LOG_HEADER_LEN];
+    binaryLogFrameHeader(header, BINARY_LOG_STRING, 0x1234);
+    static const uint8_t expected[] = {BINARY_LOG_START1, BINARY_LOG_START2, BINARY_LOG_STRING, 0x34, 0x12};
+    TEST_ASSERT_EQUAL_MEMORY(expected, header, sizeof(expected));
+}
+
+/**
+ * Everything the firmware packs must come back out of bin/log_decoder.py just as printf would have formatted it
+ */
+void test_round_trip_through_decoder()
+{
+    Capture c;
+    c.text("boot text before the log started\n");
+    c.clock(MESSAGE_MSEC, 0); // we don't know the time
+    c.message("Received %s from 0x%x id=0x%08x hops=%d snr=%.2f\n", "text", 0x1234u, 0xdeadbeefu, -3, 7.25);
+    c.message("big=%lld ull=%llu ul=%lu z=%zu c=%c %%\n", -123456789012LL, 18446744073709551615ULL, 4294967295UL, (size_t)42,
+              'Z');
+    c.message("part1 %u, ", 5u);
+    c.message("part2 %5.1f|%-6s|%*d|%.*s|\n", 1.25, "ab", 4, 9, 3, "abcdef");
+    c.message("hex %#x %X %o %#o %hd %hhu %+d % d %05d\n", 255u, 0xabcu, 8u, 8u, (short)-2, (unsigned char)200, 3, 4, -5);
+    c.message("float %e %g %E %G %.0f\n", 12345.678, 0.0001, 1e-10, 1e20, 2.5);
+    c.message("hexfloat %a %a %a %A\n", 1.0, 3.0, -0.375, 255.5);
+    c.message("pointer %p\n", (void *)0x10);
+    c.text("text between messages\n");
+    c.message("no arguments\n");
+
+    std::string decoded;
+    if (!decode(c.bytes, &decoded))
+        TEST_IGNORE_MESSAGE("couldn't run python3 bin/log_decoder.py (run the tests from the project directory)");
+
+    TEST_ASSERT_EQUAL_STRING(c.expected.c_str(), decoded.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pack_sizes);
+    RUN_TEST(test_pack_strings);
+    RUN_TEST(test_pack_stops_when_full);
+    RUN_TEST(test_frame_header);
+    RUN_TEST(test_round_trip_through_decoder);
+    return UNITY_END();
+}
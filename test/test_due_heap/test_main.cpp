@@ -0,0 +1,204 @@
+#include "concurrency/DueHeap.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+
+using namespace concurrency;
+
+/// How much (simulated) time each jitter benchmark covers
+#define BENCHMARK_NSECS 300000000
+
+/// A periodic timer, the way PriorityController keeps an OSThread
+struct Timer : public DueHeapItem {
+    uint32_t period;
+};
+
+/// Pop everything and check it comes out soonest first
+static void checkDrainsInOrder(DueHeap &heap, uint32_t start)
+{
+    uint32_t last = start;
+    while (!heap.empty()) {
+        DueHeapItem *x = heap.top();
+        TEST_ASSERT_TRUE((int32_t)(x->dueAt - last) >= 0);
+        last = x->dueAt;
+        heap.remove(x);
+        TEST_ASSERT_FALSE(x->inHeap());
+    }
+}
+
+void test_soonest_on_top()
+{
+    std::vector<Timer> timers(100);
+    DueHeap heap;
+    srand(1);
+    for (auto &t : timers)
+        heap.push(&t, rand() % 1000);
+    TEST_ASSERT_EQUAL(100, heap.size());
+    checkDrainsInOrder(heap, 0);
+}
+
+void test_update_and_remove()
+{
+    std::vector<Timer> timers(100);
+    DueHeap heap;
+    srand(2);
+    for (auto &t : timers)
+        heap.push(&t, rand() % 1000);
+
+    // Move some sooner, some later, and take some out from the middle
+    for (int i = 0; i < 1000; i++) {
+        Timer &t = timers[rand() % timers.size()];
+        if (!t.inHeap())
+            heap.push(&t, rand() % 1000);
+        else if (rand() % 4)
+            heap.update(&t, rand() % 1000);
+        else
+            heap.remove(&t);
+    }
+    heap.remove(&timers[0]);
+    heap.remove(&timers[0]); // removing what isn't there is harmless
+    checkDrainsInOrder(heap, 0);
+}
+
+void test_millis_wrap()
+{
+    // Due times either side of millis() wrapping still come out in the right order
+    Timer a, b, c;
+    DueHeap heap;
+    heap.push(&a, 5);
+    heap.push(&b, 0xfffffff0);
+    heap.push(&c, 0xffffffff);
+    TEST_ASSERT_EQUAL_PTR(&b, heap.top());
+    heap.remove(&b);
+    TEST_ASSERT_EQUAL_PTR(&c, heap.top());
+    heap.remove(&c);
+    TEST_ASSERT_EQUAL_PTR(&a, heap.top());
+}
+
+/// @return real nsecs since start
+static uint32_t nsecsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// How late each timer fired
+struct Lateness {
+    std::vector<uint32_t> nsecs;
+
+    void add(uint32_t late) { nsecs.push_back(late); }
+
+    /// Describe the spread in msg
+    void describe(char *msg, size_t len, const char *name)
+    {
+        std::sort(nsecs.begin(), nsecs.end());
+        double total = 0;
+        for (auto u : nsecs)
+            total += u;
+        size_t n = nsecs.size();
+        snprintf(msg, len, "%s: %zu fires, late by mean %.0f ns, 99th percentile %u ns, max %u ns", name, n, n ? total / n : 0,
+                 n ? nsecs[n * 99 / 100] : 0, n ? nsecs[n - 1] : 0);
+    }
+};
+
+/// Periods from 1 to 10 msecs (in nsecs), spread out so the timers don't all fire together
+static std::vector<Timer> makeTimers(size_t n)
+{
+    std::vector<Timer> timers(n);
+    for (size_t i = 0; i < n; i++) {
+        timers[i].period = 1000000 + (i * 7919) % 9000 * 1000;
+        timers[i].dueAt = timers[i].period;
+    }
+    return timers;
+}
+
+/*
+ * The benchmarks keep a simulated clock (in nsecs) which only moves on by the real time each pass of the scheduler takes, and
+ * then, like the main loop's delay, straight to when the next timer is due.  So how late a timer fires is just the time the
+ * scheduler spent getting to it, without whatever else this computer is doing.
+ */
+
+/// Fire timers from a DueHeap (as PriorityController now does)
+static void runHeap(size_t n, Lateness &late)
+{
+    std::vector<Timer> timers = makeTimers(n);
+    DueHeap heap;
+    for (auto &t : timers)
+        heap.push(&t, t.dueAt);
+
+    uint32_t now = 0;
+    while (now < BENCHMARK_NSECS) {
+        auto passStart = std::chrono::steady_clock::now();
+        Timer *t;
+        while ((t = static_cast<Timer *>(heap.top())) != NULL && (int32_t)(t->dueAt - now) <= 0) {
+            late.add(now + nsecsSince(passStart) - t->dueAt);
+            heap.update(t, t->dueAt + t->period);
+        }
+
+        // Sleep until the soonest is due
+        uint32_t next = heap.top()->dueAt;
+        now += nsecsSince(passStart);
+        if ((int32_t)(next - now) > 0)
+            now = next;
+    }
+}
+
+/// Fire timers by looking at every one each pass (as PriorityController used to)
+static void runScan(size_t n, Lateness &late)
+{
+    std::vector<Timer> timers = makeTimers(n);
+
+    uint32_t now = 0;
+    while (now < BENCHMARK_NSECS) {
+        auto passStart = std::chrono::steady_clock::now();
+        for (auto &t : timers)
+            if ((int32_t)(t.dueAt - now) <= 0) {
+                late.add(now + nsecsSince(passStart) - t.dueAt);
+                t.dueAt += t.period;
+            }
+
+        // Look at them all again to find how long we can sleep
+        uint32_t next = timers[0].dueAt;
+        for (auto &t : timers)
+            if ((int32_t)(t.dueAt - next) < 0)
+                next = t.dueAt;
+        now += nsecsSince(passStart);
+        if ((int32_t)(next - now) > 0)
+            now = next;
+    }
+}
+
+/**
+ * Not a pass/fail test (timings depend on the machine) - prints how late the scheduler's own work makes timers fire when we
+ * keep them in a DueHeap, next to looking at every one of them each pass, for a few numbers of timers.
+ */
+void test_jitter_benchmark()
+{
+    static const size_t counts[] = {24, 256, 4096};
+    char msg[160];
+    for (size_t n : counts) {
+        Lateness heap, scan;
+        runHeap(n, heap);
+        runScan(n, scan);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%zu timers, heap", n);
+        heap.describe(msg, sizeof(msg), name);
+        TEST_MESSAGE(msg);
+        snprintf(name, sizeof(name), "%zu timers, scan", n);
+        scan.describe(msg, sizeof(msg), name);
+        TEST_MESSAGE(msg);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_soonest_on_top);
+    RUN_TEST(test_update_and_remove);
+    RUN_TEST(test_millis_wrap);
+    RUN_TEST(test_jitter_benchmark);
+    return UNITY_END();
+}
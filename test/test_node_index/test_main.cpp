@@ -0,0 +1,129 @@
+#include "NodeIndex.h"
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+
+/// All NodeIndex needs from a NodeInfo
+struct TestNode {
+    uint32_t num;
+};
+
+/// Node numbers are the bottom of a MAC address, so as far as we are concerned they are random
+static uint32_t randomNum()
+{
+    static uint32_t x = 2463534242u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/// Where the benchmarks put what they found, so the compiler can't leave out the work
+static volatile int sink;
+
+void test_find_add_remove()
+{
+    static TestNode nodes[64];
+    NodeIndex<TestNode, 128> index;
+    for (size_t i = 0; i < 64; i++) {
+        nodes[i].num = randomNum();
+        index.add(nodes, i);
+    }
+    for (size_t i = 0; i < 64; i++)
+        TEST_ASSERT_EQUAL(i, index.find(nodes, 64, nodes[i].num));
+    TEST_ASSERT_EQUAL(-1, index.find(nodes, 64, 0));
+
+    // Take out every other node, the rest must still be found however their probe chains overlapped
+    for (size_t i = 0; i < 64; i += 2)
+        index.remove(nodes, i);
+    for (size_t i = 0; i < 64; i++)
+        TEST_ASSERT_EQUAL(i % 2 ? (int)i : -1, index.find(nodes, 64, nodes[i].num));
+}
+
+void test_colliding_nums()
+{
+    // Nums which differ only in their top bits all want the same first slot, so they make one long probe chain
+    static TestNode nodes[8];
+    NodeIndex<TestNode, 16> index;
+    for (size_t i = 0; i < 8; i++) {
+        nodes[i].num = (uint32_t)i << 28;
+        index.add(nodes, i);
+    }
+    index.remove(nodes, 3);
+    for (size_t i = 0; i < 8; i++)
+        TEST_ASSERT_EQUAL(i == 3 ? -1 : (int)i, index.find(nodes, 8, nodes[i].num));
+}
+
+void test_rebuild()
+{
+    static TestNode nodes[10];
+    NodeIndex<TestNode, 32> index;
+    for (size_t i = 0; i < 10; i++)
+        nodes[i].num = 100 + i;
+    index.rebuild(nodes, 10);
+    TEST_ASSERT_EQUAL(9, index.find(nodes, 10, 109));
+
+    // Entries past the number of nodes we say we have are ignored (they might be from before a reload)
+    TEST_ASSERT_EQUAL(-1, index.find(nodes, 5, 109));
+
+    index.rebuild(nodes, 0);
+    TEST_ASSERT_EQUAL(-1, index.find(nodes, 10, 100));
+}
+
+/// @return the average nsecs to find a node (half the time one we have, half one we don't) with f
+template <class F> static double timeLookups(const TestNode *nodes, size_t numNodes, uint32_t numLookups, F f)
+{
+    int found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < numLookups; i++)
+        found += f(i % 2 ? nodes[(i * 2654435761u) % numNodes].num : randomNum());
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    sink = found;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / numLookups;
+}
+
+/// Print how long a lookup takes in an index of numNodes nodes (sized as NodeDB sizes it), and in a linear search
+template <size_t numNodes> static void benchmarkNodes()
+{
+    static TestNode nodes[numNodes];
+    static NodeIndex<TestNode, nextPowerOfTwo(numNodes * 2)> index;
+    for (size_t i = 0; i < numNodes; i++)
+        nodes[i].num = randomNum();
+    index.rebuild(nodes, numNodes);
+
+    double indexed = timeLookups(nodes, numNodes, 1 << 20, [](uint32_t n) { return index.find(nodes, numNodes, n); });
+    double linear = timeLookups(nodes, numNodes, (1 << 24) / numNodes, [](uint32_t n) {
+        for (size_t i = 0; i < numNodes; i++)
+            if (nodes[i].num == n)
+                return (int)i;
+        return -1;
+    });
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%4zu nodes: index %.1f ns, linear search %.1f ns", numNodes, indexed, linear);
+    TEST_MESSAGE(msg);
+}
+
+/**
+ * Not a pass/fail test (timings depend on the machine) - prints how long it takes to find a node as the DB grows, which
+ * should stay about the same for the index while a linear search grows with the number of nodes.
+ */
+void test_benchmark()
+{
+    benchmarkNodes<32>();
+    benchmarkNodes<128>();
+    benchmarkNodes<512>();
+    benchmarkNodes<1024>();
+    benchmarkNodes<4096>();
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_find_add_remove);
+    RUN_TEST(test_colliding_nums);
+    RUN_TEST(test_rebuild);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
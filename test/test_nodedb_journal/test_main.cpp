@@ -0,0 +1,261 @@
+#include "FSCommon.h"
+#include "NodeDBJournal.h"
+#include <chrono>
+#include <pb_decode.h>
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+/// NodeDBJournal keeps its records here
+static const char *journalfile = "/db.journal";
+
+/// runOnce() is what our thread would call every JOURNAL_FLUSH_MSECS
+class TestJournal : public NodeDBJournal
+{
+  public:
+    using NodeDBJournal::NodeDBJournal;
+
+    int32_t runOnce() override { return NodeDBJournal::runOnce(); }
+};
+
+/// A journal which never compacts (these tests don't want new snapshots)
+static TestJournal *newJournal(uint32_t generation)
+{
+    return new TestJournal(generation, []() { TEST_FAIL_MESSAGE("unexpected compaction"); });
+}
+
+static void appendPosition(NodeDBJournal &j, uint32_t num, uint32_t time)
+{
+    NodeInfo delta = NodeInfo_init_zero;
+    delta.num = num;
+    delta.has_position = true;
+    delta.position.latitude_i = 374000000 + num;
+    delta.position.longitude_i = -1220000000 - num;
+    delta.position.altitude = 30;
+    delta.position.battery_level = 80;
+    delta.position.time = time;
+    j.append(JOURNAL_POSITION, NodeInfo_fields, &delta);
+}
+
+/// Replay the journal for generation, returning the nums of the records in it
+static std::vector<uint32_t> replayNums(uint32_t generation)
+{
+    std::vector<uint32_t> nums;
+    TestJournal *j = newJournal(generation);
+    j->replay([&nums](JournalRecordType type, const uint8_t *payload, size_t len) {
+        NodeInfo n = NodeInfo_init_zero;
+        pb_istream_t stream = pb_istream_from_buffer(payload, len);
+        TEST_ASSERT_TRUE(pb_decode(&stream, NodeInfo_fields, &n));
+        TEST_ASSERT_EQUAL(JOURNAL_POSITION, type);
+        nums.push_back(n.num);
+    });
+    delete j;
+    return nums;
+}
+
+void test_replay_in_order()
+{
+    SPIFFS.files.clear();
+    TestJournal *j = newJournal(3);
+    for (uint32_t num = 1; num <= 40; num++) // more than fits in our RAM buffer, so some are written by append()
+        appendPosition(*j, num, 1000 + num);
+    j->runOnce();
+    delete j;
+
+    std::vector<uint32_t> nums = replayNums(3);
+    TEST_ASSERT_EQUAL(40, nums.size());
+    for (uint32_t i = 0; i < nums.size(); i++)
+        TEST_ASSERT_EQUAL(i + 1, nums[i]);
+}
+
+void test_torn_record_ignored()
+{
+    SPIFFS.files.clear();
+    TestJournal *j = newJournal(3);
+    for (uint32_t num = 1; num <= 5; num++)
+        appendPosition(*j, num, 1000);
+    j->flush();
+    delete j;
+
+    // We lost power part way through writing the last record
+    SPIFFS.files[journalfile].resize(SPIFFS.files[journalfile].size() - 2);
+    TEST_ASSERT_EQUAL(4, replayNums(3).size());
+}
+
+void test_other_generation_discarded()
+{
+    SPIFFS.files.clear();
+    TestJournal *j = newJournal(3);
+    appendPosition(*j, 1, 1000);
+    j->flush();
+    delete j;
+
+    // A new snapshot was written but we lost power before the journal was cleared, so the snapshot has these already
+    TEST_ASSERT_EQUAL(0, replayNums(4).size());
+    TEST_ASSERT_FALSE(SPIFFS.files.count(journalfile));
+}
+
+/// The devicestate we snapshot in the traffic test, a full node DB and our usual config
+static DeviceState devicestate;
+
+/// What it cost us to keep a day of traffic on flash
+struct TrafficStats {
+    uint32_t numChanges = 0, numSnapshots = 0, numSaves = 0;
+    double changeUsecs = 0;                // time NodeDB spent on each change (encoding it, and writing it if need be)
+    double saveUsecs = 0, maxSaveUsecs = 0; // time for each call which wrote to flash (a flush, a snapshot or a compaction)
+};
+
+static TrafficStats stats;
+
+/// Write a new snapshot of devicestate, as NodeDB::saveToDisk() does
+static void writeSnapshot()
+{
+    static uint8_t buf[DeviceState_size];
+    size_t len = pb_encode_to_bytes(buf, sizeof(buf), DeviceState_fields, &devicestate);
+
+    File f = FS.open("/db.proto", FILE_O_WRITE);
+    f.write(buf, len);
+    f.close();
+    stats.numSnapshots++;
+}
+
+/// Call f, counting the time it took towards a change to the DB if isChange, and towards a save if it wrote to flash
+template <class F> static void timeSave(bool isChange, F f)
+{
+    uint32_t numWrites = SPIFFS.numWrites;
+    auto start = std::chrono::steady_clock::now();
+    f();
+    double usecs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    if (isChange) {
+        stats.numChanges++;
+        stats.changeUsecs += usecs;
+    }
+    if (SPIFFS.numWrites != numWrites) {
+        stats.numSaves++;
+        stats.saveUsecs += usecs;
+        if (usecs > stats.maxSaveUsecs)
+            stats.maxSaveUsecs = usecs;
+    }
+}
+
+/**
+ * Replay a day of mesh traffic for numNodes nodes, which each send their position every 15 minutes (the default
+ * position_broadcast_secs).  The first time we hear a node NodeDB journals a JOURNAL_NODE and a JOURNAL_USER record, after
+ * that a JOURNAL_POSITION record for each position.  If snapshotEveryChange we instead rewrite the whole snapshot for each
+ * change (what we would do without a journal).
+ */
+static void replayTraffic(size_t numNodes, bool snapshotEveryChange)
+{
+    SPIFFS.files.clear();
+    SPIFFS.bytesWritten = SPIFFS.numWrites = 0;
+    stats = TrafficStats();
+    mockMillis() = 0;
+
+    memset(&devicestate, 0, sizeof(devicestate));
+    devicestate.has_radio = devicestate.has_owner = devicestate.has_my_node = true;
+    devicestate.radio.has_preferences = true;
+    devicestate.radio.preferences.position_broadcast_secs = 15 * 60;
+    strcpy(devicestate.owner.long_name, "Base station");
+    devicestate.channels_count = 1;
+    devicestate.channels[0].has_settings = true;
+    strcpy(devicestate.channels[0].settings.name, "LongSlow");
+    devicestate.channels[0].settings.psk.size = 16;
+    devicestate.node_db_count = numNodes;
+
+    uint32_t generation = 1;
+    TestJournal journal(generation, [&]() {
+        writeSnapshot();
+        journal.clear(++generation);
+    });
+
+    const uint32_t dayMsecs = 24 * 60 * 60 * 1000, positionMsecs = 15 * 60 * 1000;
+    for (uint32_t now = 0; now < dayMsecs; now += 1000) {
+        mockMillis() = now;
+
+        for (size_t i = 0; i < numNodes; i++) {
+            if ((now + i * 7919 * 1000) % positionMsecs != 0) // nodes are spread across the period
+                continue;
+
+            NodeInfo &info = devicestate.node_db[i];
+            if (!info.num) { // a node we just heard of
+                info.num = 0x10000 + i;
+                info.has_user = true;
+                snprintf(info.user.id, sizeof(info.user.id), "!%08x", info.num);
+                snprintf(info.user.long_name, sizeof(info.user.long_name), "Hiker %u", (unsigned)i);
+                snprintf(info.user.short_name, sizeof(info.user.short_name), "H%u", (unsigned)i);
+
+                timeSave(true, [&]() {
+                    if (snapshotEveryChange)
+                        writeSnapshot();
+                    else {
+                        journal.append(JOURNAL_NODE, NodeInfo_fields, &info);
+                        NodeInfo delta = {info.num};
+                        delta.has_user = true;
+                        delta.user = info.user;
+                        journal.append(JOURNAL_USER, NodeInfo_fields, &delta);
+                    }
+                });
+            }
+
+            info.has_position = true;
+            info.position.latitude_i = 374000000 + (now / 1000) * 3 + i;
+            info.position.longitude_i = -1220000000 - (now / 1000) * 2 - i;
+            info.position.altitude = 30 + i;
+            info.position.battery_level = 100 - now / (dayMsecs / 50);
+            info.position.time = 1600000000 + now / 1000;
+
+            timeSave(true, [&]() {
+                if (snapshotEveryChange)
+                    writeSnapshot();
+                else {
+                    NodeInfo delta = {info.num};
+                    delta.has_position = true;
+                    delta.position = info.position;
+                    journal.append(JOURNAL_POSITION, NodeInfo_fields, &delta);
+                }
+            });
+        }
+
+        if (!snapshotEveryChange && now % JOURNAL_FLUSH_MSECS == 0) // our thread's turn
+            timeSave(false, [&]() { journal.runOnce(); });
+    }
+}
+
+/// Print what a day of traffic for numNodes nodes costs our flash, journaled and with a snapshot for every change
+static void benchmarkTraffic(size_t numNodes)
+{
+    char msg[200];
+    for (int snapshotEveryChange = 1; snapshotEveryChange >= 0; snapshotEveryChange--) {
+        replayTraffic(numNodes, snapshotEveryChange);
+
+        snprintf(msg, sizeof(msg), "%2zu nodes, %s: %u changes, %u bytes in %u saves (%u snapshots)", numNodes,
+                 snapshotEveryChange ? "snapshot per change" : "journal", stats.numChanges, SPIFFS.bytesWritten, stats.numSaves,
+                 stats.numSnapshots);
+        TEST_MESSAGE(msg);
+        snprintf(msg, sizeof(msg), "  %.2f us per change, %.2f us per save (max %.1f)", stats.changeUsecs / stats.numChanges,
+                 stats.saveUsecs / stats.numSaves, stats.maxSaveUsecs);
+        TEST_MESSAGE(msg);
+    }
+}
+
+/**
+ * Not a pass/fail test (timings depend on the machine, and on the device each file write costs far more than here) - prints
+ * the bytes we write to flash in a day of traffic with the journal, next to rewriting the snapshot for every change, and how
+ * long NodeDB spent on each change and each save to flash took.
+ */
+void test_benchmark()
+{
+    benchmarkTraffic(8);
+    benchmarkTraffic(32);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_in_order);
+    RUN_TEST(test_torn_record_ignored);
+    RUN_TEST(test_other_generation_discarded);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+#include "PortDispatchTable.h"
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+
+/// Like a MeshPlugin: it wants packets for one portnum (or any), and we ask it through a virtual call
+class TestPlugin
+{
+  public:
+    int portNum;
+    bool isPromiscuous;
+
+    TestPlugin(int _portNum, bool _isPromiscuous = false) : portNum(_portNum), isPromiscuous(_isPromiscuous) {}
+
+    virtual ~TestPlugin() {}
+
+    virtual bool wantPacket(int p) { return portNum == PORTNUM_ANY || portNum == p; }
+};
+
+typedef PortDispatchTable<TestPlugin> Table;
+
+static int portNumOf(TestPlugin *p)
+{
+    return p->portNum;
+}
+
+static bool all(TestPlugin *p)
+{
+    return true;
+}
+
+static bool promiscuous(TestPlugin *p)
+{
+    return p->isPromiscuous;
+}
+
+/// Where the benchmarks put what they found, so the compiler can't leave out the work
+static volatile int sink;
+
+void test_lists_keep_registration_order()
+{
+    TestPlugin a(5), any1(PORTNUM_ANY), b(3), c(5), any2(PORTNUM_ANY, true);
+    std::vector<TestPlugin *> plugins = {&a, &any1, &b, &c, &any2};
+    Table t;
+    t.build(plugins, portNumOf, all);
+
+    // Plugins for a portnum, with the PORTNUM_ANY plugins among them where they were registered
+    std::vector<TestPlugin *> for5 = {&a, &any1, &c, &any2};
+    TEST_ASSERT_TRUE(t.lookup(5) == for5);
+    std::vector<TestPlugin *> for3 = {&any1, &b, &any2};
+    TEST_ASSERT_TRUE(t.lookup(3) == for3);
+
+    // A portnum nobody asked for only goes to the PORTNUM_ANY plugins
+    std::vector<TestPlugin *> forOthers = {&any1, &any2};
+    TEST_ASSERT_TRUE(t.lookup(4) == forOthers);
+    TEST_ASSERT_TRUE(t.lookup(0) == forOthers);
+}
+
+void test_left_out_plugins()
+{
+    TestPlugin a(5), sniffer(5, true), anySniffer(PORTNUM_ANY, true), any(PORTNUM_ANY);
+    std::vector<TestPlugin *> plugins = {&a, &sniffer, &anySniffer, &any};
+    Table t;
+    t.build(plugins, portNumOf, promiscuous);
+
+    std::vector<TestPlugin *> for5 = {&sniffer, &anySniffer};
+    TEST_ASSERT_TRUE(t.lookup(5) == for5);
+    std::vector<TestPlugin *> forOthers = {&anySniffer};
+    TEST_ASSERT_TRUE(t.lookup(6) == forOthers);
+
+    // Rebuilding starts again from scratch
+    plugins = {&a};
+    t.build(plugins, portNumOf, promiscuous);
+    TEST_ASSERT_TRUE(t.lookup(5).empty());
+}
+
+/// @return the average nsecs to find which plugins want each packet with f, over packets for every port
+template <class F> static double timeDispatch(int numPorts, F f)
+{
+    const uint32_t n = 1000000;
+    int wanted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n; i++)
+        wanted += f((int)(i * 2654435761u % (numPorts + 1))); // the last port is one nobody asked for
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    sink = wanted;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / n;
+}
+
+/// Print how long it takes to find the plugins which want a packet with numPlugins plugins, by table and by asking them all
+static void benchmarkPlugins(int numPlugins)
+{
+    // As on the device, most plugins have their own portnum, a few share one and a couple want everything
+    std::vector<TestPlugin *> plugins;
+    int numPorts = numPlugins * 3 / 4;
+    for (int i = 0; i < numPlugins; i++)
+        plugins.push_back(new TestPlugin(i % 16 == 15 ? PORTNUM_ANY : i % numPorts));
+
+    Table t;
+    t.build(plugins, portNumOf, all);
+
+    double indexed = timeDispatch(numPorts, [&t](int port) {
+        int wanted = 0;
+        for (auto p : t.lookup(port))
+            wanted += p->wantPacket(port);
+        return wanted;
+    });
+    double linear = timeDispatch(numPorts, [&plugins](int port) {
+        int wanted = 0;
+        for (auto p : plugins)
+            wanted += p->wantPacket(port);
+        return wanted;
+    });
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%3d plugins: table %.1f ns, asking every plugin %.1f ns", numPlugins, indexed, linear);
+    TEST_MESSAGE(msg);
+
+    for (auto p : plugins)
+        delete p;
+}
+
+/**
+ * Not a pass/fail test (timings depend on the machine) - prints how long it takes to find the plugins for a packet through
+ * the table, next to asking every plugin as callPlugins() used to.
+ */
+void test_benchmark()
+{
+    benchmarkPlugins(8);
+    benchmarkPlugins(16);
+    benchmarkPlugins(32);
+    benchmarkPlugins(128);
+    benchmarkPlugins(512);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lists_keep_registration_order);
+    RUN_TEST(test_left_out_plugins);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,122 @@
+#include "RecordBatch.h"
+#include <string.h>
+#include <unity.h>
+
+static uint8_t buf[512];
+
+/// Fill a record with bytes which depend on its length, so we can tell records apart
+static void fillRecord(uint8_t *record, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        record[i] = (uint8_t)(len + i);
+}
+
+void test_varint_len()
+{
+    TEST_ASSERT_EQUAL(1, RecordBatchWriter::varintLen(0));
+    TEST_ASSERT_EQUAL(1, RecordBatchWriter::varintLen(127));
+    TEST_ASSERT_EQUAL(2, RecordBatchWriter::varintLen(128));
+    TEST_ASSERT_EQUAL(2, RecordBatchWriter::varintLen(16383));
+    TEST_ASSERT_EQUAL(3, RecordBatchWriter::varintLen(16384));
+}
+
+void test_round_trip()
+{
+    // Lengths either side of where the varint grows to two bytes
+    static const size_t lens[] = {0, 1, 127, 128, 200};
+    const size_t numLens = sizeof(lens) / sizeof(lens[0]);
+
+    RecordBatchWriter writer(buf, sizeof(buf));
+    uint8_t record[200];
+    for (size_t i = 0; i < numLens; i++) {
+        fillRecord(record, lens[i]);
+        TEST_ASSERT_TRUE(writer.add(record, lens[i]));
+    }
+    TEST_ASSERT_EQUAL(numLens, writer.count());
+    TEST_ASSERT_EQUAL(1 + 0 + 1 + 1 + 1 + 127 + 2 + 128 + 2 + 200, writer.length());
+
+    RecordBatchReader reader(buf, writer.length());
+    const uint8_t *got;
+    size_t gotLen;
+    for (size_t i = 0; i < numLens; i++) {
+        TEST_ASSERT_TRUE(reader.next(&got, &gotLen));
+        TEST_ASSERT_EQUAL(lens[i], gotLen);
+        fillRecord(record, lens[i]);
+        TEST_ASSERT_EQUAL_MEMORY(record, got, gotLen);
+    }
+    TEST_ASSERT_FALSE(reader.next(&got, &gotLen));
+    TEST_ASSERT_FALSE(reader.isMalformed());
+}
+
+void test_full_batch_is_unchanged()
+{
+    uint8_t record[10];
+    fillRecord(record, sizeof(record));
+
+    // Room for exactly two records (each is one byte of length then ten of record)
+    RecordBatchWriter writer(buf, 22);
+    TEST_ASSERT_TRUE(writer.add(record, sizeof(record)));
+    TEST_ASSERT_TRUE(writer.add(record, sizeof(record)));
+    TEST_ASSERT_FALSE(writer.fits(0));
+    TEST_ASSERT_FALSE(writer.add(record, 1));
+    TEST_ASSERT_EQUAL(2, writer.count());
+    TEST_ASSERT_EQUAL(22, writer.length());
+}
+
+void test_empty_batch()
+{
+    const uint8_t *got;
+    size_t gotLen;
+    RecordBatchReader reader(buf, 0);
+    TEST_ASSERT_FALSE(reader.next(&got, &gotLen));
+    TEST_ASSERT_FALSE(reader.isMalformed());
+}
+
+void test_length_past_end_is_malformed()
+{
+    // A record which claims five bytes but only has two, after a good one
+    static const uint8_t bad[] = {1, 0xaa, 5, 1, 2};
+    const uint8_t *got;
+    size_t gotLen;
+    RecordBatchReader reader(bad, sizeof(bad));
+    TEST_ASSERT_TRUE(reader.next(&got, &gotLen));
+    TEST_ASSERT_EQUAL(1, gotLen);
+    TEST_ASSERT_EQUAL(0xaa, got[0]);
+    TEST_ASSERT_FALSE(reader.next(&got, &gotLen));
+    TEST_ASSERT_TRUE(reader.isMalformed());
+    TEST_ASSERT_FALSE(reader.next(&got, &gotLen)); // and we stay stopped
+}
+
+void test_truncated_length_is_malformed()
+{
+    static const uint8_t bad[] = {0x80};
+    const uint8_t *got;
+    size_t gotLen;
+    RecordBatchReader reader(bad, sizeof(bad));
+    TEST_ASSERT_FALSE(reader.next(&got, &gotLen));
+    TEST_ASSERT_TRUE(reader.isMalformed());
+}
+
+void test_overlong_length_is_malformed()
+{
+    // More than the five varint bytes a 32 bit length can need
+    static const uint8_t bad[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+    const uint8_t *got;
+    size_t gotLen;
+    RecordBatchReader reader(bad, sizeof(bad));
+    TEST_ASSERT_FALSE(reader.next(&got, &gotLen));
+    TEST_ASSERT_TRUE(reader.isMalformed());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_varint_len);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_full_batch_is_unchanged);
+    RUN_TEST(test_empty_batch);
+    RUN_TEST(test_length_past_end_is_malformed);
+    RUN_TEST(test_truncated_length_is_malformed);
+    RUN_TEST(test_overlong_length_is_malformed);
+    return UNITY_END();
+}
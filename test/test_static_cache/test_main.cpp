@@ -0,0 +1,191 @@
+#include "mesh/http/StaticFileCache.h"
+#include <SPIFFS.h>
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+
+/// What a browser asks for when it loads the web UI (as laid out by bin/gzip-static.py), the last one doesn't exist
+static const char *pageAssets[] = {"/static/index.html", "/static/app.js",   "/static/style.css",
+                                   "/static/favicon.ico", "/static/logo.png", "/static/robots.txt"};
+
+/// Put the web UI in the filesystem: big compressed script, small compressed page and styles, images we don't compress
+static void makeFiles()
+{
+    SPIFFS.files.clear();
+    SPIFFS.files["/static/index.html.gz"] = std::string(1200, 'h');
+    SPIFFS.files["/static/app.js.gz"] = std::string(180 * 1024, 'j');
+    SPIFFS.files["/static/style.css.gz"] = std::string(3 * 1024, 'c');
+    SPIFFS.files["/static/favicon.ico"] = std::string(4 * 1024, 'i');
+    SPIFFS.files["/static/logo.png"] = std::string(6 * 1024, 'p');
+    staticFileCache.clear();
+}
+
+/// Find a file the way sendStaticFile() does, for a browser which accepts gzip
+static const StaticFileCache::Entry *lookup(const std::string &filename)
+{
+    const StaticFileCache::Entry *file = staticFileCache.get(filename + ".gz");
+    return file ? file : staticFileCache.get(filename);
+}
+
+/// @return calls we made to the filesystem since the last time we asked
+static uint32_t flashCalls()
+{
+    static uint32_t last;
+    uint32_t now = SPIFFS.numExists + SPIFFS.numOpens, calls = now - last;
+    last = now;
+    return calls;
+}
+
+void test_etag_and_body()
+{
+    makeFiles();
+    const StaticFileCache::Entry *e = lookup("/static/style.css");
+    TEST_ASSERT_TRUE(e != NULL);
+    TEST_ASSERT_EQUAL(3 * 1024, e->size);
+    TEST_ASSERT_TRUE(e->body != NULL);
+    std::string etag = e->etag;
+
+    // The big script is too large to keep in RAM, but we still know its ETag
+    e = lookup("/static/app.js");
+    TEST_ASSERT_TRUE(e != NULL);
+    TEST_ASSERT_TRUE(e->body == NULL);
+    TEST_ASSERT_EQUAL(3 * 1024, staticFileCache.getBodyBytes());
+
+    // A new upload with the same size must get a new ETag
+    SPIFFS.files["/static/style.css.gz"] = std::string(3 * 1024, 'd');
+    staticFileCache.clear();
+    e = lookup("/static/style.css");
+    TEST_ASSERT_TRUE(e != NULL);
+    TEST_ASSERT_TRUE(e->etag != etag);
+}
+
+void test_missing_files_are_remembered()
+{
+    makeFiles();
+    flashCalls();
+    TEST_ASSERT_TRUE(lookup("/static/logo.png") != NULL);
+    TEST_ASSERT_TRUE(lookup("/static/robots.txt") == NULL);
+    TEST_ASSERT_TRUE(flashCalls() > 0);
+
+    // Once we know, we don't go to flash for the gzipped copy we don't have, or for a file which doesn't exist
+    TEST_ASSERT_TRUE(lookup("/static/logo.png") != NULL);
+    TEST_ASSERT_TRUE(lookup("/static/robots.txt") == NULL);
+    TEST_ASSERT_EQUAL(0, flashCalls());
+
+    // Uploads clear the cache, after which we can find the new file
+    SPIFFS.files["/static/robots.txt"] = "User-agent: *\n";
+    staticFileCache.clear();
+    const StaticFileCache::Entry *e = lookup("/static/robots.txt");
+    TEST_ASSERT_TRUE(e != NULL);
+    TEST_ASSERT_EQUAL(14, e->size);
+}
+
+void test_missing_files_dont_evict_files()
+{
+    makeFiles();
+    lookup("/static/index.html");
+
+    // Lots of requests for files we don't have (i.e. a scanner) only replace other missing paths
+    char path[32];
+    for (int i = 0; i < 100; i++) {
+        snprintf(path, sizeof(path), "/static/nothing%d", i);
+        TEST_ASSERT_TRUE(lookup(path) == NULL);
+    }
+
+    flashCalls();
+    TEST_ASSERT_TRUE(lookup("/static/index.html") != NULL);
+    TEST_ASSERT_EQUAL(0, flashCalls());
+}
+
+/// Send an asset the way sendStaticFile() did before the cache: find it in SPIFFS, then read it all from flash
+/// @return the bytes sent
+static size_t sendUncached(const std::string &filename)
+{
+    std::string path = filename + ".gz";
+    if (!SPIFFS.exists(path.c_str())) {
+        path = filename;
+        if (!SPIFFS.exists(path.c_str()))
+            return 0;
+    }
+
+    File f = SPIFFS.open(path.c_str());
+    uint8_t buf[256];
+    size_t sent = 0;
+    int len;
+    while ((len = f.read(buf, sizeof(buf))) > 0)
+        sent += len;
+    return sent;
+}
+
+/// Send an asset the way sendStaticFile() does now, to a browser which has the ETags in browserETags
+/// @return the bytes sent
+static size_t sendCached(const std::string &filename, std::map<std::string, std::string> &browserETags)
+{
+    const StaticFileCache::Entry *e = lookup(filename);
+    if (!e || browserETags[filename] == e->etag)
+        return 0; // 404 or 304
+    browserETags[filename] = e->etag;
+
+    if (!e->body) { // streamed from flash
+        File f = SPIFFS.open(e->path.c_str());
+        uint8_t buf[256];
+        while (f.read(buf, sizeof(buf)) > 0)
+            ;
+    }
+    return e->size;
+}
+
+/**
+ * Replay numLoads loads of the web UI (a new browser with nothing cached every 100 loads, the rest reloads which revalidate
+ * every asset) and print the filesystem calls, bytes read from flash and bytes sent for each load, and the time per request.
+ */
+static void replay(const char *name, bool useCache)
+{
+    const int numLoads = 1000;
+    makeFiles();
+    SPIFFS.numExists = SPIFFS.numOpens = SPIFFS.bytesRead = 0;
+    staticFileCache.hits = staticFileCache.misses = 0;
+    uint64_t bytesSent = 0;
+
+    std::map<std::string, std::string> browserETags;
+    auto start = std::chrono::steady_clock::now();
+    for (int load = 0; load < numLoads; load++) {
+        if (load % 100 == 0)
+            browserETags.clear();
+
+        for (auto asset : pageAssets)
+            bytesSent += useCache ? sendCached(asset, browserETags) : sendUncached(asset);
+    }
+    double usecs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    size_t numRequests = numLoads * (sizeof(pageAssets) / sizeof(pageAssets[0]));
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%s: per load %.2f exists + %.2f opens, %.0f bytes read from flash, %.0f bytes sent, %.2f us/req",
+             name, (double)SPIFFS.numExists / numLoads, (double)SPIFFS.numOpens / numLoads,
+             (double)SPIFFS.bytesRead / numLoads, (double)bytesSent / numLoads, usecs / numRequests);
+    TEST_MESSAGE(msg);
+    if (useCache) {
+        snprintf(msg, sizeof(msg), "  cache hits %u, misses %u", staticFileCache.hits, staticFileCache.misses);
+        TEST_MESSAGE(msg);
+    }
+}
+
+/**
+ * Not a pass/fail test (timings depend on the machine, and on the device flash calls cost far more than here) - prints what
+ * loading the web UI costs with the cache, next to looking up and reading every file as sendStaticFile() did before.
+ */
+void test_benchmark()
+{
+    replay("no cache (before)", false);
+    replay("cache (now)", true);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_etag_and_body);
+    RUN_TEST(test_missing_files_are_remembered);
+    RUN_TEST(test_missing_files_dont_evict_files);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,281 @@
+#include "StreamFraming.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+/// The biggest payload we accept (MAX_TO_FROM_RADIO_SIZE on the device)
+#define MAX_PAYLOAD 512
+
+/// A frame and its header, and how much we batch (as MAX_STREAM_BUF_SIZE and STREAM_TX_BATCH_SIZE in StreamAPI.h)
+#define MAX_FRAME (MAX_PAYLOAD + STREAM_HEADER_LEN)
+#define TX_BATCH_SIZE (2 * MAX_FRAME)
+
+/// How many frames each benchmark sends
+#define NUM_FRAMES 200000
+
+/**
+ * A Stream whose reads return what was written to it.  Like the ESP32 UART driver (and a TCP socket) it takes a lock for each
+ * call, which is the per call cost batching saves.
+ */
+class LoopbackStream
+{
+    std::vector<uint8_t> bytes;
+    size_t readPos = 0;
+    std::mutex lock;
+
+  public:
+    /// Calls to any of our methods
+    uint32_t numCalls = 0;
+
+    size_t write(const uint8_t *buf, size_t len)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        numCalls++;
+        if (readPos == bytes.size()) { // everything was read, start again at the front
+            bytes.clear();
+            readPos = 0;
+        }
+        bytes.insert(bytes.end(), buf, buf + len);
+        return len;
+    }
+
+    int available()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        numCalls++;
+        return bytes.size() - readPos;
+    }
+
+    int read()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        numCalls++;
+        return readPos < bytes.size() ? bytes[readPos++] : -1;
+    }
+
+    size_t readBytes(uint8_t *buf, size_t len)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        numCalls++;
+        if (len > bytes.size() - readPos)
+            len = bytes.size() - readPos;
+        memcpy(buf, bytes.data() + readPos, len);
+        readPos += len;
+        return len;
+    }
+};
+
+/// What the receiving side does with each frame: check it is the one we expect
+struct Receiver {
+    const std::vector<std::string> *sent;
+    size_t numReceived = 0;
+    bool allMatched = true;
+
+    void onFrame(const uint8_t *payload, size_t len)
+    {
+        const std::string &want = (*sent)[numReceived++ % sent->size()];
+        if (len != want.size() || memcmp(payload, want.data(), len) != 0)
+            allMatched = false;
+    }
+};
+
+/// Reads the way StreamAPI does now: whatever has arrived, in blocks, then every complete frame in it
+struct BlockReader {
+    uint8_t rxBuf[MAX_FRAME];
+    size_t rxPtr = 0;
+
+    void read(LoopbackStream &s, Receiver &r)
+    {
+        int avail;
+        while ((avail = s.available()) > 0) {
+            size_t toRead = sizeof(rxBuf) - rxPtr;
+            if ((size_t)avail < toRead)
+                toRead = avail;
+            rxPtr += s.readBytes(rxBuf + rxPtr, toRead);
+
+            size_t done = streamFindFrames(rxBuf, rxPtr, MAX_PAYLOAD,
+                                           [&r](const uint8_t *payload, size_t len) { r.onFrame(payload, len); });
+            rxPtr -= done;
+            memmove(rxBuf, rxBuf + done, rxPtr);
+        }
+    }
+};
+
+/// Reads the way StreamAPI used to: one byte at a time through a little state machine (which never finished a zero length
+/// frame, so it read on into the next one)
+struct ByteReader {
+    uint8_t rxBuf[MAX_FRAME];
+    size_t rxPtr = 0;
+
+    void read(LoopbackStream &s, Receiver &r)
+    {
+        while (s.available()) {
+            uint8_t c = s.read();
+            size_t ptr = rxPtr++;
+            rxBuf[ptr] = c;
+
+            if (ptr == 0) {
+                if (c != STREAM_START1)
+                    rxPtr = 0;
+            } else if (ptr == 1) {
+                if (c != STREAM_START2)
+                    rxPtr = 0;
+            } else if (ptr >= STREAM_HEADER_LEN) {
+                uint32_t len = (rxBuf[2] << 8) + rxBuf[3];
+                if (ptr == STREAM_HEADER_LEN && len > MAX_PAYLOAD)
+                    rxPtr = 0;
+                if (rxPtr != 0 && ptr + 1 == len + STREAM_HEADER_LEN) {
+                    r.onFrame(rxBuf + STREAM_HEADER_LEN, len);
+                    rxPtr = 0;
+                }
+            }
+        }
+    }
+};
+
+/// Writes the way StreamAPI does now: frames batched up, one write per batch
+struct BatchWriter {
+    uint8_t txBuf[TX_BATCH_SIZE];
+    size_t txLen = 0;
+
+    void add(LoopbackStream &s, const std::string &payload)
+    {
+        if (sizeof(txBuf) - txLen < MAX_FRAME)
+            flush(s);
+        streamFrameHeader(txBuf + txLen, payload.size());
+        memcpy(txBuf + txLen + STREAM_HEADER_LEN, payload.data(), payload.size());
+        txLen += STREAM_HEADER_LEN + payload.size();
+    }
+
+    void flush(LoopbackStream &s)
+    {
+        if (txLen)
+            s.write(txBuf, txLen);
+        txLen = 0;
+    }
+};
+
+/// Writes the way StreamAPI used to: one write per frame
+struct FrameWriter {
+    uint8_t txBuf[MAX_FRAME];
+
+    void add(LoopbackStream &s, const std::string &payload)
+    {
+        streamFrameHeader(txBuf, payload.size());
+        memcpy(txBuf + STREAM_HEADER_LEN, payload.data(), payload.size());
+        s.write(txBuf, STREAM_HEADER_LEN + payload.size());
+    }
+
+    void flush(LoopbackStream &s) {}
+};
+
+/// Payloads the size of typical FromRadio/ToRadio protobufs (a text message packet up to a full NodeInfo), with bytes which
+/// look like framing inside them
+static std::vector<std::string> makePayloads(bool withEmpty)
+{
+    std::vector<std::string> payloads;
+    for (size_t i = 0; i < 64; i++) {
+        std::string p(20 + (i * 37) % 220, '\0');
+        for (size_t j = 0; j < p.size(); j++)
+            p[j] = (j % 17 == 0) ? STREAM_START1 : (char)(i * 31 + j);
+        payloads.push_back(p);
+    }
+    if (withEmpty)
+        payloads.push_back(""); // a zero length protobuf is valid too
+    return payloads;
+}
+
+void test_frames_survive_junk_and_splits()
+{
+    std::vector<std::string> payloads = makePayloads(true);
+    std::string wire;
+    uint8_t header[STREAM_HEADER_LEN];
+    for (size_t i = 0; i < payloads.size(); i++) {
+        if (i % 3 == 0)
+            wire += "debug text \x94 with a start byte\n";
+        if (i % 5 == 0) { // a header with an impossible length
+            streamFrameHeader(header, MAX_PAYLOAD + 1);
+            wire.append((const char *)header, sizeof(header));
+        }
+        streamFrameHeader(header, payloads[i].size());
+        wire.append((const char *)header, sizeof(header));
+        wire += payloads[i];
+    }
+
+    // Feed it through a block reader in uneven pieces, so frames are split at every possible point
+    Receiver r;
+    r.sent = &payloads;
+    BlockReader reader;
+    LoopbackStream s;
+    for (size_t pos = 0, piece = 1; pos < wire.size(); pos += piece, piece = piece % 13 + 1) {
+        size_t n = std::min(piece, wire.size() - pos);
+        s.write((const uint8_t *)wire.data() + pos, n);
+        reader.read(s, r);
+    }
+
+    TEST_ASSERT_EQUAL(payloads.size(), r.numReceived);
+    TEST_ASSERT_TRUE(r.allMatched);
+    TEST_ASSERT_EQUAL(0, reader.rxPtr);
+}
+
+/**
+ * Send NUM_FRAMES frames through a loopback stream, with the receiving side reading whenever a few are waiting (as
+ * StreamAPI::loop does), and print the throughput and how many stream calls each frame took.
+ */
+template <class Writer, class Reader> static void benchmark(const char *name)
+{
+    static std::vector<std::string> payloads = makePayloads(false); // ByteReader can't handle empty ones
+    static Writer writer;
+    static Reader reader;
+    LoopbackStream s;
+    Receiver r;
+    r.sent = &payloads;
+
+    size_t numBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < NUM_FRAMES; i++) {
+        const std::string &p = payloads[i % payloads.size()];
+        writer.add(s, p);
+        numBytes += STREAM_HEADER_LEN + p.size();
+
+        if (i % 8 == 7) { // the other side catches up every few frames
+            writer.flush(s);
+            reader.read(s, r);
+        }
+    }
+    writer.flush(s);
+    reader.read(s, r);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_EQUAL(NUM_FRAMES, r.numReceived);
+    TEST_ASSERT_TRUE(r.allMatched);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%s: %.1f MB/s, %.2f stream calls per frame", name, numBytes / secs / 1e6,
+             (double)s.numCalls / NUM_FRAMES);
+    TEST_MESSAGE(msg);
+}
+
+/**
+ * Not a pass/fail test (timings depend on the machine) - prints how fast frames get through with the batched writes and block
+ * reads StreamAPI uses now, next to the write per frame and read per byte it used before.
+ */
+void test_benchmark()
+{
+    benchmark<FrameWriter, ByteReader>("write per frame, read per byte (before)");
+    benchmark<BatchWriter, ByteReader>("batched writes, read per byte");
+    benchmark<FrameWriter, BlockReader>("write per frame, block reads");
+    benchmark<BatchWriter, BlockReader>("batched writes, block reads (now)");
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_survive_junk_and_splits);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,233 @@
+#include "TypedQueue.h"
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+/// How many items each producer sends in the multithreaded tests
+#define ITEMS_PER_PRODUCER 200000
+
+#define NUM_PRODUCERS 3
+
+/**
+ * What a FreeRTOS queue does for each call (copy the item in or out inside a critical section), with a mutex as our critical
+ * section, to compare TypedQueue against on a host which has no FreeRTOS.
+ */
+template <class T> class LockedQueue
+{
+    std::vector<T> items;
+    size_t head = 0, count = 0;
+    std::mutex lock;
+
+  public:
+    explicit LockedQueue(size_t maxElements) : items(maxElements) {}
+
+    bool enqueue(T x)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (count == items.size())
+            return false;
+        items[(head + count++) % items.size()] = x;
+        return true;
+    }
+
+    bool dequeue(T *p)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!count)
+            return false;
+        *p = items[head];
+        head = (head + 1) % items.size();
+        count--;
+        return true;
+    }
+};
+
+void test_capacity_rounds_up()
+{
+    TypedQueue<uint32_t> q(5);
+    TEST_ASSERT_EQUAL(8, q.numFree());
+    TEST_ASSERT_TRUE(q.isEmpty());
+
+    for (uint32_t i = 0; i < 8; i++)
+        TEST_ASSERT_TRUE(q.enqueue(i));
+    TEST_ASSERT_EQUAL(0, q.numFree());
+    TEST_ASSERT_FALSE(q.enqueue(8));
+
+    uint32_t v;
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(q.dequeue(&v));
+        TEST_ASSERT_EQUAL(i, v);
+    }
+    TEST_ASSERT_FALSE(q.dequeue(&v));
+    TEST_ASSERT_TRUE(q.isEmpty());
+    TEST_ASSERT_EQUAL(8, q.numFree());
+}
+
+void test_wraps_around()
+{
+    TypedQueue<uint32_t> q(4);
+    uint32_t v;
+    for (uint32_t i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(q.enqueue(i));
+        TEST_ASSERT_TRUE(q.enqueue(i + 1000));
+        TEST_ASSERT_TRUE(q.dequeue(&v));
+        TEST_ASSERT_EQUAL(i, v);
+        TEST_ASSERT_TRUE(q.dequeue(&v));
+        TEST_ASSERT_EQUAL(i + 1000, v);
+    }
+    TEST_ASSERT_TRUE(q.isEmpty());
+}
+
+void test_smallest_queue()
+{
+    // One slot isn't enough for our sequence numbers, so we always have at least two
+    TypedQueue<uint32_t> q(1);
+    TEST_ASSERT_EQUAL(2, q.numFree());
+    TEST_ASSERT_TRUE(q.enqueue(1));
+    TEST_ASSERT_TRUE(q.enqueue(2));
+    TEST_ASSERT_FALSE(q.enqueue(3));
+
+    uint32_t v;
+    TEST_ASSERT_TRUE(q.dequeue(&v));
+    TEST_ASSERT_EQUAL(1, v);
+    TEST_ASSERT_TRUE(q.dequeue(&v));
+    TEST_ASSERT_EQUAL(2, v);
+    TEST_ASSERT_FALSE(q.dequeue(&v));
+}
+
+void test_wakes_reader()
+{
+    TypedQueue<uint32_t> q(2);
+    concurrency::OSThread reader;
+    q.setReader(&reader);
+
+    TEST_ASSERT_TRUE(q.enqueue(1));
+    TEST_ASSERT_TRUE(q.enqueue(2));
+    TEST_ASSERT_EQUAL(2, reader.numWakes);
+
+    BaseType_t higherWake = 0;
+    TEST_ASSERT_FALSE(q.enqueueFromISR(3, &higherWake)); // full, so nothing to wake for
+    TEST_ASSERT_EQUAL(2, reader.numWakes);
+}
+
+/**
+ * Several threads enqueue at once (as the radio ISR and our threads do) into a queue much smaller than what they send, while
+ * one thread dequeues: nothing may be lost or duplicated, and each producer's items must come out in the order it sent them.
+ */
+void test_three_producers()
+{
+    TypedQueue<uint32_t> q(16);
+
+    std::vector<std::thread> producers;
+    for (uint32_t t = 0; t < NUM_PRODUCERS; t++)
+        producers.emplace_back([&q, t] {
+            for (uint32_t i = 1; i <= ITEMS_PER_PRODUCER; i++)
+                while (!q.enqueue((t << 28) | i)) // the producer number, then its count
+                    std::this_thread::yield();
+        });
+
+    uint32_t last[NUM_PRODUCERS] = {};
+    bool inOrder = true;
+    uint32_t numReceived = 0, v;
+    while (numReceived < NUM_PRODUCERS * ITEMS_PER_PRODUCER) {
+        if (q.dequeue(&v)) {
+            uint32_t t = v >> 28, i = v & 0xfffffff;
+            if (t >= NUM_PRODUCERS || i != last[t] + 1)
+                inOrder = false;
+            else
+                last[t] = i;
+            numReceived++;
+        } else
+            std::this_thread::yield();
+    }
+
+    for (auto &p : producers)
+        p.join();
+
+    TEST_ASSERT_TRUE(inOrder);
+    for (uint32_t t = 0; t < NUM_PRODUCERS; t++)
+        TEST_ASSERT_EQUAL(ITEMS_PER_PRODUCER, last[t]);
+    TEST_ASSERT_TRUE(q.isEmpty());
+}
+
+/// Where the benchmarks put what they dequeued, so the compiler can't leave out the work
+static volatile uint32_t sink;
+
+/// @return the average nsecs to enqueue then dequeue one item, with nobody else using the queue
+template <class Q> static double timeRoundTrip(Q &q)
+{
+    const uint32_t n = 1000000;
+    uint32_t v = 0, sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n; i++) {
+        q.enqueue(i);
+        q.dequeue(&v);
+        sum += v;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    sink = sum;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / n;
+}
+
+/// @return the average nsecs for each item to get through the queue, with NUM_PRODUCERS threads sending at once
+template <class Q> static double timeProducers(Q &q)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> producers;
+    for (uint32_t t = 0; t < NUM_PRODUCERS; t++)
+        producers.emplace_back([&q] {
+            for (uint32_t i = 0; i < ITEMS_PER_PRODUCER; i++)
+                while (!q.enqueue(i))
+                    std::this_thread::yield();
+        });
+
+    uint32_t numReceived = 0, v;
+    while (numReceived < NUM_PRODUCERS * ITEMS_PER_PRODUCER)
+        if (q.dequeue(&v))
+            numReceived++;
+        else
+            std::this_thread::yield();
+
+    for (auto &p : producers)
+        p.join();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / numReceived;
+}
+
+/**
+ * Not a pass/fail test (timings depend on the machine) - prints how long our queue takes next to the locked queue a FreeRTOS
+ * queue amounts to, so a change which makes TypedQueue slower is easy to see.
+ */
+void test_benchmark()
+{
+    TypedQueue<uint32_t> ring(16);
+    LockedQueue<uint32_t> locked(16);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "enqueue+dequeue: TypedQueue %.1f ns, locked queue %.1f ns", timeRoundTrip(ring),
+             timeRoundTrip(locked));
+    TEST_MESSAGE(msg);
+
+    snprintf(msg, sizeof(msg), "%d producers: TypedQueue %.1f ns/item, locked queue %.1f ns/item", NUM_PRODUCERS,
+             timeProducers(ring), timeProducers(locked));
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_capacity_rounds_up);
+    RUN_TEST(test_wraps_around);
+    RUN_TEST(test_smallest_queue);
+    RUN_TEST(test_wakes_reader);
+    RUN_TEST(test_three_producers);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}